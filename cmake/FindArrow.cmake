@@ -0,0 +1,46 @@
+# Tries to find Apache Arrow headers and libraries
+#
+# Usage of this module as follows:
+#
+#     find_package(Arrow)
+#
+# Variables used by this module, they can change the default behaviour and need
+# to be set before calling find_package:
+#
+#  ARROW_ROOT_DIR  Set this variable to the root installation of
+#                  Apache Arrow if the module has problems finding
+#                  the proper installation path.
+#
+# Variables defined by this module:
+#
+#  ARROW_FOUND              System has Arrow libs/headers
+#  ARROW_LIBRARIES          The Arrow libraries
+#  ARROW_INCLUDE_DIR        The location of Arrow headers
+
+find_path(ARROW_INCLUDE_DIR
+  NAMES arrow/api.h
+  HINTS ${ARROW_ROOT_DIR}/include)
+
+find_library(ARROW_LIBRARIES
+  NAMES arrow
+  HINTS ${ARROW_ROOT_DIR}/lib)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+  ARROW
+  DEFAULT_MSG
+  ARROW_LIBRARIES
+  ARROW_INCLUDE_DIR)
+
+mark_as_advanced(
+  ARROW_ROOT_DIR
+  ARROW_LIBRARIES
+  ARROW_INCLUDE_DIR)
+
+# create IMPORTED target for Arrow dependency
+if (ARROW_FOUND AND NOT TARGET arrow::arrow)
+  add_library(arrow::arrow UNKNOWN IMPORTED)
+  set_target_properties(arrow::arrow PROPERTIES
+    IMPORTED_LOCATION ${ARROW_LIBRARIES}
+    INTERFACE_INCLUDE_DIRECTORIES ${ARROW_INCLUDE_DIR})
+endif()
@@ -13,7 +13,11 @@
 
 #include "vast/column_index.hpp"
 
+#include <fstream>
+
+#include "vast/defaults.hpp"
 #include "vast/expression_visitors.hpp"
+#include "vast/filesystem.hpp"
 #include "vast/load.hpp"
 #include "vast/logger.hpp"
 #include "vast/save.hpp"
@@ -42,8 +46,7 @@ caf::expected<column_index_ptr> make_column_index(caf::actor_system& sys,
                                                   size_t column) {
   struct impl : column_index {
     impl(caf::actor_system& sys, path&& fname, type&& ctype, size_t col)
-      : column_index(sys, std::move(ctype), std::move(fname)),
-        col_(col) {
+      : column_index(sys, std::move(ctype), std::move(fname), col) {
         // nop
     }
 
@@ -51,12 +54,9 @@ caf::expected<column_index_ptr> make_column_index(caf::actor_system& sys,
       VAST_TRACE(VAST_ARG(x));
       if (has_skip_attribute_)
         return;
-      auto offset = x->offset();
-      for (table_slice::size_type row = 0; row < x->rows(); ++row)
-        idx_->append(x->at(row, col_), offset + row);
+      append(*x);
+      journal(x);
     }
-
-    size_t col_;
   };
   return init_res(std::make_unique<impl>(sys, std::move(filename),
                                          std::move(column_type), column));
@@ -81,15 +81,48 @@ caf::error column_index::init() {
     } else {
       VAST_DEBUG(this, "loaded value index with offset", idx_->offset());
     }
-    return caf::none;
+  } else {
+    // Otherwise construct a new one.
+    idx_ = value_index::make(index_type_);
+    if (idx_ == nullptr) {
+      VAST_ERROR(this, "failed to construct index");
+      return make_error(ec::unspecified, "failed to construct index");
+    }
+    VAST_DEBUG(this, "constructed new value index");
   }
-  // Otherwise construct a new one.
-  idx_ = value_index::make(index_type_);
-  if (idx_ == nullptr) {
-    VAST_ERROR(this, "failed to construct index");
-    return make_error(ec::unspecified, "failed to construct index");
+  // Replay all deltas that were flushed after the last seal.
+  auto journal = journal_filename();
+  if (!exists(journal))
+    return caf::none;
+  std::ifstream fs{journal.str(), std::ios::binary};
+  if (!fs)
+    return make_error(ec::filesystem_error, "failed to open delta log",
+                      journal);
+  while (fs.peek() != std::ifstream::traits_type::eof()) {
+    auto pos = fs.tellg();
+    table_slice_ptr slice;
+    if (auto err = load(sys_, *fs.rdbuf(), slice)) {
+      // A crash during a flush leaves a partial record at the end of the log.
+      // The records carry no framing, so we cannot skip past a broken one and
+      // keep only the deltas before it.
+      VAST_WARNING(this, "truncates delta log after unreadable record:",
+                   sys_.render(err));
+      fs.close();
+      file f{journal};
+      if (!f.open(file::write_only)
+          || !f.truncate(static_cast<size_t>(pos)))
+        return make_error(ec::filesystem_error,
+                          "failed to truncate delta log", journal);
+      break;
+    }
+    // Deltas overlapping with the sealed state stem from a seal that did not
+    // get to remove the log.
+    if (slice->offset() < idx_->offset())
+      continue;
+    append(*slice);
   }
-  VAST_DEBUG(this, "constructed new value index");
+  last_flush_ = idx_->offset();
+  VAST_DEBUG(this, "replayed delta log up to offset", last_flush_);
   return caf::none;
 }
 
@@ -97,13 +130,49 @@ caf::error column_index::flush_to_disk() {
   VAST_TRACE("");
   // Check whether there's something to write.
   auto offset = idx_->offset();
-  if (offset == last_flush_)
+  if (pending_.empty())
     return caf::none;
   VAST_DEBUG(this, "flushes index (" << (offset - last_flush_) << '/' << offset,
              "new/total bits)");
+  auto journal = journal_filename();
+  if (auto dir = journal.parent(); !exists(dir))
+    if (auto res = mkdir(dir); !res)
+      return res.error();
+  std::ofstream fs{journal.str(), std::ios::binary | std::ios::app};
+  if (!fs)
+    return make_error(ec::filesystem_error, "failed to open delta log",
+                      journal);
+  // Each delta consists of one slice, from which replaying picks our column.
+  for (auto& x : pending_)
+    if (auto err = save(sys_, *fs.rdbuf(), x))
+      return err;
+  fs.flush();
+  if (!fs)
+    return make_error(ec::filesystem_error, "failed to write delta log",
+                      journal);
+  pending_.clear();
+  pending_values_ = 0;
   last_flush_ = offset;
+  return caf::none;
+}
+
+caf::error column_index::seal() {
+  VAST_TRACE("");
+  auto journal = journal_filename();
+  if (pending_.empty() && !exists(journal)
+      && (exists(filename_) || idx_->offset() == 0))
+    return caf::none;
+  VAST_DEBUG(this, "seals index with offset", idx_->offset());
+  last_flush_ = idx_->offset();
   detail::value_index_inspect_helper tmp{index_type_, idx_};
-  return save(sys_, filename_, last_flush_, tmp);
+  if (auto err = save(sys_, filename_, last_flush_, tmp))
+    return err;
+  pending_.clear();
+  pending_values_ = 0;
+  if (exists(journal) && !rm(journal))
+    return make_error(ec::filesystem_error, "failed to remove delta log",
+                      journal);
+  return caf::none;
 }
 
 // -- properties -------------------------------------------------------------
@@ -116,13 +185,37 @@ caf::expected<bitmap> column_index::lookup(const predicate& pred) {
   return result;
 }
 
+path column_index::journal_filename() const {
+  return filename_.str() + ".log";
+}
+
+// -- delta log ----------------------------------------------------------------
+
+void column_index::journal(const table_slice_ptr& x) {
+  // We share the slice instead of copying its values.
+  pending_values_ += x->rows();
+  pending_.push_back(x);
+  if (pending_values_ < defaults::system::max_pending_column_values)
+    return;
+  // On failure, we keep the slices and retry with the next flush.
+  if (auto err = flush_to_disk())
+    VAST_ERROR(this, "failed to flush delta log", sys_.render(err));
+}
+
+void column_index::append(const table_slice& x) {
+  auto offset = x.offset();
+  for (table_slice::size_type row = 0; row < x.rows(); ++row)
+    idx_->append(x.at(row, col_), offset + row);
+}
+
 // -- constructors, destructors, and assignment operators ----------------------
 
 column_index::column_index(caf::actor_system& sys, type index_type,
-                           path filename)
+                           path filename, size_t column)
   : has_skip_attribute_(vast::has_skip_attribute(index_type)),
     index_type_(std::move(index_type)),
     filename_(std::move(filename)),
+    col_(column),
     sys_(sys) {
   // nop
 }
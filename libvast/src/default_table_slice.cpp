@@ -21,11 +21,36 @@
 
 namespace vast {
 
+default_table_slice_pool::default_table_slice_pool(size_t capacity)
+  : capacity_{capacity} {
+  rows_.reserve(capacity);
+}
+
+vector default_table_slice_pool::acquire() {
+  std::lock_guard<std::mutex> guard{mtx_};
+  if (rows_.empty())
+    return {};
+  auto result = std::move(rows_.back());
+  rows_.pop_back();
+  return result;
+}
+
+void default_table_slice_pool::release(vector&& rows) {
+  std::lock_guard<std::mutex> guard{mtx_};
+  if (rows_.size() < capacity_)
+    rows_.push_back(std::move(rows));
+}
+
 default_table_slice::default_table_slice(record_type layout)
   : table_slice{std::move(layout)} {
   // nop
 }
 
+default_table_slice::~default_table_slice() {
+  if (pool_ != nullptr)
+    pool_->release(std::move(xs_));
+}
+
 default_table_slice* default_table_slice::copy() const {
   return new default_table_slice(*this);
 }
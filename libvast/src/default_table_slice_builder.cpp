@@ -13,49 +13,70 @@
 
 #include "vast/default_table_slice_builder.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <string>
 #include <utility>
 
+#include "vast/view.hpp"
+
 namespace vast {
 
 default_table_slice_builder::default_table_slice_builder(record_type layout)
   : super{flatten(layout)},
-    row_(super::layout().fields.size()),
-    col_{0} {
-  VAST_ASSERT(!row_.empty());
+    row_{nullptr},
+    rows_{0},
+    col_{0},
+    pool_{std::make_shared<default_table_slice_pool>(recycled_slices)} {
+  VAST_ASSERT(!super::layout().fields.empty());
 }
 
 bool default_table_slice_builder::append(data x) {
-  lazy_init();
-  // TODO: consider an unchecked version for improved performance.
   if (!type_check(layout().fields[col_].type, x))
     return false;
-  row_[col_++] = std::move(x);
-  if (col_ == layout().fields.size()) {
-    slice_->xs_.push_back(std::move(row_));
-    row_ = vector(layout().fields.size());
-    col_ = 0;
-  }
+  cell() = std::move(x);
+  next_cell();
   return true;
 }
 
 bool default_table_slice_builder::add(data_view x) {
+  // Check strings without materializing them first.
+  if (caf::holds_alternative<view<std::string>>(x)) {
+    if (!caf::holds_alternative<string_type>(layout().fields[col_].type))
+      return false;
+    put(x);
+    return true;
+  }
   return append(materialize(x));
 }
 
+bool default_table_slice_builder::add_unchecked(data_view x) {
+  VAST_ASSERT(type_check(layout().fields[col_].type, materialize(x)));
+  put(x);
+  return true;
+}
+
 table_slice_ptr default_table_slice_builder::finish() {
-  // If we have an incomplete row, we take it as-is and keep the remaining null
+  lazy_init();
+  auto& xs = slice_->xs_;
+  // If we have an incomplete row, we take it as-is and null the remaining
   // values. Better to have incomplete than no data.
-  if (col_ != 0)
-    slice_->xs_.push_back(std::move(row_));
+  if (col_ != 0) {
+    std::fill(row_->begin() + col_, row_->end(), data{});
+    ++rows_;
+  }
+  // Drop surplus rows of a recycled slice.
+  xs.resize(rows_);
   // Populate slice.
   // TODO: this feels messy, but allows for non-virtual parent accessors.
-  slice_->rows_ = slice_->xs_.size();
+  slice_->rows_ = rows_;
   slice_->columns_ = layout().fields.size();
+  slice_->pool_ = pool_;
   return table_slice_ptr{slice_.release(), false};
 }
 
 size_t default_table_slice_builder::rows() const noexcept {
-  return slice_ == nullptr ? 0u : slice_->xs_.size();
+  return slice_ == nullptr ? 0u : rows_;
 }
 
 void default_table_slice_builder::reserve(size_t num_rows) {
@@ -66,9 +87,44 @@ void default_table_slice_builder::reserve(size_t num_rows) {
 void default_table_slice_builder::lazy_init() {
   if (slice_ == nullptr) {
     slice_.reset(new default_table_slice(layout()));
-    row_ = vector(layout().fields.size());
+    slice_->xs_ = pool_->acquire();
+    row_ = nullptr;
+    rows_ = 0;
     col_ = 0;
   }
 }
 
+data& default_table_slice_builder::cell() {
+  lazy_init();
+  if (col_ == 0) {
+    auto& xs = slice_->xs_;
+    if (rows_ == xs.size())
+      xs.emplace_back(vector(layout().fields.size()));
+    row_ = &caf::get<vector>(xs[rows_]);
+    VAST_ASSERT(row_->size() == layout().fields.size());
+  }
+  return (*row_)[col_];
+}
+
+void default_table_slice_builder::next_cell() {
+  if (++col_ == layout().fields.size()) {
+    col_ = 0;
+    ++rows_;
+  }
+}
+
+void default_table_slice_builder::put(data_view x) {
+  auto& y = cell();
+  // Copy strings into the existing cell to reuse its capacity.
+  if (auto str = caf::get_if<view<std::string>>(&x)) {
+    if (auto s = caf::get_if<std::string>(&y))
+      s->assign(str->data(), str->size());
+    else
+      y = std::string{*str};
+  } else {
+    y = materialize(x);
+  }
+  next_cell();
+}
+
 } // namespace vast
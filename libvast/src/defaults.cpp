@@ -39,6 +39,7 @@ size_t max_events = 0;
 size_t max_flow_age = 60;
 size_t max_flows = 1_Mi;
 size_t generated_events = 100;
+size_t parser_threads = 1;
 const char* node_id = "node";
 
 } // namespace command
@@ -47,6 +48,9 @@ namespace system {
 
 size_t table_slice_size = 100;
 size_t max_partition_size = 1_Mi;
+size_t max_datagram_buffer_size = 64_Mi;
+size_t max_exporter_results = 64_Ki;
+size_t max_pending_column_values = 64_Ki;
 
 } // namespace system
 
@@ -0,0 +1,57 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#include "vast/detail/chunkbuf.hpp"
+
+#include "vast/detail/assert.hpp"
+
+namespace vast::detail {
+
+chunkbuf::chunkbuf(chunk_ptr chk) : chunk_{std::move(chk)} {
+  VAST_ASSERT(chunk_ != nullptr);
+  // The get area is read-only, but std::streambuf wants mutable pointers.
+  auto first = const_cast<char_type*>(chunk_->data());
+  setg(first, first, first + chunk_->size());
+}
+
+std::string_view chunkbuf::take() {
+  std::string_view result{gptr(), static_cast<size_t>(egptr() - gptr())};
+  setg(eback(), egptr(), egptr());
+  return result;
+}
+
+chunkbuf::pos_type chunkbuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                     std::ios_base::openmode which) {
+  switch (dir) {
+    default:
+      return -1;
+    case std::ios_base::beg:
+      return seekpos(off, which);
+    case std::ios_base::cur:
+      return seekpos(gptr() - eback() + off, which);
+    case std::ios_base::end:
+      return seekpos(egptr() - eback() + off, which);
+  }
+}
+
+chunkbuf::pos_type chunkbuf::seekpos(pos_type pos,
+                                     std::ios_base::openmode which) {
+  auto n = static_cast<off_type>(pos);
+  if (which != std::ios_base::in || n < 0 || n > egptr() - eback())
+    return -1;
+  setg(eback(), eback() + n, egptr());
+  return pos;
+}
+
+} // namespace vast::detail
@@ -11,42 +11,89 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
+#include <cstring>
+
 #include "vast/detail/assert.hpp"
+#include "vast/detail/chunkbuf.hpp"
 #include "vast/detail/line_range.hpp"
 
 namespace vast {
 namespace detail {
 
 line_range::line_range(std::istream& input) : input_{input} {
+  // Memory-mapped input doesn't need a buffer.
+  if (auto cb = dynamic_cast<chunkbuf*>(input_.rdbuf())) {
+    auto xs = cb->take();
+    first_ = xs.data();
+    last_ = xs.data() + xs.size();
+  }
   next(); // prime the pump
 }
 
-const std::string& line_range::get() const {
+std::string_view line_range::get() const {
   return line_;
 }
 
 void line_range::next() {
   VAST_ASSERT(!done());
-  line_.clear();
+  line_ = {};
   // Get the next non-empty line.
-  while (line_.empty())
-    if (std::getline(input_, line_))
+  while (line_.empty()) {
+    auto size = static_cast<size_t>(last_ - first_);
+    auto nl = size > 0 ? std::memchr(first_, '\n', size) : nullptr;
+    if (nl != nullptr) {
+      auto end = static_cast<const char*>(nl);
+      line_ = std::string_view{first_, static_cast<size_t>(end - first_)};
+      first_ = end + 1;
+      ++line_number_;
+    } else if (!eof_) {
+      refill();
+    } else if (size > 0) {
+      // The last line has no trailing newline.
+      line_ = std::string_view{first_, size};
+      first_ = last_;
       ++line_number_;
-    else
+    } else {
       break;
+    }
+  }
 }
 
 bool line_range::done() const {
-  return line_.empty() && !input_;
-}
-
-std::string& line_range::line() {
-  return line_;
+  return line_.empty() && eof_ && first_ == last_;
 }
 
 size_t line_range::line_number() const {
   return line_number_;
 }
 
+void line_range::refill() {
+  auto sb = input_.rdbuf();
+  // Block until input arrives, but then only take what's available so that
+  // slow producers don't stall us until we have a full block.
+  if (sb == nullptr
+      || std::istream::traits_type::eq_int_type(
+           sb->sgetc(), std::istream::traits_type::eof())) {
+    input_.setstate(std::ios_base::eofbit);
+    eof_ = true;
+    return;
+  }
+  auto available = static_cast<size_t>(std::max(sb->in_avail(),
+                                                std::streamsize{1}));
+  auto n = std::min(available, block_size);
+  auto unconsumed = static_cast<size_t>(last_ - first_);
+  if (buffer_.size() < unconsumed + n) {
+    std::vector<char> xs(std::max(unconsumed + n, 2 * buffer_.size()));
+    std::copy(first_, last_, xs.data());
+    buffer_.swap(xs);
+  } else if (unconsumed > 0) {
+    std::memmove(buffer_.data(), first_, unconsumed);
+  }
+  auto got = sb->sgetn(buffer_.data() + unconsumed, n);
+  first_ = buffer_.data();
+  last_ = buffer_.data() + unconsumed + std::max(got, std::streamsize{0});
+}
+
 } // namespace detail
 } // namespace vast
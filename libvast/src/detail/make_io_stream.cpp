@@ -13,8 +13,11 @@
 
 #include <fstream>
 
+#include "vast/chunk.hpp"
 #include "vast/error.hpp"
+#include "vast/filesystem.hpp"
 
+#include "vast/detail/chunkbuf.hpp"
 #include "vast/detail/fdinbuf.hpp"
 #include "vast/detail/fdostream.hpp"
 #include "vast/detail/make_io_stream.hpp"
@@ -50,6 +53,12 @@ make_input_stream(const std::string& input, bool is_uds) {
     auto sb = std::make_unique<fdinbuf>(0); // stdin
     return std::make_unique<owning_istream>(std::move(sb));
   }
+  // Memory-map regular files, which allows for reading lines without copying.
+  // Empty files and special files, e.g., named pipes, fail to map.
+  if (auto chk = chunk::mmap(input)) {
+    auto cb = std::make_unique<chunkbuf>(std::move(chk));
+    return std::make_unique<owning_istream>(std::move(cb));
+  }
   auto fb = std::make_unique<std::filebuf>();
   fb->open(input, std::ios_base::binary | std::ios_base::in);
   return std::make_unique<owning_istream>(std::move(fb));
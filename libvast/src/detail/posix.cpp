@@ -247,5 +247,25 @@ bool seek(int fd, size_t bytes) {
   return ::lseek(fd, bytes, SEEK_CUR) != -1;
 }
 
+bool sync(int fd) {
+  int result;
+  do {
+#ifdef VAST_LINUX
+    result = ::fdatasync(fd);
+#else
+    result = ::fsync(fd);
+#endif
+  } while (result < 0 && errno == EINTR);
+  return result == 0;
+}
+
+bool truncate(int fd, size_t size) {
+  int result;
+  do {
+    result = ::ftruncate(fd, static_cast<off_t>(size));
+  } while (result < 0 && errno == EINTR);
+  return result == 0;
+}
+
 } // namespace detail
 } // namespace vast
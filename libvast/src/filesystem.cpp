@@ -11,6 +11,7 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
 #include <fstream>
 #include <iterator>
 
@@ -29,6 +30,7 @@
 #  include <cstring>
 #  include <cstdio>
 #  include <fcntl.h>
+#  include <fnmatch.h>
 #  include <unistd.h>
 #  include <sys/stat.h>
 #  include <sys/types.h>
@@ -322,6 +324,14 @@ bool file::seek(size_t bytes) {
   return true;
 }
 
+bool file::sync() {
+  return is_open_ && detail::sync(handle_);
+}
+
+bool file::truncate(size_t size) {
+  return is_open_ && detail::truncate(handle_, size);
+}
+
 const path& file::path() const {
   return path_;
 }
@@ -469,4 +479,28 @@ expected<std::string> load_contents(const path& p) {
   return std::move(contents);
 }
 
+std::vector<path> glob(const path& pattern) {
+  std::vector<path> result;
+  auto collect = [&](const path& dir, auto predicate) {
+    for (auto& entry : directory{dir})
+      if (entry.is_regular_file() && predicate(entry))
+        result.push_back(entry);
+    std::sort(result.begin(), result.end());
+  };
+  auto name = pattern.basename().str();
+  if (name.find_first_of("*?[") != std::string::npos) {
+#ifdef VAST_POSIX
+    auto dir = pattern.parent();
+    collect(dir.empty() ? path{"."} : dir, [&](const path& entry) {
+      return ::fnmatch(name.c_str(), entry.basename().str().c_str(), 0) == 0;
+    });
+#endif // VAST_POSIX
+  } else if (pattern.is_directory()) {
+    collect(pattern, [](const path&) { return true; });
+  } else {
+    result.push_back(pattern);
+  }
+  return result;
+}
+
 } // namespace vast
@@ -0,0 +1,817 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include <istream>
+#include <numeric>
+#include <ostream>
+
+#include <arrow/api.h>
+#include <arrow/io/interfaces.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/ipc/writer.h>
+
+#include "vast/default_table_slice.hpp"
+#include "vast/defaults.hpp"
+#include "vast/detail/overload.hpp"
+#include "vast/detail/string.hpp"
+#include "vast/error.hpp"
+#include "vast/event.hpp"
+#include "vast/format/arrow.hpp"
+#include "vast/logger.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
+
+namespace vast::format::arrow {
+namespace {
+
+constexpr auto extension_name_key = "ARROW:extension:name";
+constexpr auto extension_metadata_key = "ARROW:extension:metadata";
+constexpr auto layout_name_key = "vast.name";
+
+caf::error make_arrow_error(const ::arrow::Status& status) {
+  return make_error(ec::format_error, status.ToString());
+}
+
+// -- stream adapters ----------------------------------------------------------
+
+// Writes Arrow output into a `std::ostream`.
+class ostream_adapter : public ::arrow::io::OutputStream {
+public:
+  explicit ostream_adapter(std::ostream& out) : out_{out} {
+    // nop
+  }
+
+  using ::arrow::io::OutputStream::Write;
+
+  ::arrow::Status Write(const void* data, int64_t nbytes) override {
+    out_.write(static_cast<const char*>(data), nbytes);
+    if (!out_)
+      return ::arrow::Status::IOError("failed to write to output stream");
+    position_ += nbytes;
+    return ::arrow::Status::OK();
+  }
+
+  ::arrow::Status Flush() override {
+    if (!out_.flush())
+      return ::arrow::Status::IOError("failed to flush output stream");
+    return ::arrow::Status::OK();
+  }
+
+  ::arrow::Status Close() override {
+    closed_ = true;
+    return Flush();
+  }
+
+  bool closed() const override {
+    return closed_;
+  }
+
+  ::arrow::Result<int64_t> Tell() const override {
+    return position_;
+  }
+
+private:
+  std::ostream& out_;
+  int64_t position_ = 0;
+  bool closed_ = false;
+};
+
+// Reads Arrow input from a `std::istream`.
+class istream_adapter : public ::arrow::io::InputStream {
+public:
+  explicit istream_adapter(std::istream& in) : in_{in} {
+    // nop
+  }
+
+  ::arrow::Result<int64_t> Read(int64_t nbytes, void* out) override {
+    in_.read(static_cast<char*>(out), nbytes);
+    if (in_.bad())
+      return ::arrow::Status::IOError("failed to read from input stream");
+    auto n = static_cast<int64_t>(in_.gcount());
+    position_ += n;
+    return n;
+  }
+
+  ::arrow::Result<std::shared_ptr<::arrow::Buffer>>
+  Read(int64_t nbytes) override {
+    auto buffer = ::arrow::AllocateBuffer(nbytes);
+    if (!buffer.ok())
+      return buffer.status();
+    std::shared_ptr<::arrow::Buffer> result = std::move(buffer).ValueOrDie();
+    auto n = Read(nbytes, result->mutable_data());
+    if (!n.ok())
+      return n.status();
+    if (*n < nbytes)
+      return ::arrow::SliceBuffer(std::move(result), 0, *n);
+    return result;
+  }
+
+  ::arrow::Status Close() override {
+    closed_ = true;
+    return ::arrow::Status::OK();
+  }
+
+  bool closed() const override {
+    return closed_;
+  }
+
+  ::arrow::Result<int64_t> Tell() const override {
+    return position_;
+  }
+
+private:
+  std::istream& in_;
+  int64_t position_ = 0;
+  bool closed_ = false;
+};
+
+// -- type mapping -------------------------------------------------------------
+
+using arrow_type_ptr = std::shared_ptr<::arrow::DataType>;
+
+std::shared_ptr<::arrow::Field> make_field(const std::string& name,
+                                           const type& t);
+
+// Returns the extension name for VAST types that lack a native Arrow type.
+std::string extension_name(const type& t) {
+  return caf::visit(
+    detail::overload(
+      [](const pattern_type&) -> std::string { return "vast.pattern"; },
+      [](const address_type&) -> std::string { return "vast.address"; },
+      [](const subnet_type&) -> std::string { return "vast.subnet"; },
+      [](const port_type&) -> std::string { return "vast.port"; },
+      [](const enumeration_type&) -> std::string {
+        return "vast.enumeration";
+      },
+      [](const set_type&) -> std::string { return "vast.set"; },
+      [](const map_type&) -> std::string { return "vast.map"; },
+      [](const alias_type& x) { return extension_name(x.value_type); },
+      [](const auto&) { return std::string{}; }),
+    t);
+}
+
+// Returns the extension metadata, i.e., the labels of an enumeration.
+std::string extension_metadata(const type& t) {
+  if (auto x = caf::get_if<alias_type>(&t))
+    return extension_metadata(x->value_type);
+  if (auto x = caf::get_if<enumeration_type>(&t))
+    return detail::join(x->fields, ",");
+  return {};
+}
+
+// Returns the Arrow type that stores values of a VAST type.
+arrow_type_ptr make_storage_type(const type& t) {
+  auto address_storage = [] { return ::arrow::fixed_size_binary(16); };
+  return caf::visit(
+    detail::overload(
+      [](const boolean_type&) -> arrow_type_ptr { return ::arrow::boolean(); },
+      [](const integer_type&) -> arrow_type_ptr { return ::arrow::int64(); },
+      [](const count_type&) -> arrow_type_ptr { return ::arrow::uint64(); },
+      [](const real_type&) -> arrow_type_ptr { return ::arrow::float64(); },
+      [](const timespan_type&) -> arrow_type_ptr {
+        return ::arrow::duration(::arrow::TimeUnit::NANO);
+      },
+      [](const timestamp_type&) -> arrow_type_ptr {
+        return ::arrow::timestamp(::arrow::TimeUnit::NANO);
+      },
+      [](const string_type&) -> arrow_type_ptr { return ::arrow::utf8(); },
+      [](const pattern_type&) -> arrow_type_ptr { return ::arrow::utf8(); },
+      [&](const address_type&) -> arrow_type_ptr {
+        return address_storage();
+      },
+      [&](const subnet_type&) -> arrow_type_ptr {
+        return ::arrow::struct_({::arrow::field("address", address_storage()),
+                                 ::arrow::field("length", ::arrow::uint8())});
+      },
+      [](const port_type&) -> arrow_type_ptr {
+        return ::arrow::struct_({::arrow::field("number", ::arrow::uint16()),
+                                 ::arrow::field("type", ::arrow::uint8())});
+      },
+      [](const enumeration_type&) -> arrow_type_ptr {
+        return ::arrow::uint32();
+      },
+      [](const vector_type& x) -> arrow_type_ptr {
+        return ::arrow::list(make_field("item", x.value_type));
+      },
+      [](const set_type& x) -> arrow_type_ptr {
+        return ::arrow::list(make_field("item", x.value_type));
+      },
+      [](const map_type& x) -> arrow_type_ptr {
+        auto entry = ::arrow::struct_({make_field("key", x.key_type),
+                                       make_field("value", x.value_type)});
+        return ::arrow::list(::arrow::field("item", std::move(entry)));
+      },
+      [](const alias_type& x) { return make_storage_type(x.value_type); },
+      [](const auto&) -> arrow_type_ptr { return ::arrow::null(); }),
+    t);
+}
+
+std::shared_ptr<::arrow::Field> make_field(const std::string& name,
+                                           const type& t) {
+  auto storage = make_storage_type(t);
+  auto ext = extension_name(t);
+  if (ext.empty())
+    return ::arrow::field(name, std::move(storage));
+  auto metadata
+    = ::arrow::key_value_metadata({extension_name_key, extension_metadata_key},
+                                  {std::move(ext), extension_metadata(t)});
+  return ::arrow::field(name, std::move(storage), true, std::move(metadata));
+}
+
+std::shared_ptr<::arrow::Schema> make_schema(const record_type& layout) {
+  std::vector<std::shared_ptr<::arrow::Field>> fields;
+  fields.reserve(layout.fields.size());
+  for (auto& field : layout.fields)
+    fields.push_back(make_field(field.name, field.type));
+  auto metadata = ::arrow::key_value_metadata({layout_name_key},
+                                              {layout.name()});
+  return ::arrow::schema(std::move(fields), std::move(metadata));
+}
+
+// Restores the VAST type of an Arrow field.
+expected<type> make_type(const ::arrow::Field& field) {
+  std::string ext;
+  std::string ext_metadata;
+  if (auto& metadata = field.metadata()) {
+    if (auto i = metadata->FindKey(extension_name_key); i != -1)
+      ext = metadata->value(i);
+    if (auto i = metadata->FindKey(extension_metadata_key); i != -1)
+      ext_metadata = metadata->value(i);
+  }
+  auto& t = *field.type();
+  switch (t.id()) {
+    default:
+      break;
+    case ::arrow::Type::BOOL:
+      return type{boolean_type{}};
+    case ::arrow::Type::INT64:
+      return type{integer_type{}};
+    case ::arrow::Type::UINT64:
+      return type{count_type{}};
+    case ::arrow::Type::DOUBLE:
+      return type{real_type{}};
+    case ::arrow::Type::DURATION:
+      return type{timespan_type{}};
+    case ::arrow::Type::TIMESTAMP:
+      return type{timestamp_type{}};
+    case ::arrow::Type::STRING:
+      if (ext == "vast.pattern")
+        return type{pattern_type{}};
+      return type{string_type{}};
+    case ::arrow::Type::FIXED_SIZE_BINARY:
+      if (ext == "vast.address")
+        return type{address_type{}};
+      break;
+    case ::arrow::Type::STRUCT:
+      if (t.num_fields() != 2)
+        break;
+      if (ext == "vast.subnet")
+        return type{subnet_type{}};
+      if (ext == "vast.port")
+        return type{port_type{}};
+      break;
+    case ::arrow::Type::UINT32:
+      if (ext == "vast.enumeration") {
+        std::vector<std::string> labels;
+        if (!ext_metadata.empty())
+          labels = detail::to_strings(detail::split(ext_metadata, ","));
+        return type{enumeration_type{std::move(labels)}};
+      }
+      break;
+    case ::arrow::Type::LIST: {
+      auto& item = *static_cast<const ::arrow::ListType&>(t).value_field();
+      if (ext == "vast.map") {
+        auto& entry = *item.type();
+        if (entry.id() != ::arrow::Type::STRUCT || entry.num_fields() != 2)
+          break;
+        auto key = make_type(*entry.field(0));
+        if (!key)
+          return key.error();
+        auto value = make_type(*entry.field(1));
+        if (!value)
+          return value.error();
+        return type{map_type{std::move(*key), std::move(*value)}};
+      }
+      auto value = make_type(item);
+      if (!value)
+        return value.error();
+      if (ext == "vast.set")
+        return type{set_type{std::move(*value)}};
+      return type{vector_type{std::move(*value)}};
+    }
+  }
+  return make_error(ec::format_error, "unsupported Arrow type:", t.ToString());
+}
+
+// -- value conversion ---------------------------------------------------------
+
+// Appends a null value. Struct builders require a value for every child.
+::arrow::Status append_null(::arrow::ArrayBuilder& builder) {
+  if (builder.type()->id() == ::arrow::Type::STRUCT) {
+    auto& b = static_cast<::arrow::StructBuilder&>(builder);
+    for (int i = 0; i < b.num_children(); ++i)
+      ARROW_RETURN_NOT_OK(append_null(*b.child(i)));
+    return b.Append(false);
+  }
+  return builder.AppendNull();
+}
+
+// Appends *x* through a builder of type `Builder` if *x* holds a `view<T>`,
+// and a null value otherwise.
+template <class Builder, class T, class F>
+::arrow::Status append_as(::arrow::ArrayBuilder& builder, data_view x, F f) {
+  if (auto y = caf::get_if<view<T>>(&x))
+    return f(static_cast<Builder&>(builder), *y);
+  return append_null(builder);
+}
+
+::arrow::Status append(::arrow::ArrayBuilder& builder, const type& t,
+                       data_view x) {
+  using namespace ::arrow;
+  auto append_address = [](ArrayBuilder* b, const vast::address& a) {
+    return static_cast<FixedSizeBinaryBuilder*>(b)->Append(a.data().data());
+  };
+  return caf::visit(
+    detail::overload(
+      [&](const boolean_type&) {
+        return append_as<BooleanBuilder, boolean>(
+          builder, x, [](auto& b, auto y) { return b.Append(y); });
+      },
+      [&](const integer_type&) {
+        return append_as<Int64Builder, integer>(
+          builder, x, [](auto& b, auto y) { return b.Append(y); });
+      },
+      [&](const count_type&) {
+        return append_as<UInt64Builder, count>(
+          builder, x, [](auto& b, auto y) { return b.Append(y); });
+      },
+      [&](const enumeration_type&) {
+        return append_as<UInt32Builder, count>(
+          builder, x, [](auto& b, auto y) {
+            return b.Append(static_cast<uint32_t>(y));
+          });
+      },
+      [&](const real_type&) {
+        return append_as<DoubleBuilder, real>(
+          builder, x, [](auto& b, auto y) { return b.Append(y); });
+      },
+      [&](const timespan_type&) {
+        return append_as<DurationBuilder, timespan>(
+          builder, x, [](auto& b, auto y) { return b.Append(y.count()); });
+      },
+      [&](const timestamp_type&) {
+        return append_as<TimestampBuilder, timestamp>(
+          builder, x, [](auto& b, auto y) {
+            return b.Append(y.time_since_epoch().count());
+          });
+      },
+      [&](const string_type&) {
+        return append_as<StringBuilder, std::string>(
+          builder, x, [](auto& b, auto y) {
+            return b.Append(y.data(), static_cast<int32_t>(y.size()));
+          });
+      },
+      [&](const pattern_type&) {
+        return append_as<StringBuilder, pattern>(
+          builder, x, [](auto& b, auto y) {
+            auto str = y.string();
+            return b.Append(str.data(), static_cast<int32_t>(str.size()));
+          });
+      },
+      [&](const address_type&) {
+        return append_as<FixedSizeBinaryBuilder, vast::address>(
+          builder, x, [&](auto& b, auto y) { return append_address(&b, y); });
+      },
+      [&](const subnet_type&) {
+        return append_as<StructBuilder, subnet>(
+          builder, x, [&](auto& b, auto y) {
+            ARROW_RETURN_NOT_OK(b.Append());
+            ARROW_RETURN_NOT_OK(append_address(b.child(0), y.network()));
+            return static_cast<UInt8Builder*>(b.child(1))->Append(y.length());
+          });
+      },
+      [&](const port_type&) {
+        return append_as<StructBuilder, port>(
+          builder, x, [](auto& b, auto y) {
+            ARROW_RETURN_NOT_OK(b.Append());
+            ARROW_RETURN_NOT_OK(
+              static_cast<UInt16Builder*>(b.child(0))->Append(y.number()));
+            return static_cast<UInt8Builder*>(b.child(1))->Append(y.type());
+          });
+      },
+      [&](const vector_type& v) {
+        return append_as<ListBuilder, vector>(
+          builder, x, [&](auto& b, auto y) {
+            ARROW_RETURN_NOT_OK(b.Append());
+            for (auto element : *y)
+              ARROW_RETURN_NOT_OK(
+                append(*b.value_builder(), v.value_type, element));
+            return Status::OK();
+          });
+      },
+      [&](const set_type& s) {
+        return append_as<ListBuilder, set>(
+          builder, x, [&](auto& b, auto y) {
+            ARROW_RETURN_NOT_OK(b.Append());
+            for (auto element : *y)
+              ARROW_RETURN_NOT_OK(
+                append(*b.value_builder(), s.value_type, element));
+            return Status::OK();
+          });
+      },
+      [&](const map_type& m) {
+        return append_as<ListBuilder, map>(
+          builder, x, [&](auto& b, auto y) {
+            ARROW_RETURN_NOT_OK(b.Append());
+            auto& entries = static_cast<StructBuilder&>(*b.value_builder());
+            for (auto [key, value] : *y) {
+              ARROW_RETURN_NOT_OK(entries.Append());
+              ARROW_RETURN_NOT_OK(append(*entries.child(0), m.key_type, key));
+              ARROW_RETURN_NOT_OK(
+                append(*entries.child(1), m.value_type, value));
+            }
+            return Status::OK();
+          });
+      },
+      [&](const alias_type& a) { return append(builder, a.value_type, x); },
+      [&](const auto&) { return append_null(builder); }),
+    t);
+}
+
+data make_data(const ::arrow::Array& array, int64_t i, const type& t) {
+  using namespace ::arrow;
+  if (array.IsNull(i))
+    return caf::none;
+  auto make_address = [](const Array& a, int64_t j) {
+    auto bytes = static_cast<const FixedSizeBinaryArray&>(a).GetValue(j);
+    return vast::address::v6(bytes, vast::address::network);
+  };
+  // Converts the entries of the list in row *i* with *f*.
+  auto for_each_entry = [&](auto f) {
+    auto& list = static_cast<const ListArray&>(array);
+    auto& values = *list.values();
+    auto first = list.value_offset(i);
+    for (auto j = first; j < first + list.value_length(i); ++j)
+      f(values, j);
+  };
+  return caf::visit(
+    detail::overload(
+      [&](const boolean_type&) -> data {
+        return static_cast<const BooleanArray&>(array).Value(i);
+      },
+      [&](const integer_type&) -> data {
+        return integer{static_cast<const Int64Array&>(array).Value(i)};
+      },
+      [&](const count_type&) -> data {
+        return count{static_cast<const UInt64Array&>(array).Value(i)};
+      },
+      [&](const enumeration_type&) -> data {
+        return enumeration{static_cast<const UInt32Array&>(array).Value(i)};
+      },
+      [&](const real_type&) -> data {
+        return real{static_cast<const DoubleArray&>(array).Value(i)};
+      },
+      [&](const timespan_type&) -> data {
+        return timespan{static_cast<const DurationArray&>(array).Value(i)};
+      },
+      [&](const timestamp_type&) -> data {
+        auto ns = static_cast<const TimestampArray&>(array).Value(i);
+        return timestamp{timespan{ns}};
+      },
+      [&](const string_type&) -> data {
+        return static_cast<const StringArray&>(array).GetString(i);
+      },
+      [&](const pattern_type&) -> data {
+        return pattern{static_cast<const StringArray&>(array).GetString(i)};
+      },
+      [&](const address_type&) -> data { return make_address(array, i); },
+      [&](const subnet_type&) -> data {
+        auto& fields = static_cast<const StructArray&>(array);
+        auto& length = static_cast<const UInt8Array&>(*fields.field(1));
+        return subnet{make_address(*fields.field(0), i), length.Value(i)};
+      },
+      [&](const port_type&) -> data {
+        auto& fields = static_cast<const StructArray&>(array);
+        auto& number = static_cast<const UInt16Array&>(*fields.field(0));
+        auto& proto = static_cast<const UInt8Array&>(*fields.field(1));
+        return port{number.Value(i),
+                    static_cast<port::port_type>(proto.Value(i))};
+      },
+      [&](const vector_type& v) -> data {
+        vector xs;
+        for_each_entry([&](const Array& values, int64_t j) {
+          xs.push_back(make_data(values, j, v.value_type));
+        });
+        return xs;
+      },
+      [&](const set_type& s) -> data {
+        set xs;
+        for_each_entry([&](const Array& values, int64_t j) {
+          xs.insert(make_data(values, j, s.value_type));
+        });
+        return xs;
+      },
+      [&](const map_type& m) -> data {
+        map xs;
+        for_each_entry([&](const Array& values, int64_t j) {
+          auto& entries = static_cast<const StructArray&>(values);
+          xs.emplace(make_data(*entries.field(0), j, m.key_type),
+                     make_data(*entries.field(1), j, m.value_type));
+        });
+        return xs;
+      },
+      [&](const alias_type& a) { return make_data(array, i, a.value_type); },
+      [&](const auto&) -> data { return caf::none; }),
+    t);
+}
+
+} // namespace <anonymous>
+
+// -- writer -------------------------------------------------------------------
+
+writer::writer(std::unique_ptr<std::ostream> out)
+  : out_{std::move(out)},
+    sink_{std::make_shared<ostream_adapter>(*out_)} {
+  // nop
+}
+
+writer::writer(writer&&) = default;
+
+writer& writer::operator=(writer&&) = default;
+
+writer::~writer() {
+  // nop
+}
+
+caf::expected<void> writer::write(const event& e) {
+  if (builder_ != nullptr && e.type() != event_type_) {
+    if (auto result = write_events(); !result)
+      return result;
+    builder_ = nullptr;
+  }
+  if (builder_ == nullptr) {
+    auto rt = caf::get_if<record_type>(&e.type());
+    if (rt == nullptr)
+      return make_error(ec::format_error, "cannot write non-record type:",
+                        e.type().name());
+    // Events get the same layout as in a table slice, i.e., with the
+    // timestamp as first column.
+    auto layout = *rt;
+    layout.fields.insert(layout.fields.begin(),
+                         record_field{"timestamp", timestamp_type{}});
+    builder_ = default_table_slice::make_builder(std::move(layout));
+    event_type_ = e.type();
+  }
+  if (!builder_->add(e.timestamp())
+      || !builder_->recursive_add(e.data(), e.type()))
+    return make_error(ec::type_clash, "failed to add event", e.id());
+  if (builder_->rows() >= defaults::system::table_slice_size)
+    return write_events();
+  return caf::no_error;
+}
+
+caf::expected<void> writer::write(const table_slice& slice,
+                                  const ids& selection) {
+  // Preserve the order with respect to previously written events.
+  if (auto result = write_events(); !result)
+    return result;
+  return write_rows(slice, selected_rows(slice, selection));
+}
+
+caf::expected<void> writer::flush() {
+  if (auto result = write_events(); !result)
+    return result;
+  if (auto status = sink_->Flush(); !status.ok())
+    return make_arrow_error(status);
+  return caf::no_error;
+}
+
+void writer::cleanup() {
+  if (auto result = write_events(); !result)
+    VAST_ERROR(this, "failed to write events:", result.error());
+  if (auto result = close_stream(); !result)
+    VAST_ERROR(this, "failed to close stream:", result.error());
+  out_->flush();
+}
+
+const char* writer::name() const {
+  return "arrow-writer";
+}
+
+caf::expected<void>
+writer::write_rows(const table_slice& slice,
+                   const std::vector<table_slice::size_type>& rows) {
+  if (rows.empty())
+    return caf::no_error;
+  if (stream_ == nullptr || slice.layout() != layout_) {
+    if (auto result = close_stream(); !result)
+      return result;
+    layout_ = slice.layout();
+    schema_ = make_schema(layout_);
+    auto stream = ::arrow::ipc::MakeStreamWriter(sink_.get(), schema_);
+    if (!stream.ok())
+      return make_arrow_error(stream.status());
+    stream_ = stream.ValueOrDie();
+  }
+  // Build the record batch column by column.
+  std::vector<std::shared_ptr<::arrow::Array>> columns;
+  columns.reserve(layout_.fields.size());
+  for (size_t col = 0; col < layout_.fields.size(); ++col) {
+    auto& t = layout_.fields[col].type;
+    std::unique_ptr<::arrow::ArrayBuilder> builder;
+    auto status = ::arrow::MakeBuilder(::arrow::default_memory_pool(),
+                                       schema_->field(col)->type(), &builder);
+    if (!status.ok())
+      return make_arrow_error(status);
+    if (status = builder->Reserve(rows.size()); !status.ok())
+      return make_arrow_error(status);
+    for (auto row : rows)
+      if (status = append(*builder, t, slice.at(row, col)); !status.ok())
+        return make_arrow_error(status);
+    std::shared_ptr<::arrow::Array> column;
+    if (status = builder->Finish(&column); !status.ok())
+      return make_arrow_error(status);
+    columns.push_back(std::move(column));
+  }
+  auto batch = ::arrow::RecordBatch::Make(schema_, rows.size(),
+                                          std::move(columns));
+  if (auto status = stream_->WriteRecordBatch(*batch); !status.ok())
+    return make_arrow_error(status);
+  return caf::no_error;
+}
+
+caf::expected<void> writer::write_events() {
+  if (builder_ == nullptr || builder_->rows() == 0)
+    return caf::no_error;
+  auto slice = builder_->finish();
+  if (slice == nullptr)
+    return make_error(ec::unspecified, "failed to finish a slice");
+  std::vector<table_slice::size_type> rows(slice->rows());
+  std::iota(rows.begin(), rows.end(), 0);
+  return write_rows(*slice, rows);
+}
+
+caf::expected<void> writer::close_stream() {
+  if (stream_ == nullptr)
+    return caf::no_error;
+  auto status = stream_->Close();
+  stream_ = nullptr;
+  if (!status.ok())
+    return make_arrow_error(status);
+  return caf::no_error;
+}
+
+// -- reader -------------------------------------------------------------------
+
+reader::reader(std::unique_ptr<std::istream> in)
+  : in_{std::move(in)},
+    source_{std::make_shared<istream_adapter>(*in_)} {
+  // nop
+}
+
+reader::reader(reader&&) = default;
+
+reader& reader::operator=(reader&&) = default;
+
+reader::~reader() {
+  // nop
+}
+
+caf::expected<event> reader::read() {
+  if (batch_ == nullptr || row_ == batch_->num_rows())
+    if (auto err = next_batch())
+      return err;
+  auto [ts, xs] = convert_row();
+  auto e = event::make(std::move(xs), layout_);
+  e.timestamp(ts);
+  return e;
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  size_t produced = 0;
+  while (produced < max_events) {
+    if (batch_ == nullptr || row_ == batch_->num_rows()) {
+      auto previous = layout_;
+      if (auto err = next_batch()) {
+        finish(f);
+        return {std::move(err), produced};
+      }
+      // Keep the order of the input when the layout changes.
+      if (layout_ != previous)
+        finish(f);
+    }
+    auto bptr = builder(layout_, max_slice_size);
+    if (bptr == nullptr)
+      return {make_error(ec::format_error, "invalid layout"), produced};
+    while (row_ < batch_->num_rows() && produced < max_events) {
+      auto [ts, xs] = convert_row();
+      if (!bptr->add(ts))
+        VAST_WARNING(this, "failed to add timestamp", ts);
+      for (auto& x : xs)
+        if (!bptr->add(make_view(x)))
+          VAST_WARNING(this, "failed to add value", x);
+      ++produced;
+      if (bptr->rows() == max_slice_size)
+        finish(f, *bptr);
+    }
+  }
+  return {caf::none, produced};
+}
+
+caf::expected<void> reader::schema(vast::schema sch) {
+  schema_ = std::move(sch);
+  return caf::no_error;
+}
+
+caf::expected<vast::schema> reader::schema() const {
+  if (caf::holds_alternative<none_type>(layout_))
+    return make_error(ec::format_error, "schema not yet read");
+  vast::schema sch;
+  sch.add(layout_);
+  return sch;
+}
+
+const char* reader::name() const {
+  return "arrow-reader";
+}
+
+caf::error reader::next_batch() {
+  for (;;) {
+    if (stream_ == nullptr) {
+      // Another IPC stream may follow the end of the previous one.
+      if (in_->peek() == std::istream::traits_type::eof())
+        return make_error(ec::end_of_input, "input exhausted");
+      auto stream = ::arrow::ipc::RecordBatchStreamReader::Open(source_);
+      if (!stream.ok())
+        return make_arrow_error(stream.status());
+      stream_ = stream.ValueOrDie();
+      auto& schema = *stream_->schema();
+      std::vector<record_field> fields;
+      for (auto& field : schema.fields()) {
+        auto t = make_type(*field);
+        if (!t)
+          return std::move(t.error());
+        fields.emplace_back(field->name(), std::move(*t));
+      }
+      // The timestamp column of a table slice becomes the event timestamp.
+      has_timestamp_ = !fields.empty() && fields.front().name == "timestamp"
+                       && caf::holds_alternative<timestamp_type>(
+                            fields.front().type);
+      if (has_timestamp_)
+        fields.erase(fields.begin());
+      record_type layout{std::move(fields)};
+      if (auto& md = schema.metadata())
+        if (auto i = md->FindKey(layout_name_key); i != -1)
+          layout.name(md->value(i));
+      layout_ = std::move(layout);
+      // Prefer a user-provided layout with the same structure, which retains
+      // the type attributes.
+      if (auto t = schema_.find(layout_.name()))
+        if (auto flat = flatten(*t); congruent(flat, layout_))
+          layout_ = std::move(flat);
+    }
+    std::shared_ptr<::arrow::RecordBatch> batch;
+    if (auto status = stream_->ReadNext(&batch); !status.ok())
+      return make_arrow_error(status);
+    if (batch == nullptr) {
+      stream_ = nullptr;
+      continue;
+    }
+    if (batch->num_rows() > 0) {
+      batch_ = std::move(batch);
+      row_ = 0;
+      return caf::none;
+    }
+  }
+}
+
+std::pair<timestamp, vector> reader::convert_row() {
+  auto& fields = caf::get<record_type>(layout_).fields;
+  auto first = has_timestamp_ ? 1 : 0;
+  timestamp ts = timestamp::clock::now();
+  if (has_timestamp_) {
+    auto& column = static_cast<const ::arrow::TimestampArray&>(
+      *batch_->column(0));
+    if (!column.IsNull(row_))
+      ts = timestamp{timespan{column.Value(row_)}};
+  }
+  vector xs;
+  xs.reserve(fields.size());
+  for (size_t i = 0; i < fields.size(); ++i)
+    xs.push_back(make_data(*batch_->column(first + i), row_, fields[i].type));
+  ++row_;
+  return {ts, std::move(xs)};
+}
+
+} // namespace vast::format::arrow
@@ -11,10 +11,14 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
 #include <fstream>
+#include <future>
 #include <iomanip>
+#include <thread>
 
 #include <caf/none.hpp>
+#include <caf/streambuf.hpp>
 
 #include "vast/concept/printable/numeric.hpp"
 #include "vast/concept/printable/to_string.hpp"
@@ -22,11 +26,14 @@
 #include "vast/concept/printable/vast/type.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/detail/fdoutbuf.hpp"
+#include "vast/detail/overload.hpp"
 #include "vast/detail/string.hpp"
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/format/bro.hpp"
 #include "vast/logger.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
 
 namespace vast::format::bro {
 namespace {
@@ -212,6 +219,10 @@ struct streamer {
         out_ << *f;
   }
 
+  void operator()(const pattern_type&, const pattern& p) const {
+    (*this)(string_type{}, p.string());
+  }
+
   void operator()(const port_type&, const port& p) const {
     out_ << p.number();
   }
@@ -257,12 +268,158 @@ struct streamer {
   std::ostream& out_;
 };
 
+using kind = field_decoder::kind;
+
+kind classify(const type& t) {
+  return caf::visit(detail::overload(
+                      [](const boolean_type&) { return kind::boolean; },
+                      [](const integer_type&) { return kind::integer; },
+                      [](const count_type&) { return kind::count; },
+                      [](const real_type&) { return kind::real; },
+                      [](const timestamp_type&) { return kind::timestamp; },
+                      [](const timespan_type&) { return kind::timespan; },
+                      [](const string_type&) { return kind::string; },
+                      [](const pattern_type&) { return kind::pattern; },
+                      [](const address_type&) { return kind::address; },
+                      [](const subnet_type&) { return kind::subnet; },
+                      [](const port_type&) { return kind::port; },
+                      [](const set_type&) { return kind::set; },
+                      [](const vector_type&) { return kind::vector; },
+                      [](const auto&) { return kind::other; }),
+                    t);
+}
+
+// Decodes a field of a basic type.
+bool decode(kind k, std::string_view str, data& x) {
+  auto f = str.begin();
+  auto l = str.end();
+  auto parse = [&](const auto& p, auto attr) {
+    if (!p(f, l, attr))
+      return false;
+    x = std::move(attr);
+    return true;
+  };
+  auto to_timespan = [](real r) {
+    return std::chrono::duration_cast<timespan>(double_seconds(r));
+  };
+  switch (k) {
+    default:
+      return false;
+    case kind::boolean:
+      return parse(parsers::tf, boolean{});
+    case kind::integer:
+      return parse(parsers::i64, integer{});
+    case kind::count:
+      return parse(parsers::u64, count{});
+    case kind::real:
+      return parse(parsers::real, real{});
+    case kind::timestamp: {
+      real r;
+      if (!parsers::real(f, l, r))
+        return false;
+      x = timestamp{to_timespan(r)};
+      return true;
+    }
+    case kind::timespan: {
+      real r;
+      if (!parsers::real(f, l, r))
+        return false;
+      x = to_timespan(r);
+      return true;
+    }
+    case kind::string: {
+      if (str.empty())
+        return false;
+      // Most strings contain no escape sequences, in which case we can copy
+      // them into the existing buffer.
+      if (str.find('\\') != std::string_view::npos)
+        x = detail::byte_unescape(std::string{str});
+      else if (auto s = caf::get_if<std::string>(&x))
+        s->assign(str.data(), str.size());
+      else
+        x = std::string{str};
+      return true;
+    }
+    case kind::pattern:
+      if (str.empty())
+        return false;
+      x = pattern{detail::byte_unescape(std::string{str})};
+      return true;
+    case kind::address:
+      return parse(parsers::addr, address{});
+    case kind::subnet:
+      return parse(parsers::net, subnet{});
+    case kind::port: {
+      uint16_t n;
+      if (!parsers::u16(f, l, n))
+        return false;
+      x = port{n, port::unknown};
+      return true;
+    }
+  }
+}
+
 } // namespace <anonymous>
 
-reader::reader(std::unique_ptr<std::istream> in) {
+field_decoder::field_decoder(const type& t, std::string set_separator)
+  : kind_{classify(t)},
+    set_separator_{std::move(set_separator)} {
+  if (auto st = caf::get_if<set_type>(&t))
+    element_kind_ = classify(st->value_type);
+  else if (auto vt = caf::get_if<vector_type>(&t))
+    element_kind_ = classify(vt->value_type);
+  // Bro cannot log nested containers, but schema types might have them.
+  if ((kind_ == kind::set || kind_ == kind::vector)
+      && element_kind_ >= kind::set)
+    kind_ = kind::other;
+  if (kind_ == kind::other)
+    fallback_ = make_bro_parser<std::string_view::const_iterator>(
+      t, set_separator_);
+}
+
+bool field_decoder::operator()(std::string_view str, data& x) const {
+  switch (kind_) {
+    default:
+      return decode(kind_, str, x);
+    case kind::set: {
+      set xs;
+      for (auto element : detail::split(str, set_separator_)) {
+        data y;
+        if (!decode(element_kind_, element, y))
+          return false;
+        xs.insert(std::move(y));
+      }
+      x = std::move(xs);
+      return true;
+    }
+    case kind::vector: {
+      vector xs;
+      for (auto element : detail::split(str, set_separator_)) {
+        xs.emplace_back();
+        if (!decode(element_kind_, element, xs.back()))
+          return false;
+      }
+      x = std::move(xs);
+      return true;
+    }
+    case kind::other: {
+      auto first = str.begin();
+      return fallback_(first, str.end(), x);
+    }
+  }
+}
+
+reader::reader(std::unique_ptr<std::istream> in, size_t threads)
+  : threads_{threads} {
   reset(std::move(in));
 }
 
+reader::~reader() {
+  for (size_t i = 0; i < workers_.size(); ++i)
+    tasks_->push({});
+  for (auto& worker : workers_)
+    worker.join();
+}
 
 void reader::reset(std::unique_ptr<std::istream> in) {
   VAST_ASSERT(in != nullptr);
@@ -271,6 +428,55 @@ void reader::reset(std::unique_ptr<std::istream> in) {
 }
 
 expected<event> reader::read() {
+  auto x = parse_line();
+  if (!x)
+    return x.error();
+  if (!*x)
+    return no_error;
+  auto ts = record_timestamp(values_);
+  vector xs(std::make_move_iterator(values_.begin()),
+            std::make_move_iterator(values_.end()));
+  auto ys = unflatten(std::move(xs), type_);
+  VAST_ASSERT(ys);
+  event e{{std::move(*ys), type_}};
+  e.timestamp(ts);
+  return e;
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  if (threads_ > 1)
+    return read_slices_parallel(max_events, max_slice_size, f);
+  size_t produced = 0;
+  while (produced < max_events) {
+    auto x = parse_line();
+    if (!x) {
+      if (x.error() == ec::parse_error) {
+        VAST_WARNING(this, x.error());
+        continue;
+      }
+      finish(f);
+      return {std::move(x.error()), produced};
+    }
+    if (!*x)
+      continue;
+    // The builder flattens the layout, so the parsed fields map one-to-one
+    // onto its columns after the leading timestamp.
+    auto bptr = builder(type_, max_slice_size);
+    VAST_ASSERT(bptr != nullptr);
+    if (auto ts = record_timestamp(values_); !bptr->add_unchecked(ts))
+      VAST_WARNING(this, "failed to add timestamp", ts);
+    for (auto& value : values_)
+      if (!bptr->add_unchecked(make_view(value)))
+        VAST_WARNING(this, "failed to add data", value);
+    ++produced;
+    if (bptr->rows() == max_slice_size)
+      finish(f, *bptr);
+  }
+  return {caf::none, produced};
+}
+
+expected<bool> reader::parse_line() {
   if (lines_->done())
     return make_error(ec::end_of_input, "input exhausted");
   if (caf::holds_alternative<none_type>(type_)) {
@@ -297,19 +503,23 @@ expected<event> reader::read() {
       s = detail::split(lines_->get(), separator_);
     } else {
       VAST_DEBUG(this, "ignores comment at line",
-                 lines_->line_number() << ':', lines_->get());
-      return no_error;
+                 lines_->line_number() << ':', std::string{lines_->get()});
+      return false;
     }
   }
+  return parse_record(lines_->get(), lines_->line_number(), values_);
+}
+
+expected<bool> reader::parse_record(std::string_view line, size_t line_number,
+                                    std::vector<data>& xs) const {
+  auto s = detail::split(line, separator_);
   if (s.size() != parsers_.size()) {
-    VAST_WARNING(this, "ignores invalid record at line",
-                 lines_->line_number() << ':', "got", s.size(),
-                 "fields but need", parsers_.size());
-    return no_error;
+    VAST_WARNING(this, "ignores invalid record at line", line_number << ':',
+                 "got", s.size(), "fields but need", parsers_.size());
+    return false;
   }
-  // Construct the record.
-  vector xs(s.size());
-  optional<timestamp> ts;
+  // Parse the fields. Callers reuse the value buffer across lines.
+  xs.resize(s.size());
   auto is_unset = [&](auto i) {
     return std::equal(unset_field_.begin(), unset_field_.end(),
                    s[i].begin(), s[i].end());
@@ -319,27 +529,132 @@ expected<event> reader::read() {
                       s[i].begin(), s[i].end());
   };
   for (auto i = 0u; i < s.size(); ++i) {
-    if (is_unset(i))
-      continue;
-    if (is_empty(i))
+    if (is_unset(i)) {
+      xs[i] = data{};
+    } else if (is_empty(i)) {
       xs[i] = construct(record_.fields[i].type);
-    else {
-      // The parser needs an lvalue reference to the first iterator.
-      auto first = s[i].begin();
-      if (!parsers_[i](first, s[i].end(), xs[i]))
-        return make_error(ec::parse_error, "field", i, "line",
-                          lines_->line_number(),
-                          std::string{first, s[i].end()});
+    } else {
+      if (!parsers_[i](s[i], xs[i]))
+        return make_error(ec::parse_error, "field", i, "line", line_number,
+                          std::string{s[i]});
     }
-    if (i == static_cast<size_t>(timestamp_field_))
-      if (auto tp = caf::get_if<timestamp>(&xs[i]))
-        ts = *tp;
   }
-  auto ys = unflatten(std::move(xs), type_);
-  VAST_ASSERT(ys);
-  event e{{std::move(*ys), type_}};
-  e.timestamp(ts ? *ts : timestamp::clock::now());
-  return e;
+  return true;
+}
+
+timestamp reader::record_timestamp(const std::vector<data>& xs) const {
+  if (timestamp_field_ > -1
+      && static_cast<size_t>(timestamp_field_) < xs.size())
+    if (auto ts = caf::get_if<timestamp>(&xs[timestamp_field_]))
+      return *ts;
+  return timestamp::clock::now();
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices_parallel(size_t max_events, size_t max_slice_size,
+                             consumer& f) {
+  if (workers_.empty()) {
+    auto cores = size_t{std::thread::hardware_concurrency()};
+    auto num_workers = std::min(threads_, std::max(cores, size_t{1}));
+    VAST_DEBUG(this, "starts", num_workers, "worker threads");
+    tasks_ = std::make_unique<detail::queue<std::function<void()>>>();
+    for (size_t i = 0; i < num_workers; ++i)
+      workers_.emplace_back([tasks = tasks_.get()] {
+        while (auto task = tasks->pop())
+          task();
+      });
+  }
+  size_t produced = 0;
+  while (produced < max_events) {
+    if (lines_->done())
+      return {make_error(ec::end_of_input, "input exhausted"), produced};
+    if (caf::holds_alternative<none_type>(type_))
+      if (auto t = parse_header(); !t)
+        return {std::move(t.error()), produced};
+    // Collect a chunk of lines that share the current header. A new header
+    // ends the chunk, since it changes separators, parsers, and layout.
+    auto capacity = std::min(max_events - produced, threads_ * max_slice_size);
+    auto new_header = false;
+    size_t n = 0;
+    while (n < capacity) {
+      lines_->next();
+      if (lines_->done())
+        break;
+      auto line = lines_->get();
+      if (line.front() == '#') {
+        if (detail::starts_with(line, "#separator")) {
+          new_header = true;
+          break;
+        }
+        VAST_DEBUG(this, "ignores comment at line",
+                   lines_->line_number() << ':', std::string{line});
+        continue;
+      }
+      // Reuse the string buffers of previous chunks.
+      if (n == chunk_.size()) {
+        chunk_.emplace_back(line);
+        chunk_line_numbers_.push_back(lines_->line_number());
+      } else {
+        chunk_[n] = line;
+        chunk_line_numbers_[n] = lines_->line_number();
+      }
+      ++n;
+    }
+    // Parse the chunk with one builder per slice and one task per builder.
+    auto num_slices = (n + max_slice_size - 1) / max_slice_size;
+    std::vector<table_slice_builder_ptr> builders(num_slices);
+    auto parse = [&](size_t i) {
+      auto bptr = make_builder(type_);
+      VAST_ASSERT(bptr != nullptr);
+      bptr->reserve(max_slice_size);
+      std::vector<data> xs;
+      auto first = i * max_slice_size;
+      auto last = std::min(n, first + max_slice_size);
+      for (auto j = first; j < last; ++j) {
+        auto x = parse_record(chunk_[j], chunk_line_numbers_[j], xs);
+        if (!x) {
+          VAST_WARNING(this, x.error());
+          continue;
+        }
+        if (!*x)
+          continue;
+        if (auto ts = record_timestamp(xs); !bptr->add_unchecked(ts))
+          VAST_WARNING(this, "failed to add timestamp", ts);
+        for (auto& value : xs)
+          if (!bptr->add_unchecked(make_view(value)))
+            VAST_WARNING(this, "failed to add data", value);
+      }
+      builders[i] = std::move(bptr);
+    };
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(num_slices);
+    for (size_t i = 0; i < num_slices; ++i) {
+      auto task = std::make_shared<std::packaged_task<void()>>([&, i] {
+        parse(i);
+      });
+      tasks.push_back(task->get_future());
+      tasks_->push([task] { (*task)(); });
+    }
+    for (auto& task : tasks)
+      task.get();
+    // Emit the slices in input order.
+    for (auto& bptr : builders) {
+      if (bptr->rows() == 0)
+        continue;
+      produced += bptr->rows();
+      finish(f, *bptr);
+    }
+    if (new_header) {
+      VAST_DEBUG(this, "restarts with new log");
+      timestamp_field_ = -1;
+      separator_.clear();
+      if (auto t = parse_header(); !t)
+        return {std::move(t.error()), produced};
+    } else if (lines_->done()) {
+      return {make_error(ec::end_of_input, "input exhausted"), produced};
+    }
+  }
+  return {caf::none, produced};
 }
 
 expected<void> reader::schema(vast::schema sch) {
@@ -383,7 +698,8 @@ expected<void> reader::parse_header() {
   while (pos != std::string::npos) {
     pos = lines_->get().find("\\x", pos);
     if (pos != std::string::npos) {
-      auto c = std::stoi(lines_->get().substr(pos + 2, 2), nullptr, 16);
+      auto hex = std::string{lines_->get().substr(pos + 2, 2)};
+      auto c = std::stoi(hex, nullptr, 16);
       VAST_ASSERT(c >= 0 && c <= 255);
       separator_.push_back(c);
       pos += 2;
@@ -404,7 +720,7 @@ expected<void> reader::parse_header() {
     lines_->next();
     if (lines_->done())
       return make_error(ec::format_error, "not enough header lines");
-    auto& line = lines_->get();
+    auto line = lines_->get();
     pos = line.find(prefixes[i]);
     if (pos != 0)
       return make_error(ec::format_error, "invalid header line, expected",
@@ -413,7 +729,8 @@ expected<void> reader::parse_header() {
     if (pos == std::string::npos)
       return make_error(ec::format_error, "invalid separator in header line");
     if (pos + separator_.size() >= line.size())
-      return make_error(ec::format_error, "missing header content:", line);
+      return make_error(ec::format_error, "missing header content:",
+                        std::string{line});
     header[i] = line.substr(pos + separator_.size());
   }
   // Assign header values.
@@ -470,12 +787,9 @@ expected<void> reader::parse_header() {
     }
   }
   // Create Bro parsers.
-  auto make_parser = [](const auto& type, const auto& set_sep) {
-    return make_bro_parser<iterator_type>(type, set_sep);
-  };
-  parsers_.resize(record_.fields.size());
-  for (size_t i = 0; i < record_.fields.size(); i++)
-    parsers_[i] = make_parser(record_.fields[i].type, set_separator_);
+  parsers_.clear();
+  for (auto& field : record_.fields)
+    parsers_.emplace_back(field.type, set_separator_);
   return no_error;
 }
 
@@ -487,42 +801,73 @@ writer::writer(path dir) {
 expected<void> writer::write(const event& e) {
   if (!caf::holds_alternative<record_type>(e.type()))
     return make_error(ec::format_error, "cannot process non-record events");
-  std::ostream* os = nullptr;
+  auto os = stream(e.type());
+  if (!os)
+    return os.error();
+  caf::visit(streamer{**os}, e.type(), e.data());
+  **os << '\n';
+  return no_error;
+}
+
+expected<void> writer::write(const table_slice& slice, const ids& selection) {
+  auto rows = selected_rows(slice, selection);
+  if (rows.empty())
+    return no_error;
+  auto layout = slice.layout(1).name(slice.layout().name());
+  auto os = stream(layout);
+  if (!os)
+    return os.error();
+  // Render all rows column by column into a buffer and write it at once.
+  buffer_.clear();
+  caf::containerbuf<std::string> sb{buffer_};
+  std::ostream out{&sb};
+  streamer s{out};
+  auto& r = caf::get<record_type>(layout);
+  for (auto row : rows) {
+    // The first column holds the timestamp.
+    for (size_t i = 0; i < r.fields.size(); ++i) {
+      if (i > 0)
+        out << separator;
+      auto x = materialize(slice.at(row, i + 1));
+      caf::visit(s, r.fields[i].type, x);
+    }
+    out << '\n';
+  }
+  out.flush();
+  (*os)->write(buffer_.data(), buffer_.size());
+  return no_error;
+}
+
+expected<std::ostream*> writer::stream(const type& t) {
   if (dir_.empty()) {
     if (streams_.empty()) {
       VAST_DEBUG(this, "creates a new stream for STDOUT");
       auto sb = std::make_unique<detail::fdoutbuf>(1);
       auto out = std::make_unique<std::ostream>(sb.release());
       auto i = streams_.emplace("", std::move(out));
-      stream_header(e.type(), *i.first->second);
-    }
-    os = streams_.begin()->second.get();
-  } else {
-    auto i = streams_.find(e.type().name());
-    if (i != streams_.end()) {
-      os = i->second.get();
-      VAST_ASSERT(os != nullptr);
-    } else {
-      VAST_DEBUG(this, "creates new stream for event", e.type().name());
-      if (!exists(dir_)) {
-        auto d = mkdir(dir_);
-        if (!d)
-          return d.error();
-      } else if (!dir_.is_directory()) {
-        return make_error(ec::format_error, "got existing non-directory path",
-                          dir_);
-      }
-      auto filename = dir_ / (e.type().name() + ".log");
-      auto fos = std::make_unique<std::ofstream>(filename.str());
-      stream_header(e.type(), *fos);
-      auto i = streams_.emplace(e.type().name(), std::move(fos));
-      os = i.first->second.get();
+      stream_header(t, *i.first->second);
     }
-  }
-  VAST_ASSERT(os != nullptr);
-  caf::visit(streamer{*os}, e.type(), e.data());
-  *os << '\n';
-  return no_error;
+    return streams_.begin()->second.get();
+  }
+  auto i = streams_.find(t.name());
+  if (i != streams_.end()) {
+    VAST_ASSERT(i->second != nullptr);
+    return i->second.get();
+  }
+  VAST_DEBUG(this, "creates new stream for event", t.name());
+  if (!exists(dir_)) {
+    auto d = mkdir(dir_);
+    if (!d)
+      return d.error();
+  } else if (!dir_.is_directory()) {
+    return make_error(ec::format_error, "got existing non-directory path",
+                      dir_);
+  }
+  auto filename = dir_ / (t.name() + ".log");
+  auto fos = std::make_unique<std::ofstream>(filename.str());
+  stream_header(t, *fos);
+  auto j = streams_.emplace(t.name(), std::move(fos));
+  return j.first->second.get();
 }
 
 expected<void> writer::flush() {
@@ -0,0 +1,589 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#include "vast/format/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "vast/concept/parseable/core.hpp"
+#include "vast/concept/parseable/numeric.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/port.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/concept/parseable/vast/time.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/overload.hpp"
+#include "vast/error.hpp"
+#include "vast/event.hpp"
+#include "vast/logger.hpp"
+#include "vast/pattern.hpp"
+#include "vast/table_slice_builder.hpp"
+
+namespace vast::format::json {
+namespace {
+
+// -- scanning ----------------------------------------------------------------
+
+bool is_ws(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void skip_ws(const char*& f, const char* l) {
+  while (f != l && is_ws(*f))
+    ++f;
+}
+
+bool skip_literal(const char*& f, const char* l, std::string_view str) {
+  if (static_cast<size_t>(l - f) < str.size()
+      || std::string_view{f, str.size()} != str)
+    return false;
+  f += str.size();
+  return true;
+}
+
+bool parse_hex4(const char*& f, const char* l, uint32_t& x) {
+  if (l - f < 4)
+    return false;
+  x = 0;
+  for (auto i = 0; i < 4; ++i) {
+    auto c = *f++;
+    x <<= 4;
+    if (c >= '0' && c <= '9')
+      x |= c - '0';
+    else if (c >= 'a' && c <= 'f')
+      x |= c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      x |= c - 'A' + 10;
+    else
+      return false;
+  }
+  return true;
+}
+
+void append_utf8(std::string& str, uint32_t x) {
+  if (x < 0x80) {
+    str += static_cast<char>(x);
+  } else if (x < 0x800) {
+    str += static_cast<char>(0xC0 | (x >> 6));
+    str += static_cast<char>(0x80 | (x & 0x3F));
+  } else if (x < 0x10000) {
+    str += static_cast<char>(0xE0 | (x >> 12));
+    str += static_cast<char>(0x80 | ((x >> 6) & 0x3F));
+    str += static_cast<char>(0x80 | (x & 0x3F));
+  } else {
+    str += static_cast<char>(0xF0 | (x >> 18));
+    str += static_cast<char>(0x80 | ((x >> 12) & 0x3F));
+    str += static_cast<char>(0x80 | ((x >> 6) & 0x3F));
+    str += static_cast<char>(0x80 | (x & 0x3F));
+  }
+}
+
+// Parses a JSON string. If the string contains no escape sequences, `x` points
+// into the input. Otherwise, `x` points to the unescaped string in `buf`.
+bool parse_string(const char*& f, const char* l, std::string_view& x,
+                  std::string& buf) {
+  if (f == l || *f != '"')
+    return false;
+  auto first = ++f;
+  while (f != l && *f != '"' && *f != '\\')
+    ++f;
+  if (f == l)
+    return false;
+  if (*f == '"') {
+    x = std::string_view{first, static_cast<size_t>(f - first)};
+    ++f;
+    return true;
+  }
+  buf.assign(first, f);
+  while (f != l) {
+    auto c = *f++;
+    if (c == '"') {
+      x = buf;
+      return true;
+    }
+    if (c != '\\') {
+      buf += c;
+      continue;
+    }
+    if (f == l)
+      return false;
+    switch (*f++) {
+      default:
+        return false;
+      case '"':
+        buf += '"';
+        break;
+      case '\\':
+        buf += '\\';
+        break;
+      case '/':
+        buf += '/';
+        break;
+      case 'b':
+        buf += '\b';
+        break;
+      case 'f':
+        buf += '\f';
+        break;
+      case 'n':
+        buf += '\n';
+        break;
+      case 'r':
+        buf += '\r';
+        break;
+      case 't':
+        buf += '\t';
+        break;
+      case 'u': {
+        uint32_t x;
+        if (!parse_hex4(f, l, x))
+          return false;
+        // Combine UTF-16 surrogate pairs.
+        if (x >= 0xD800 && x < 0xDC00) {
+          uint32_t low;
+          if (!skip_literal(f, l, "\\u") || !parse_hex4(f, l, low)
+              || low < 0xDC00 || low >= 0xE000)
+            return false;
+          x = 0x10000 + ((x - 0xD800) << 10) + (low - 0xDC00);
+        }
+        append_utf8(buf, x);
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+bool skip_string(const char*& f, const char* l) {
+  VAST_ASSERT(f != l && *f == '"');
+  for (++f; f != l; ++f) {
+    if (*f == '\\') {
+      if (++f == l)
+        return false;
+    } else if (*f == '"') {
+      ++f;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Skips over a value without interpreting it. For objects and arrays, we only
+// track the nesting depth and never look at keys or values.
+bool skip_value(const char*& f, const char* l) {
+  if (f == l)
+    return false;
+  switch (*f) {
+    case '"':
+      return skip_string(f, l);
+    case '{':
+    case '[': {
+      size_t depth = 0;
+      while (f != l) {
+        switch (*f) {
+          case '"':
+            if (!skip_string(f, l))
+              return false;
+            continue;
+          case '{':
+          case '[':
+            ++depth;
+            break;
+          case '}':
+          case ']':
+            if (--depth == 0) {
+              ++f;
+              return true;
+            }
+            break;
+        }
+        ++f;
+      }
+      return false;
+    }
+    default: {
+      // Numbers and literals end at the next structural character.
+      auto first = f;
+      while (f != l && *f != ',' && *f != '}' && *f != ']' && !is_ws(*f))
+        ++f;
+      return f != first;
+    }
+  }
+}
+
+// -- conversion --------------------------------------------------------------
+
+template <class Parser, class Attribute>
+bool parse_token(std::string_view str, const Parser& p, Attribute& x) {
+  auto f = str.begin();
+  auto l = str.end();
+  return p(f, l, x) && f == l;
+}
+
+timespan to_timespan(real x) {
+  return std::chrono::duration_cast<timespan>(double_seconds(x));
+}
+
+// Parses a JSON value into data of type `t`. Values that don't fit the type
+// become nil.
+// @returns `false` on malformed input.
+bool parse_data(const type& t, const char*& f, const char* l, data& x,
+                std::string& buf) {
+  skip_ws(f, l);
+  if (f == l)
+    return false;
+  if (*f == 'n') {
+    x = data{};
+    return skip_literal(f, l, "null");
+  }
+  auto mismatch = [&] {
+    x = data{};
+    return skip_value(f, l);
+  };
+  // Applies `g` to the contents of a JSON string.
+  auto from_string = [&](auto g) {
+    if (*f != '"')
+      return mismatch();
+    std::string_view str;
+    if (!parse_string(f, l, str, buf))
+      return false;
+    if (!g(str))
+      x = data{};
+    return true;
+  };
+  // Applies `g` to the token of a JSON number or literal.
+  auto from_token = [&](auto g) {
+    if (*f == '"' || *f == '{' || *f == '[')
+      return mismatch();
+    auto first = f;
+    if (!skip_value(f, l))
+      return false;
+    if (!g(std::string_view{first, static_cast<size_t>(f - first)}))
+      x = data{};
+    return true;
+  };
+  // Assigns the result of parsing with `p` to `x`.
+  auto parse_with = [&](const auto& p, auto attr) {
+    return [&, attr](std::string_view str) mutable {
+      if (!parse_token(str, p, attr))
+        return false;
+      x = std::move(attr);
+      return true;
+    };
+  };
+  // Parses the elements of a JSON array and passes them to `g`.
+  auto from_array = [&](const type& element_type, auto g) {
+    VAST_ASSERT(*f == '[');
+    ++f;
+    skip_ws(f, l);
+    if (f != l && *f == ']') {
+      ++f;
+      return true;
+    }
+    while (true) {
+      data y;
+      if (!parse_data(element_type, f, l, y, buf))
+        return false;
+      g(std::move(y));
+      skip_ws(f, l);
+      if (f == l)
+        return false;
+      if (*f == ']') {
+        ++f;
+        return true;
+      }
+      if (*f++ != ',')
+        return false;
+    }
+  };
+  return caf::visit(
+    detail::overload(
+      [&](const boolean_type&) {
+        return from_token([&](std::string_view str) {
+          if (str != "true" && str != "false")
+            return false;
+          x = str == "true";
+          return true;
+        });
+      },
+      [&](const integer_type&) {
+        return from_token(parse_with(parsers::i64, integer{}));
+      },
+      [&](const count_type&) {
+        return from_token(parse_with(parsers::u64, count{}));
+      },
+      [&](const real_type&) {
+        return from_token(parse_with(parsers::real_opt_dot, real{}));
+      },
+      [&](const timestamp_type&) {
+        // Numbers are fractional seconds since the UNIX epoch.
+        if (*f == '"')
+          return from_string(parse_with(parsers::timestamp, timestamp{}));
+        return from_token([&](std::string_view str) {
+          real r;
+          if (!parse_token(str, parsers::real_opt_dot, r))
+            return false;
+          x = timestamp{to_timespan(r)};
+          return true;
+        });
+      },
+      [&](const timespan_type&) {
+        // Numbers are fractional seconds.
+        if (*f == '"')
+          return from_string(parse_with(parsers::timespan, timespan{}));
+        return from_token([&](std::string_view str) {
+          real r;
+          if (!parse_token(str, parsers::real_opt_dot, r))
+            return false;
+          x = to_timespan(r);
+          return true;
+        });
+      },
+      [&](const string_type&) {
+        return from_string([&](std::string_view str) {
+          x = std::string{str};
+          return true;
+        });
+      },
+      [&](const pattern_type&) {
+        return from_string([&](std::string_view str) {
+          x = pattern{std::string{str}};
+          return true;
+        });
+      },
+      [&](const address_type&) {
+        return from_string(parse_with(parsers::addr, address{}));
+      },
+      [&](const subnet_type&) {
+        return from_string(parse_with(parsers::net, subnet{}));
+      },
+      [&](const port_type&) {
+        if (*f == '"')
+          return from_string(parse_with(parsers::port, port{}));
+        return from_token([&](std::string_view str) {
+          uint16_t n;
+          if (!parse_token(str, parsers::u16, n))
+            return false;
+          x = port{n, port::unknown};
+          return true;
+        });
+      },
+      [&](const vector_type& vt) {
+        if (*f != '[')
+          return mismatch();
+        vector xs;
+        auto push = [&](data y) { xs.push_back(std::move(y)); };
+        if (!from_array(vt.value_type, push))
+          return false;
+        x = std::move(xs);
+        return true;
+      },
+      [&](const set_type& st) {
+        if (*f != '[')
+          return mismatch();
+        set xs;
+        auto insert = [&](data y) { xs.insert(std::move(y)); };
+        if (!from_array(st.value_type, insert))
+          return false;
+        x = std::move(xs);
+        return true;
+      },
+      [&](const alias_type& at) {
+        return parse_data(at.value_type, f, l, x, buf);
+      },
+      [&](const auto&) {
+        return mismatch();
+      }),
+    t);
+}
+
+} // namespace <anonymous>
+
+reader::reader(std::unique_ptr<std::istream> in) {
+  reset(std::move(in));
+}
+
+void reader::reset(std::unique_ptr<std::istream> in) {
+  VAST_ASSERT(in != nullptr);
+  input_ = std::move(in);
+  lines_ = std::make_unique<detail::line_range>(*input_);
+}
+
+caf::expected<event> reader::read() {
+  auto x = parse_line();
+  if (!x)
+    return x.error();
+  if (!*x)
+    return no_error;
+  auto ts = record_timestamp();
+  vector xs(std::make_move_iterator(values_.begin()),
+            std::make_move_iterator(values_.end()));
+  auto ys = unflatten(std::move(xs), type_);
+  VAST_ASSERT(ys);
+  event e{{std::move(*ys), type_}};
+  e.timestamp(ts);
+  return e;
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  size_t produced = 0;
+  while (produced < max_events) {
+    auto x = parse_line();
+    if (!x) {
+      if (x.error() == ec::parse_error) {
+        VAST_WARNING(this, x.error());
+        continue;
+      }
+      finish(f);
+      return {std::move(x.error()), produced};
+    }
+    if (!*x)
+      continue;
+    auto bptr = builder(type_, max_slice_size);
+    VAST_ASSERT(bptr != nullptr);
+    if (auto ts = record_timestamp(); !bptr->add_unchecked(ts))
+      VAST_WARNING(this, "failed to add timestamp", ts);
+    for (auto& value : values_)
+      if (!bptr->add_unchecked(make_view(value)))
+        VAST_WARNING(this, "failed to add data", value);
+    ++produced;
+    if (bptr->rows() == max_slice_size)
+      finish(f, *bptr);
+  }
+  return {caf::none, produced};
+}
+
+caf::expected<void> reader::schema(vast::schema sch) {
+  auto layout = std::find_if(sch.begin(), sch.end(), [](const type& t) {
+    return caf::holds_alternative<record_type>(t);
+  });
+  if (layout == sch.end())
+    return make_error(ec::format_error, "schema has no record type");
+  type_ = *layout;
+  schema_ = std::move(sch);
+  flat_ = flatten(caf::get<record_type>(type_));
+  fields_.clear();
+  prefixes_.clear();
+  timestamp_field_ = -1;
+  for (size_t i = 0; i < flat_.fields.size(); ++i) {
+    auto& field = flat_.fields[i];
+    fields_.emplace(field.name, i);
+    for (auto pos = field.name.find('.'); pos != std::string::npos;
+         pos = field.name.find('.', pos + 1))
+      prefixes_.insert(field.name.substr(0, pos));
+    if (timestamp_field_ == -1
+        && caf::holds_alternative<timestamp_type>(field.type)) {
+      VAST_DEBUG(this, "auto-detected field", i, "as event timestamp");
+      timestamp_field_ = static_cast<int>(i);
+    }
+  }
+  values_.resize(flat_.fields.size());
+  return no_error;
+}
+
+caf::expected<schema> reader::schema() const {
+  if (caf::holds_alternative<none_type>(type_))
+    return make_error(ec::format_error, "no schema provided");
+  vast::schema sch;
+  sch.add(type_);
+  return sch;
+}
+
+const char* reader::name() const {
+  return "json-reader";
+}
+
+expected<bool> reader::parse_line() {
+  if (caf::holds_alternative<none_type>(type_))
+    return make_error(ec::format_error, "no schema provided");
+  if (lines_->done())
+    return make_error(ec::end_of_input, "input exhausted");
+  // The line is only valid until we advance the line range.
+  auto line = lines_->get();
+  auto line_number = lines_->line_number();
+  for (auto& x : values_)
+    x = data{};
+  path_.clear();
+  auto f = line.data();
+  auto l = line.data() + line.size();
+  skip_ws(f, l);
+  auto ok = parse_object(f, l);
+  skip_ws(f, l);
+  lines_->next();
+  if (!ok || f != l)
+    return make_error(ec::parse_error, "invalid JSON object in line",
+                      line_number);
+  return true;
+}
+
+bool reader::parse_object(const char*& f, const char* l) {
+  if (f == l || *f != '{')
+    return false;
+  ++f;
+  skip_ws(f, l);
+  if (f != l && *f == '}') {
+    ++f;
+    return true;
+  }
+  auto prefix_size = path_.size();
+  while (true) {
+    skip_ws(f, l);
+    std::string_view key;
+    if (!parse_string(f, l, key, buffer_))
+      return false;
+    path_.resize(prefix_size);
+    if (prefix_size > 0)
+      path_ += '.';
+    path_ += key;
+    skip_ws(f, l);
+    if (f == l || *f++ != ':')
+      return false;
+    skip_ws(f, l);
+    if (auto i = fields_.find(path_); i != fields_.end()) {
+      if (!parse_value(f, l, i->second))
+        return false;
+    } else if (f != l && *f == '{' && prefixes_.count(path_) > 0) {
+      if (!parse_object(f, l))
+        return false;
+    } else if (!skip_value(f, l)) {
+      return false;
+    }
+    skip_ws(f, l);
+    if (f == l)
+      return false;
+    if (*f == '}') {
+      ++f;
+      path_.resize(prefix_size);
+      return true;
+    }
+    if (*f++ != ',')
+      return false;
+  }
+}
+
+bool reader::parse_value(const char*& f, const char* l, size_t i) {
+  return parse_data(flat_.fields[i].type, f, l, values_[i], buffer_);
+}
+
+timestamp reader::record_timestamp() const {
+  if (timestamp_field_ > -1)
+    if (auto ts = caf::get_if<timestamp>(&values_[timestamp_field_]))
+      return *ts;
+  return timestamp::clock::now();
+}
+
+} // namespace vast::format::json
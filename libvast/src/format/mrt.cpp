@@ -1,5 +1,10 @@
 #include "vast/format/mrt.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <thread>
+
 #include "vast/si_literals.hpp"
 
 #include "vast/detail/assert.hpp"
@@ -11,9 +16,23 @@ namespace mrt {
 
 namespace {
 
+using namespace binary_byte_literals;
+
+/// The length of the MRT Common Header.
+constexpr size_t common_header_length = 12;
+
+// TODO: Where does the RFC specify the maximum length?
+constexpr size_t max_message_length = 1_MiB;
+
+/// The number of bytes the reader requests from its input at once.
+constexpr size_t block_size = 1_MiB;
+
+/// Turns the records of the MRT parser into events and hands them to `emit`,
+/// which takes the event timestamp, the event type, and the event data.
+template <class Emit>
 struct factory {
-  factory(std::queue<event>& events, const reader::types& types, uint32_t ts)
-    : events_{events}, types_{types} {
+  factory(Emit& emit, const reader::types& types, uint32_t ts)
+    : emit_{emit}, types_{types} {
     using namespace std::chrono;
     auto since_epoch = duration<uint32_t>{ts};
     timestamp_ = timestamp{duration_cast<timespan>(since_epoch)};
@@ -24,282 +43,157 @@ struct factory {
   }
 
   void operator()(table_dump_v2::peer_index_table& x) {
-    for (auto i = 0u; i < x.peer_count; i++) {
-      event e{{
-        vector{i,
-               x.peer_entries[i].peer_bgp_id,
-               x.peer_entries[i].peer_ip_address,
-               x.peer_entries[i].peer_as},
-        types_.table_dump_v2_peer_entry_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
-    }
+    for (auto i = 0u; i < x.peer_count; i++)
+      emit_(timestamp_, types_.table_dump_v2_peer_entry_type,
+            vector{i,
+                   x.peer_entries[i].peer_bgp_id,
+                   x.peer_entries[i].peer_ip_address,
+                   x.peer_entries[i].peer_as});
   }
 
   void operator()(table_dump_v2::rib_afi_safi& x) {
     for (auto i = 0u; i < x.entries.size(); i++) {
+      auto& attributes = x.entries[i].bgp_attributes;
       std::vector<vast::data> as_path;
-      count origin_as;
-      for (auto j = 0u; j < x.entries[i].bgp_attributes.as_path.size(); j++) {
-        origin_as = x.entries[i].bgp_attributes.as_path[j];
+      count origin_as = 0;
+      for (auto as : attributes.as_path) {
+        origin_as = as;
         as_path.push_back(origin_as);
       }
       std::vector<vast::data> communities;
-      count community;
-      for (auto j = 0u; j < x.entries[i].bgp_attributes.communities.size();
-           j++) {
-        community = x.entries[i].bgp_attributes.communities[j];
-        communities.push_back(community);
-      }
-      event e{{
-        vector{x.entries[i].peer_index,
-               x.header.prefix[0],
-               std::move(as_path),
-               origin_as,
-               x.entries[i].bgp_attributes.origin,
-               x.entries[i].bgp_attributes.next_hop,
-               x.entries[i].bgp_attributes.local_pref,
-               x.entries[i].bgp_attributes.multi_exit_disc,
-               communities,
-               x.entries[i].bgp_attributes.atomic_aggregate,
-               x.entries[i].bgp_attributes.aggregator_as,
-               x.entries[i].bgp_attributes.aggregator_ip},
-        types_.table_dump_v2_rib_entry_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
+      for (auto community : attributes.communities)
+        communities.push_back(count{community});
+      emit_(timestamp_, types_.table_dump_v2_rib_entry_type,
+            vector{x.entries[i].peer_index,
+                   x.header.prefix[0],
+                   std::move(as_path),
+                   origin_as,
+                   attributes.origin,
+                   attributes.next_hop,
+                   attributes.local_pref,
+                   attributes.multi_exit_disc,
+                   std::move(communities),
+                   attributes.atomic_aggregate,
+                   attributes.aggregator_as,
+                   attributes.aggregator_ip});
     }
   }
 
   void operator()(bgp4mp::state_change& x) {
-    event e{{
-      vector{x.peer_ip_address,
-             x.peer_as_number,
-             x.old_state,
-             x.new_state},
-      types_.bgp4mp_state_change_type
-    }};
-    e.timestamp(timestamp_);
-    events_.push(e);
+    emit_(timestamp_, types_.bgp4mp_state_change_type,
+          vector{x.peer_ip_address,
+                 x.peer_as_number,
+                 x.old_state,
+                 x.new_state});
   }
 
   void operator()(bgp4mp::message& x) {
-    if (auto open = caf::get_if<bgp::open>(&x.message.message)) {
-      event e{{
-        vector{open->version,
-               open->my_autonomous_system,
-               open->hold_time,
-               open->bgp_identifier},
-        types_.bgp4mp_open_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
-    } else if (auto update = caf::get_if<bgp::update>(&x.message.message)) {
-      std::vector<vast::data> as_path;
-      count origin_as;
-      for (auto i = 0u; i < update->path_attributes.as_path.size(); i++) {
-        origin_as = update->path_attributes.as_path[i];
-        as_path.push_back(origin_as);
-      }
-      std::vector<vast::data> communities;
-      count community;
-      for (auto i = 0u; i < update->path_attributes.communities.size(); i++) {
-        community = update->path_attributes.communities[i];
-        communities.push_back(community);
-      }
-      for (auto i = 0u; i < update->withdrawn_routes.size(); i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->withdrawn_routes[i]},
-          types_.bgp4mp_update_withdraw_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u; i < update->path_attributes.mp_reach_nlri.size(); i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->path_attributes.mp_reach_nlri[i],
-                 as_path,
-                 origin_as,
-                 update->path_attributes.origin,
-                 update->path_attributes.next_hop,
-                 update->path_attributes.local_pref,
-                 update->path_attributes.multi_exit_disc,
-                 communities,
-                 update->path_attributes.atomic_aggregate,
-                 update->path_attributes.aggregator_as,
-                 update->path_attributes.aggregator_ip},
-          types_.bgp4mp_update_announcement_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u; i < update->path_attributes.mp_unreach_nlri.size();
-           i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->path_attributes.mp_unreach_nlri[i]},
-          types_.bgp4mp_update_withdraw_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u;
-           i < update->network_layer_reachability_information.size(); i++) {
-        event e{{
+    bgp_message(x);
+  }
+
+  void operator()(bgp4mp::message_as4& x) {
+    bgp_message(x);
+  }
+
+  void operator()(bgp4mp::state_change_as4& x) {
+    emit_(timestamp_, types_.bgp4mp_state_change_type,
           vector{x.peer_ip_address,
                  x.peer_as_number,
-                 update->network_layer_reachability_information[i],
-                 as_path,
-                 origin_as,
-                 update->path_attributes.origin,
-                 update->path_attributes.next_hop,
-                 update->path_attributes.local_pref,
-                 update->path_attributes.multi_exit_disc,
-                 communities,
-                 update->path_attributes.atomic_aggregate,
-                 update->path_attributes.aggregator_as,
-                 update->path_attributes.aggregator_ip},
-          types_.bgp4mp_update_announcement_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-    } else if (auto notification =
-               caf::get_if<bgp::notification>(&x.message.message)) {
-      event e{{
-        vector{notification->error_code,
-               notification->error_subcode},
-        types_.bgp4mp_notification_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
-    }
+                 x.old_state,
+                 x.new_state});
   }
 
-  void operator()(bgp4mp::message_as4& x) {
+  /// Handles BGP messages with both 2-byte and 4-byte AS numbers.
+  template <class Message>
+  void bgp_message(Message& x) {
     if (auto open = caf::get_if<bgp::open>(&x.message.message)) {
-      event e{{
-        vector{open->version,
-               open->my_autonomous_system,
-               open->hold_time,
-               open->bgp_identifier},
-        types_.bgp4mp_open_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
+      emit_(timestamp_, types_.bgp4mp_open_type,
+            vector{open->version,
+                   open->my_autonomous_system,
+                   open->hold_time,
+                   open->bgp_identifier});
     } else if (auto update = caf::get_if<bgp::update>(&x.message.message)) {
+      auto& attributes = update->path_attributes;
       std::vector<vast::data> as_path;
-      count origin_as;
-      for (auto i = 0u; i < update->path_attributes.as_path.size(); i++) {
-        origin_as = update->path_attributes.as_path[i];
+      count origin_as = 0;
+      for (auto as : attributes.as_path) {
+        origin_as = as;
         as_path.push_back(origin_as);
       }
       std::vector<vast::data> communities;
-      count community;
-      for (auto i = 0u; i < update->path_attributes.communities.size(); i++) {
-        community = update->path_attributes.communities[i];
-        communities.push_back(community);
-      }
-      for (auto i = 0u; i < update->withdrawn_routes.size(); i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->withdrawn_routes[i]},
-          types_.bgp4mp_update_withdraw_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u; i < update->path_attributes.mp_reach_nlri.size(); i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->path_attributes.mp_reach_nlri[i],
-                 as_path,
-                 origin_as,
-                 update->path_attributes.origin,
-                 update->path_attributes.next_hop,
-                 update->path_attributes.local_pref,
-                 update->path_attributes.multi_exit_disc,
-                 communities,
-                 update->path_attributes.atomic_aggregate,
-                 update->path_attributes.aggregator_as,
-                 update->path_attributes.aggregator_ip},
-          types_.bgp4mp_update_announcement_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u; i < update->path_attributes.mp_unreach_nlri.size();
-           i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->path_attributes.mp_unreach_nlri[i]},
-          types_.bgp4mp_update_withdraw_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
-      for (auto i = 0u;
-           i < update->network_layer_reachability_information.size(); i++) {
-        event e{{
-          vector{x.peer_ip_address,
-                 x.peer_as_number,
-                 update->network_layer_reachability_information[i],
-                 as_path,
-                 origin_as,
-                 update->path_attributes.origin,
-                 update->path_attributes.next_hop,
-                 update->path_attributes.local_pref,
-                 update->path_attributes.multi_exit_disc,
-                 communities,
-                 update->path_attributes.atomic_aggregate,
-                 update->path_attributes.aggregator_as,
-                 update->path_attributes.aggregator_ip},
-          types_.bgp4mp_update_announcement_type
-        }};
-        e.timestamp(timestamp_);
-        events_.push(e);
-      }
+      for (auto community : attributes.communities)
+        communities.push_back(count{community});
+      auto withdraw = [&](const subnet& prefix) {
+        emit_(timestamp_, types_.bgp4mp_update_withdraw_type,
+              vector{x.peer_ip_address,
+                     x.peer_as_number,
+                     prefix});
+      };
+      auto announce = [&](const subnet& prefix) {
+        emit_(timestamp_, types_.bgp4mp_update_announcement_type,
+              vector{x.peer_ip_address,
+                     x.peer_as_number,
+                     prefix,
+                     as_path,
+                     origin_as,
+                     attributes.origin,
+                     attributes.next_hop,
+                     attributes.local_pref,
+                     attributes.multi_exit_disc,
+                     communities,
+                     attributes.atomic_aggregate,
+                     attributes.aggregator_as,
+                     attributes.aggregator_ip});
+      };
+      for (auto& prefix : update->withdrawn_routes)
+        withdraw(prefix);
+      for (auto& prefix : attributes.mp_reach_nlri)
+        announce(prefix);
+      for (auto& prefix : attributes.mp_unreach_nlri)
+        withdraw(prefix);
+      for (auto& prefix : update->network_layer_reachability_information)
+        announce(prefix);
     } else if (auto notification =
                caf::get_if<bgp::notification>(&x.message.message)) {
-      event e{{
-        vector{notification->error_code,
-               notification->error_subcode},
-        types_.bgp4mp_notification_type
-      }};
-      e.timestamp(timestamp_);
-      events_.push(e);
+      emit_(timestamp_, types_.bgp4mp_notification_type,
+            vector{notification->error_code,
+                   notification->error_subcode});
     }
   }
 
-  void operator()(bgp4mp::state_change_as4& x) {
-    event e{{
-      vector{x.peer_ip_address,
-             x.peer_as_number,
-             x.old_state,
-             x.new_state},
-      types_.bgp4mp_state_change_type
-    }};
-    e.timestamp(timestamp_);
-    events_.push(e);
-  }
-
-  std::queue<event>& events_;
+  Emit& emit_;
   vast::timestamp timestamp_;
-  reader::types types_;
+  const reader::types& types_;
 };
 
+/// Parses the MRT record in `x` and hands its events to `emit`.
+template <class Emit>
+caf::error convert(const record_parser& parser, std::string_view x,
+                   const reader::types& types, Emit& emit) {
+  mrt::record r;
+  if (!parser(x, r))
+    return make_error(ec::parse_error, "failed to parse MRT message");
+  // Take the timestamp from the Common Header as event time.
+  factory<Emit> f{emit, types, r.header.timestamp};
+  caf::visit(f, r.message);
+  return caf::none;
+}
+
+/// Appends an event as row to `builder`.
+bool append(table_slice_builder& builder, timestamp ts, const vector& xs) {
+  if (!builder.add_unchecked(ts))
+    return false;
+  for (auto& x : xs)
+    if (!builder.add_unchecked(make_view(x)))
+      return false;
+  return true;
+}
+
 } // namespace anonymous
 
-reader::reader(std::unique_ptr<std::istream> input) : input_{std::move(input)} {
+reader::reader(std::unique_ptr<std::istream> input, size_t threads)
+  : input_{std::move(input)},
+    threads_{threads} {
   VAST_ASSERT(input_);
   types_.table_dump_v2_peer_entry_type = record_type{{
     {"index", count_type{}},
@@ -362,47 +256,196 @@ reader::reader(std::unique_ptr<std::istream> input) : input_{std::move(input)} {
 }
 
 expected<event> reader::read() {
-  if (!events_.empty()) {
-    auto x = std::move(events_.front());
-    events_.pop();
-    return x;
+  if (events_.empty()) {
+    auto x = next_record();
+    if (!x)
+      return x.error();
+    auto emit = [&](timestamp ts, const type& t, vector&& xs) {
+      event e{{std::move(xs), t}};
+      e.timestamp(ts);
+      events_.push(std::move(e));
+    };
+    if (auto err = convert(parser_, *x, types_, emit))
+      return err;
+    if (events_.empty())
+      return no_error;
+  }
+  auto x = std::move(events_.front());
+  events_.pop();
+  return x;
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  if (threads_ > 1)
+    return read_slices_parallel(max_events, max_slice_size, f);
+  size_t produced = 0;
+  auto emit = [&](timestamp ts, const type& layout, vector&& xs) {
+    auto bptr = builder(layout, max_slice_size);
+    VAST_ASSERT(bptr != nullptr);
+    if (!append(*bptr, ts, xs))
+      VAST_WARNING(this, "failed to add event of type", layout.name());
+    ++produced;
+    if (bptr->rows() == max_slice_size)
+      finish(f, *bptr);
+  };
+  while (produced < max_events) {
+    auto x = next_record();
+    if (!x) {
+      finish(f);
+      return {std::move(x.error()), produced};
+    }
+    if (auto err = convert(parser_, *x, types_, emit))
+      VAST_WARNING(this, err);
+  }
+  return {caf::none, produced};
+}
+
+std::pair<caf::error, size_t>
+reader::read_slices_parallel(size_t max_events, size_t max_slice_size,
+                             consumer& f) {
+  size_t produced = 0;
+  while (produced < max_events) {
+    // Collect the complete records of the current block. The views into the
+    // buffer remain valid until the next call to fill().
+    chunk_.clear();
+    while (chunk_.size() < threads_ * max_slice_size) {
+      auto x = buffered_record();
+      if (!x) {
+        finish(f);
+        return {std::move(x.error()), produced};
+      }
+      if (x->empty())
+        break;
+      chunk_.push_back(*x);
+    }
+    if (chunk_.empty()) {
+      if (auto err = fill()) {
+        finish(f);
+        return {std::move(err), produced};
+      }
+      continue;
+    }
+    // Parse a contiguous range of records per thread. Each thread fills its
+    // own builders, since a range can contain events of any layout.
+    auto num_threads = std::min(threads_, chunk_.size());
+    auto records_per_thread = (chunk_.size() + num_threads - 1) / num_threads;
+    std::vector<std::vector<std::pair<type, table_slice_ptr>>> slices(
+      num_threads);
+    std::vector<size_t> events(num_threads, 0);
+    auto parse = [&](size_t i) {
+      std::map<std::string, std::pair<type, table_slice_builder_ptr>> builders;
+      auto emit = [&](timestamp ts, const type& layout, vector&& xs) {
+        auto& [t, bptr] = builders[layout.name()];
+        if (bptr == nullptr) {
+          t = layout;
+          bptr = make_builder(layout);
+          VAST_ASSERT(bptr != nullptr);
+          bptr->reserve(max_slice_size);
+        }
+        if (!append(*bptr, ts, xs))
+          VAST_WARNING(this, "failed to add event of type", layout.name());
+        ++events[i];
+        if (bptr->rows() == max_slice_size)
+          slices[i].emplace_back(layout, bptr->finish());
+      };
+      auto first = i * records_per_thread;
+      auto last = std::min(chunk_.size(), first + records_per_thread);
+      for (auto j = first; j < last; ++j)
+        if (auto err = convert(parser_, chunk_[j], types_, emit))
+          VAST_WARNING(this, err);
+      for (auto& [name, x] : builders)
+        if (x.second->rows() > 0)
+          slices[i].emplace_back(std::move(x.first), x.second->finish());
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < num_threads; ++i)
+      workers.emplace_back(parse, i);
+    parse(0);
+    for (auto& worker : workers)
+      worker.join();
+    // Emit the slices in input order. Rows that follow partial slices of the
+    // same layout continue in the shared builders, so that slice sizes do not
+    // depend on where the thread ranges and blocks end.
+    for (size_t i = 0; i < num_threads; ++i) {
+      produced += events[i];
+      for (auto& [layout, slice] : slices[i]) {
+        if (slice == nullptr) {
+          VAST_ERROR(this, "failed to finish a slice");
+          continue;
+        }
+        auto bptr = builder(layout, max_slice_size);
+        VAST_ASSERT(bptr != nullptr);
+        if (bptr->rows() == 0 && slice->rows() == max_slice_size) {
+          f(std::move(slice));
+          continue;
+        }
+        for (table_slice::size_type row = 0; row < slice->rows(); ++row) {
+          for (table_slice::size_type col = 0; col < slice->columns(); ++col)
+            bptr->add_unchecked(slice->at(row, col));
+          if (bptr->rows() == max_slice_size)
+            finish(f, *bptr);
+        }
+      }
+    }
   }
-  // We have to read the input block-wise in a manner that respects the
-  // protocol framing.
-  static constexpr size_t common_header_length = 12;
-  if (buffer_.size() < common_header_length)
-    buffer_.resize(common_header_length);
-  input_->read(buffer_.data(), common_header_length);
-  if (input_->eof())
-    return make_error(ec::end_of_input, "reached end of input");
-  if (input_->fail())
-    return make_error(ec::format_error, "failed to read MRT common header");
-  auto ptr = reinterpret_cast<const uint32_t*>(buffer_.data() + 8);
-  auto message_length = vast::detail::to_host_order(*ptr);
-  // TODO: Where does the RFC specify the maximum length?
-  using namespace binary_byte_literals;
-  static constexpr size_t max_message_length = 1_MiB;
+  return {caf::none, produced};
+}
+
+expected<std::string_view> reader::buffered_record() {
+  auto available = buffer_end_ - buffer_begin_;
+  if (available < common_header_length)
+    return std::string_view{};
+  // The message length is the last field of the Common Header.
+  uint32_t message_length;
+  std::memcpy(&message_length, buffer_.data() + buffer_begin_ + 8,
+              sizeof(message_length));
+  message_length = vast::detail::to_host_order(message_length);
   if (message_length > max_message_length)
     return make_error(ec::format_error, "MRT message exceeds maximum length",
                       message_length, max_message_length);
-  buffer_.resize(common_header_length + message_length);
-  if (!input_->read(buffer_.data() + common_header_length, message_length))
-    return make_error(ec::format_error, "failed to read MRT message");
-  mrt::record r;
-  if (!parser_(buffer_, r))
-    return make_error(ec::format_error, "failed to parse MRT message");
-  // Convert
-  // Take the timestamp from the Common Header as event time.
-  visit(factory{events_, types_, r.header.timestamp}, r.message);
-  if (!events_.empty()) {
-    auto x = std::move(events_.front());
-    events_.pop();
-    return x;
+  auto size = common_header_length + message_length;
+  if (available < size)
+    return std::string_view{};
+  std::string_view result{buffer_.data() + buffer_begin_, size};
+  buffer_begin_ += size;
+  return result;
+}
+
+expected<std::string_view> reader::next_record() {
+  for (;;) {
+    auto x = buffered_record();
+    if (!x || !x->empty())
+      return x;
+    if (auto err = fill())
+      return err;
   }
-  return no_error;
 }
 
-expected<void> reader::schema(vast::schema const& sch) {
+caf::error reader::fill() {
+  VAST_ASSERT(input_);
+  auto remaining = buffer_end_ - buffer_begin_;
+  if (remaining > 0 && buffer_begin_ > 0)
+    std::memmove(buffer_.data(), buffer_.data() + buffer_begin_, remaining);
+  buffer_begin_ = 0;
+  buffer_end_ = remaining;
+  // A block always exceeds the maximum record size, so the buffer has room
+  // for the rest of a partial record.
+  if (buffer_.size() < remaining + block_size)
+    buffer_.resize(remaining + block_size);
+  input_->read(buffer_.data() + buffer_end_, buffer_.size() - buffer_end_);
+  auto n = static_cast<size_t>(input_->gcount());
+  buffer_end_ += n;
+  if (n > 0)
+    return caf::none;
+  if (!input_->eof())
+    return make_error(ec::format_error, "failed to read MRT input");
+  if (remaining > 0)
+    return make_error(ec::format_error, "truncated MRT record at end of input");
+  return make_error(ec::end_of_input, "reached end of input");
+}
+
+expected<void> reader::schema(vast::schema sch) {
   auto xs = {
     &types_.table_dump_v2_peer_entry_type,
     &types_.table_dump_v2_rib_entry_type,
@@ -13,17 +13,23 @@
 
 #include <netinet/in.h>
 
+#include <algorithm>
+#include <atomic>
 #include <thread>
+#include <vector>
 
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/filesystem.hpp"
 #include "vast/logger.hpp"
+#include "vast/table_slice_builder.hpp"
+#include "vast/view.hpp"
 
 #include "vast/format/pcap.hpp"
 
 #include "vast/detail/assert.hpp"
 #include "vast/detail/byte_swap.hpp"
+#include "vast/detail/spsc_queue.hpp"
 
 namespace vast {
 namespace format {
@@ -44,91 +50,245 @@ inline type make_packet_type() {
 
 static auto const pcap_packet_type = make_packet_type();
 
+// The kernel buffer for live captures, which absorbs bursts while the
+// capture thread waits for a free batch.
+constexpr int kernel_buffer_size = 64 << 20;
+
+// The time to wait for the capture thread when no batch is available.
+constexpr auto capture_poll_interval = std::chrono::milliseconds{1};
+
 } // namespace <anonymous>
 
 
+/// Batches of raw packets, filled by the capture thread and decoded by the
+/// reader. Both sides exchange batches through two lock-free queues: one for
+/// filled batches and one for recycling drained ones. Since the number of
+/// batches is fixed, the capture thread leaves packets in the kernel ring
+/// whenever the reader falls behind instead of allocating more memory.
+struct reader::capture {
+  struct batch {
+    std::vector<pcap_pkthdr> headers;
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> bytes;
+
+    void clear() {
+      headers.clear();
+      offsets.clear();
+      bytes.clear();
+    }
+  };
+
+  using batch_ptr = std::unique_ptr<batch>;
+
+  /// The maximum number of packets per `pcap_dispatch` call.
+  static constexpr int batch_size = 1024;
+
+  /// The number of batches in flight.
+  static constexpr size_t num_batches = 64;
+
+  explicit capture(pcap_t* handle)
+    : pcap{handle},
+      filled{num_batches},
+      recycled{num_batches} {
+    for (size_t i = 0; i < num_batches; ++i)
+      recycled.try_push(std::make_unique<batch>());
+    thread = std::thread{[this] { run(); }};
+  }
+
+  ~capture() {
+    stop = true;
+    ::pcap_breakloop(pcap);
+    thread.join();
+  }
+
+  static void append(u_char* user, const pcap_pkthdr* header,
+                     const u_char* data) {
+    auto b = reinterpret_cast<batch*>(user);
+    b->headers.push_back(*header);
+    b->offsets.push_back(b->bytes.size());
+    b->bytes.insert(b->bytes.end(), data, data + header->caplen);
+  }
+
+  void run() {
+    batch_ptr b;
+    while (!stop) {
+      if (b == nullptr && !recycled.try_pop(b)) {
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+        continue;
+      }
+      auto n = ::pcap_dispatch(pcap, batch_size, append,
+                               reinterpret_cast<u_char*>(b.get()));
+      if (n == -1)
+        error = ::pcap_geterr(pcap);
+      if (n < 0)
+        break;
+      if (!b->headers.empty()) {
+        // There exist only num_batches batches, so this always succeeds.
+        auto pushed = filled.try_push(std::move(b));
+        VAST_ASSERT(pushed);
+        VAST_UNUSED(pushed);
+      }
+    }
+    done.store(true, std::memory_order_release);
+  }
+
+  // -- shared state -----------------------------------------------------------
+
+  pcap_t* pcap;
+  detail::spsc_queue<batch_ptr> filled;
+  detail::spsc_queue<batch_ptr> recycled;
+  std::atomic<bool> stop{false};
+  std::atomic<bool> done{false};
+  std::string error; // written before setting done
+
+  // -- reader state -----------------------------------------------------------
+
+  batch_ptr current;
+  size_t position = 0;
+
+  // -- capture thread ---------------------------------------------------------
+
+  std::thread thread;
+};
+
+void reader::pcap_deleter::operator()(pcap_t* x) const {
+  ::pcap_close(x);
+}
+
 reader::reader(std::string input, uint64_t cutoff, size_t max_flows,
                size_t max_age, size_t expire_interval,
                int64_t pseudo_realtime)
   : packet_type_{pcap_packet_type},
+    flows_{std::max(max_flows, size_t{1})},
     cutoff_{cutoff},
-    max_flows_{max_flows},
     max_age_{max_age},
     expire_interval_{expire_interval},
     pseudo_realtime_{pseudo_realtime},
     input_{std::move(input)} {
 }
 
+reader::reader(reader&&) = default;
+
+reader& reader::operator=(reader&&) = default;
+
 reader::~reader() {
-  if (pcap_)
-    ::pcap_close(pcap_);
+  // Stop the capture thread before closing its handle.
+  capture_ = nullptr;
 }
 
-expected<event> reader::read() {
+caf::error reader::open() {
+  if (pcap_)
+    return caf::none;
   char buf[PCAP_ERRBUF_SIZE]; // for errors.
-  if (!pcap_) {
-    // Determine interfaces.
-    pcap_if_t* iface;
-    if (::pcap_findalldevs(&iface, buf) == -1)
-      return make_error(ec::format_error,
-                        "failed to enumerate interfaces: ", buf);
-    for (auto i = iface; i != nullptr; i = i->next)
-      if (input_ == i->name) {
-        pcap_ = ::pcap_open_live(i->name, 65535, 1, 1000, buf);
-        if (!pcap_) {
-          ::pcap_freealldevs(iface);
-          return make_error(ec::format_error, "failed to open interface ",
-                            input_, ": ", buf);
-        }
-        if (pseudo_realtime_ > 0) {
-          pseudo_realtime_ = 0;
-          VAST_WARNING(this, "ignores pseudo-realtime in live mode");
-        }
-        VAST_DEBUG(this, "listens on interface " << i->name);
-        break;
+  // Determine interfaces.
+  pcap_if_t* iface;
+  if (::pcap_findalldevs(&iface, buf) == -1)
+    return make_error(ec::format_error,
+                      "failed to enumerate interfaces: ", buf);
+  for (auto i = iface; i != nullptr; i = i->next)
+    if (input_ == i->name) {
+      pcap_.reset(::pcap_create(i->name, buf));
+      if (!pcap_) {
+        ::pcap_freealldevs(iface);
+        return make_error(ec::format_error, "failed to open interface ",
+                          input_, ": ", buf);
       }
-    ::pcap_freealldevs(iface);
-    if (!pcap_) {
-      if (input_ != "-" && !exists(input_))
-        return make_error(ec::format_error, "no such file: ", input_);
+      ::pcap_set_snaplen(pcap_.get(), 65535);
+      ::pcap_set_promisc(pcap_.get(), 1);
+      ::pcap_set_timeout(pcap_.get(), 1000);
+      ::pcap_set_buffer_size(pcap_.get(), kernel_buffer_size);
+      if (auto r = ::pcap_activate(pcap_.get()); r < 0) {
+        auto err = std::string{::pcap_geterr(pcap_.get())};
+        pcap_ = nullptr;
+        ::pcap_freealldevs(iface);
+        return make_error(ec::format_error, "failed to activate interface ",
+                          input_, ": ", err);
+      }
+      if (pseudo_realtime_ > 0) {
+        pseudo_realtime_ = 0;
+        VAST_WARNING(this, "ignores pseudo-realtime in live mode");
+      }
+      VAST_DEBUG(this, "listens on interface " << i->name);
+      capture_ = std::make_unique<capture>(pcap_.get());
+      break;
+    }
+  ::pcap_freealldevs(iface);
+  if (!pcap_) {
+    if (input_ != "-" && !exists(input_))
+      return make_error(ec::format_error, "no such file: ", input_);
 #ifdef PCAP_TSTAMP_PRECISION_NANO
-      pcap_ = ::pcap_open_offline_with_tstamp_precision(
-        input_.c_str(), PCAP_TSTAMP_PRECISION_NANO, buf);
+    pcap_.reset(::pcap_open_offline_with_tstamp_precision(
+      input_.c_str(), PCAP_TSTAMP_PRECISION_NANO, buf));
 #else
-      pcap_ = ::pcap_open_offline(input_.c_str(), buf);
+    pcap_.reset(::pcap_open_offline(input_.c_str(), buf));
 #endif
-      if (!pcap_) {
-        flows_.clear();
-        return make_error(ec::format_error, "failed to open pcap file ",
-                          input_, ": ", std::string{buf});
+    if (!pcap_) {
+      return make_error(ec::format_error, "failed to open pcap file ",
+                        input_, ": ", std::string{buf});
+    }
+    VAST_DEBUG(this, "reads trace from", input_);
+    if (pseudo_realtime_ > 0)
+      VAST_DEBUG(this, "uses pseudo-realtime factor 1/" << pseudo_realtime_);
+  }
+  VAST_DEBUG(this, "cuts off flows after", cutoff_,
+                  "bytes in each direction");
+  VAST_DEBUG(this, "keeps at most", flows_.capacity(), "concurrent flows");
+  VAST_DEBUG(this, "evicts flows after", max_age_ << "s of inactivity");
+  VAST_DEBUG(this, "expires flow table every", expire_interval_ << "s");
+  return caf::none;
+}
+
+expected<bool> reader::next(const pcap_pkthdr*& header,
+                            const uint8_t*& data) {
+  if (capture_) {
+    auto& c = *capture_;
+    while (c.current == nullptr || c.position == c.current->headers.size()) {
+      if (c.current != nullptr) {
+        c.current->clear();
+        c.recycled.try_push(std::move(c.current));
+        c.current = nullptr;
+      }
+      // Read the flag before polling the queue, so that we cannot miss the
+      // last batch.
+      auto done = c.done.load(std::memory_order_acquire);
+      if (!c.filled.try_pop(c.current)) {
+        if (!done)
+          return false;
+        if (!c.error.empty())
+          return make_error(ec::format_error, "failed to capture packets: ",
+                            c.error);
+        return make_error(ec::end_of_input, "capture stopped");
       }
-      VAST_DEBUG(this, "reads trace from", input_);
-      if (pseudo_realtime_ > 0)
-        VAST_DEBUG(this, "uses pseudo-realtime factor 1/" << pseudo_realtime_);
+      c.position = 0;
     }
-    VAST_DEBUG(this, "cuts off flows after", cutoff_,
-                    "bytes in each direction");
-    VAST_DEBUG(this, "keeps at most", max_flows_, "concurrent flows");
-    VAST_DEBUG(this, "evicts flows after", max_age_ << "s of inactivity");
-    VAST_DEBUG(this, "expires flow table every", expire_interval_ << "s");
+    header = &c.current->headers[c.position];
+    data = c.current->bytes.data() + c.current->offsets[c.position];
+    ++c.position;
+    return true;
   }
-  const uint8_t* data;
-  pcap_pkthdr* header;
-  auto r = ::pcap_next_ex(pcap_, &header, &data);
+  pcap_pkthdr* hdr;
+  auto r = ::pcap_next_ex(pcap_.get(), &hdr, &data);
   if (r == 0)
-    return no_error; // Attempt to fetch next packet timed out.
-  if (r == -2) {
+    return false; // Attempt to fetch next packet timed out.
+  if (r == -2)
     return make_error(ec::end_of_input, "reached end of trace");
-  }
   if (r == -1) {
-    auto err = std::string{::pcap_geterr(pcap_)};
-    ::pcap_close(pcap_);
+    auto err = std::string{::pcap_geterr(pcap_.get())};
     pcap_ = nullptr;
     return make_error(ec::format_error, "failed to get next packet: ", err);
   }
+  header = hdr;
+  return true;
+}
+
+expected<bool> reader::decode(const pcap_pkthdr& header, const uint8_t* data,
+                              packet& result) {
+  if (header.caplen < 14)
+    return make_error(ec::parse_error, "packet too short");
   // Parse packet.
-  connection conn;
-  auto packet_size = header->len - 14;
+  auto& conn = result.conn;
+  conn = {};
+  auto packet_size = header.len - 14;
   auto layer3 = data + 14;
   const uint8_t* layer4 = nullptr;
   uint8_t layer4_proto = 0;
@@ -136,14 +296,18 @@ expected<event> reader::read() {
   uint64_t payload_size = packet_size;
   switch (detail::to_host_order(layer2_type)) {
     default:
-      return no_error; // Skip all non-IP packets.
+      return false; // Skip all non-IP packets.
     case 0x0800: {
-      if (header->len < 14 + 20)
-        return make_error(ec::format_error, "IPv4 header too short");
+      if (header.caplen < 14 + 20)
+        return make_error(ec::parse_error, "IPv4 header too short");
       size_t header_size = (*layer3 & 0x0f) * 4;
       if (header_size < 20)
-        return make_error(ec::format_error, "IPv4 header too short: ",
+        return make_error(ec::parse_error, "IPv4 header too short: ",
                           header_size, " bytes");
+      if (header.caplen < 14 + header_size)
+        return make_error(ec::parse_error, "IPv4 header truncated: ",
+                          header.caplen - 14, " of ", header_size,
+                          " bytes captured");
       auto orig_h = reinterpret_cast<const uint32_t*>(layer3 + 12);
       auto resp_h = reinterpret_cast<const uint32_t*>(layer3 + 16);
       conn.src = {orig_h, address::ipv4, address::network};
@@ -153,8 +317,8 @@ expected<event> reader::read() {
       payload_size -= header_size;
     } break;
     case 0x86dd: {
-      if (header->len < 14 + 40)
-        return make_error(ec::format_error, "IPv6 header too short");
+      if (header.caplen < 14 + 40)
+        return make_error(ec::parse_error, "IPv6 header too short");
       auto orig_h = reinterpret_cast<const uint32_t*>(layer3 + 8);
       auto resp_h = reinterpret_cast<const uint32_t*>(layer3 + 24);
       conn.src = {orig_h, address::ipv4, address::network};
@@ -164,8 +328,19 @@ expected<event> reader::read() {
       payload_size -= 40;
     } break;
   }
+  // The transport headers must lie within the captured bytes, which can end
+  // early for truncated or snaplen-limited packets.
+  auto captured_layer4 = size_t{header.caplen} - (layer4 - data);
+  auto check_layer4 = [&](const char* proto, size_t size) -> caf::error {
+    if (captured_layer4 < size)
+      return make_error(ec::parse_error, proto, " header truncated: ",
+                        captured_layer4, " of ", size, " bytes captured");
+    return caf::none;
+  };
   if (layer4_proto == IPPROTO_TCP) {
     VAST_ASSERT(layer4);
+    if (auto err = check_layer4("TCP", 20))
+      return err;
     auto orig_p = *reinterpret_cast<const uint16_t*>(layer4);
     auto resp_p = *reinterpret_cast<const uint16_t*>(layer4 + 2);
     orig_p = detail::to_host_order(orig_p);
@@ -176,6 +351,8 @@ expected<event> reader::read() {
     payload_size -= data_offset * 4;
   } else if (layer4_proto == IPPROTO_UDP) {
     VAST_ASSERT(layer4);
+    if (auto err = check_layer4("UDP", 8))
+      return err;
     auto orig_p = *reinterpret_cast<const uint16_t*>(layer4);
     auto resp_p = *reinterpret_cast<const uint16_t*>(layer4 + 2);
     orig_p = detail::to_host_order(orig_p);
@@ -185,6 +362,8 @@ expected<event> reader::read() {
     payload_size -= 8;
   } else if (layer4_proto == IPPROTO_ICMP) {
     VAST_ASSERT(layer4);
+    if (auto err = check_layer4("ICMP", 8))
+      return err;
     auto message_type = *reinterpret_cast<const uint8_t*>(layer4);
     auto message_code = *reinterpret_cast<const uint8_t*>(layer4 + 1);
     conn.sport = {message_type, port::icmp};
@@ -192,17 +371,16 @@ expected<event> reader::read() {
     payload_size -= 8; // TODO: account for variable-size data.
   }
   // Parse packet timestamp
-  uint64_t packet_time = header->ts.tv_sec;
+  uint64_t packet_time = header.ts.tv_sec;
   if (last_expire_ == 0)
     last_expire_ = packet_time;
-  auto i = flows_.find(conn);
-  if (i == flows_.end())
-    i = flows_.emplace(conn, connection_state{0, packet_time}).first;
-  else
-    i->second.last = packet_time;
-  auto& flow_size = i->second.bytes;
+  // Adding a flow to a full table evicts the least recently active one.
+  auto [state, added] = flows_.get_or_add(conn, {0, packet_time});
+  if (!added)
+    state->last = packet_time;
+  auto& flow_size = state->bytes;
   if (flow_size == cutoff_)
-    return no_error; // Skip cut off packets.
+    return false; // Skip cut off packets.
   if (flow_size + payload_size <= cutoff_) {
     flow_size += payload_size;
   } else {
@@ -210,52 +388,26 @@ expected<event> reader::read() {
     packet_size -= flow_size + payload_size - cutoff_;
     flow_size = cutoff_;
   }
-  // Evict all elements that have been inactive for a while.
+  // Evict all flows that have been inactive for a while. The table keeps its
+  // entries in order of activity, so this only visits the evicted flows.
   if (packet_time - last_expire_ > expire_interval_) {
     last_expire_ = packet_time;
-    auto i = flows_.begin();
-    while (i != flows_.end())
-      if (packet_time - i->second.last > max_age_)
-        i = flows_.erase(i);
-      else
-        ++i;
-  }
-  // If the flow table gets too large, we evict a random element.
-  if (!flows_.empty() && flows_.size() % max_flows_ == 0) {
-    auto buckets = flows_.bucket_count();
-    auto unif1 = std::uniform_int_distribution<size_t>{0, buckets - 1};
-    auto bucket = unif1(generator_);
-    auto bucket_size = flows_.bucket_size(bucket);
-    while (bucket_size == 0) {
-      ++bucket;
-      bucket %= buckets;
-      bucket_size = flows_.bucket_size(bucket);
-    }
-    auto unif2 = std::uniform_int_distribution<size_t>{0, bucket_size - 1};
-    auto offset = unif2(generator_);
-    VAST_ASSERT(offset < bucket_size);
-    auto begin = flows_.begin(bucket);
-    std::advance(begin, offset);
-    flows_.erase(begin->first);
+    flows_.evict_while([&](const connection&, const connection_state& x) {
+      return packet_time - x.last > max_age_;
+    });
   }
-  // Assemble packet.
-  vector packet;
-  vector meta;
-  meta.emplace_back(std::move(conn.src));
-  meta.emplace_back(std::move(conn.dst));
-  meta.emplace_back(std::move(conn.sport));
-  meta.emplace_back(std::move(conn.dport));
-  packet.emplace_back(std::move(meta));
-  // We start with the network layer and skip the link layer.
+  // We start with the network layer and skip the link layer. The payload
+  // cannot exceed the captured bytes.
   auto str = reinterpret_cast<const char*>(data + 14);
-  packet.emplace_back(std::string{str, packet_size});
+  auto captured = size_t{header.caplen} - 14;
+  result.payload = {str, std::min(size_t{packet_size}, captured)};
   using namespace std::chrono;
-  auto secs = seconds(header->ts.tv_sec);
+  auto secs = seconds(header.ts.tv_sec);
   auto ts = timestamp{duration_cast<timespan>(secs)};
 #ifdef PCAP_TSTAMP_PRECISION_NANO
-  ts += nanoseconds(header->ts.tv_usec);
+  ts += nanoseconds(header.ts.tv_usec);
 #else
-  ts += microseconds(header->ts.tv_usec);
+  ts += microseconds(header.ts.tv_usec);
 #endif
   if (pseudo_realtime_ > 0) {
     if (ts < last_timestamp_) {
@@ -269,11 +421,80 @@ expected<event> reader::read() {
     }
     last_timestamp_ = ts;
   }
+  result.ts = ts;
+  return true;
+}
+
+expected<event> reader::read() {
+  if (auto err = open())
+    return err;
+  const pcap_pkthdr* header;
+  const uint8_t* data;
+  auto x = next(header, data);
+  if (!x)
+    return x.error();
+  if (!*x)
+    return no_error;
+  packet pkt;
+  auto y = decode(*header, data, pkt);
+  if (!y)
+    return y.error();
+  if (!*y)
+    return no_error;
+  // Assemble packet.
+  vector packet;
+  vector meta;
+  meta.emplace_back(std::move(pkt.conn.src));
+  meta.emplace_back(std::move(pkt.conn.dst));
+  meta.emplace_back(std::move(pkt.conn.sport));
+  meta.emplace_back(std::move(pkt.conn.dport));
+  packet.emplace_back(std::move(meta));
+  packet.emplace_back(std::string{pkt.payload});
   event e{{std::move(packet), packet_type_}};
-  e.timestamp(ts);
+  e.timestamp(pkt.ts);
   return e;
 }
 
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  if (auto err = open())
+    return {std::move(err), 0};
+  auto bptr = builder(packet_type_, max_slice_size);
+  VAST_ASSERT(bptr != nullptr);
+  size_t produced = 0;
+  packet pkt;
+  while (produced < max_events) {
+    const pcap_pkthdr* header;
+    const uint8_t* data;
+    auto x = next(header, data);
+    if (!x) {
+      finish(f);
+      return {std::move(x.error()), produced};
+    }
+    if (!*x) {
+      // Wait for the capture thread to hand over the next batch.
+      std::this_thread::sleep_for(capture_poll_interval);
+      continue;
+    }
+    auto y = decode(*header, data, pkt);
+    if (!y) {
+      VAST_WARNING(this, y.error());
+      continue;
+    }
+    if (!*y)
+      continue;
+    // The builder flattens the packet type, so the meta fields and the
+    // payload follow the timestamp column directly.
+    if (!bptr->add_row(pkt.ts, pkt.conn.src, pkt.conn.dst, pkt.conn.sport,
+                       pkt.conn.dport, pkt.payload))
+      VAST_WARNING(this, "failed to add packet");
+    ++produced;
+    if (bptr->rows() == max_slice_size)
+      finish(f, *bptr);
+  }
+  return {caf::none, produced};
+}
+
 expected<void> reader::schema(vast::schema sch) {
   return replace_if_congruent({&packet_type_}, sch);
 }
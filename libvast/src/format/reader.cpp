@@ -13,10 +13,102 @@
 
 #include "vast/format/reader.hpp"
 
+#include "vast/default_table_slice.hpp"
+#include "vast/detail/overload.hpp"
+#include "vast/error.hpp"
+#include "vast/event.hpp"
+#include "vast/logger.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/type.hpp"
+
 namespace vast::format {
 
 reader::~reader() {
   // nop
 }
 
+std::pair<caf::error, size_t>
+reader::read_slices(size_t max_events, size_t max_slice_size, consumer& f) {
+  size_t produced = 0;
+  while (produced < max_events) {
+    auto e = read();
+    if (!e) {
+      // Try again when receiving default-generated errors.
+      if (!e.error())
+        continue;
+      // Skip bogus input that failed to parse.
+      if (e.error() == ec::parse_error) {
+        VAST_WARNING(this, e.error());
+        continue;
+      }
+      finish(f);
+      return {std::move(e.error()), produced};
+    }
+    auto bptr = builder(e->type(), max_slice_size);
+    if (bptr == nullptr)
+      continue;
+    if (auto ts = e->timestamp(); !bptr->add(ts))
+      VAST_WARNING(this, "failed to add timestamp", ts);
+    if (auto& xs = e->data(); !bptr->recursive_add(xs, e->type()))
+      VAST_WARNING(this, "failed to add data", xs);
+    ++produced;
+    if (bptr->rows() == max_slice_size)
+      finish(f, *bptr);
+  }
+  return {caf::none, produced};
+}
+
+void reader::factory(factory_type f) {
+  factory_ = f;
+  builders_.clear();
+}
+
+table_slice_builder_ptr reader::make_builder(const type& layout) const {
+  return caf::visit(
+    detail::overload(
+      [&](const record_type& rt) -> table_slice_builder_ptr {
+        // We always add a timestamp as first column to the layout.
+        auto internal = rt;
+        record_field tstamp_field{"timestamp", timestamp_type{}};
+        internal.fields.insert(internal.fields.begin(),
+                               std::move(tstamp_field));
+        auto make = factory_ != nullptr ? factory_
+                                        : default_table_slice::make_builder;
+        return make(std::move(internal));
+      },
+      [&](auto&) -> table_slice_builder_ptr {
+        VAST_ERROR(this, layout.name(), "is not a record type");
+        return nullptr;
+      }),
+    layout);
+}
+
+table_slice_builder* reader::builder(const type& layout,
+                                     size_t max_slice_size) {
+  auto i = builders_.find(layout.name());
+  if (i != builders_.end())
+    return i->second.get();
+  auto ptr = make_builder(layout);
+  if (ptr == nullptr)
+    return nullptr;
+  ptr->reserve(max_slice_size);
+  auto& ref = builders_[layout.name()];
+  ref = std::move(ptr);
+  return ref.get();
+}
+
+void reader::finish(consumer& f, table_slice_builder& x) {
+  auto slice = x.finish();
+  if (slice == nullptr)
+    VAST_ERROR(this, "failed to finish a slice");
+  else
+    f(std::move(slice));
+}
+
+void reader::finish(consumer& f) {
+  for (auto& kvp : builders_)
+    if (kvp.second != nullptr && kvp.second->rows() > 0)
+      finish(f, *kvp.second);
+}
+
 } // namespace vast::format
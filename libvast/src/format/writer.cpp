@@ -13,12 +13,27 @@
 
 #include "vast/format/writer.hpp"
 
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/event.hpp"
+#include "vast/ids.hpp"
+#include "vast/to_events.hpp"
+
 namespace vast::format {
 
 writer::~writer() {
   // nop
 }
 
+caf::expected<void> writer::write(const table_slice& slice,
+                                  const ids& selection) {
+  if (!any<1>(selection))
+    return caf::no_error;
+  for (auto& x : to_events(slice, selection))
+    if (auto r = write(x); !r)
+      return r;
+  return caf::no_error;
+}
+
 caf::expected<void> writer::flush() {
   return caf::no_error;
 }
@@ -27,4 +42,19 @@ void writer::cleanup() {
   // nop
 }
 
+std::vector<table_slice::size_type>
+writer::selected_rows(const table_slice& slice, const ids& selection) {
+  std::vector<table_slice::size_type> result;
+  auto begin = slice.offset();
+  auto end = begin + slice.rows();
+  auto rng = select(selection);
+  if (!rng)
+    return result;
+  if (rng.get() < begin)
+    rng.next_from(begin);
+  for ( ; rng && rng.get() < end; rng.next())
+    result.push_back(rng.get() - begin);
+  return result;
+}
+
 } // namespace vast::format
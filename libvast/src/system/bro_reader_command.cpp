@@ -0,0 +1,54 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#include "vast/system/bro_reader_command.hpp"
+
+#include <vector>
+
+#include <caf/actor_system.hpp>
+
+#include "vast/defaults.hpp"
+#include "vast/detail/make_io_stream.hpp"
+#include "vast/format/bro.hpp"
+#include "vast/logger.hpp"
+#include "vast/system/source.hpp"
+#include "vast/system/source_command.hpp"
+
+namespace vast::system {
+
+caf::message bro_reader_command(const command& cmd, caf::actor_system& sys,
+                                caf::config_value_map& options,
+                                command::argument_iterator first,
+                                command::argument_iterator last) {
+  VAST_TRACE(VAST_ARG(options), VAST_ARG("args", first, last));
+  auto inputs = source_inputs(options);
+  if (!inputs)
+    return caf::make_message(std::move(inputs.error()));
+  auto uds = get_or(options, "uds", false);
+  auto threads = get_or(options, "threads", defaults::command::parser_threads);
+  std::vector<format::bro::reader> readers;
+  for (auto& input : *inputs) {
+    auto in = detail::make_input_stream(input, uds);
+    if (!in)
+      return caf::make_message(std::move(in.error()));
+    readers.emplace_back(std::move(*in), threads);
+  }
+  std::vector<caf::actor> srcs;
+  for (auto& reader : readers)
+    srcs.push_back(sys.spawn(default_source<format::bro::reader>,
+                             std::move(reader)));
+  return source_command(cmd, sys, std::move(srcs), options, first, last);
+}
+
+} // namespace vast::system
@@ -11,6 +11,12 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
 #include <caf/all.hpp>
 
 #include "vast/concept/parseable/numeric/integral.hpp"
@@ -26,6 +32,7 @@
 #include "vast/system/consensus.hpp"
 
 #include "vast/detail/assert.hpp"
+#include "vast/detail/byte_swap.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/detail/string.hpp"
 
@@ -35,26 +42,69 @@ namespace vast {
 namespace system {
 namespace raft {
 
-log::log(caf::actor_system& sys, path dir) : dir_{std::move(dir)}, sys_(sys) {
+namespace {
+
+// Each entry in a segment has a header with the size of the serialized entry
+// in network byte order.
+constexpr size_t record_header_size = sizeof(uint32_t);
+
+} // namespace <anonymous>
+
+log::log(caf::actor_system& sys, path dir, size_t segment_size)
+  : segment_size_{segment_size},
+    dir_{std::move(dir)},
+    sys_(sys) {
   auto meta_filename = dir_ / "meta";
+  auto segments_dir = dir_ / "segments";
   auto entries_filename = dir_ / "entries";
   if (exists(dir_)) {
     if (exists(meta_filename))
       if (load(sys_, meta_filename, start_))
         die("failed to load raft log meta data");
+    if (exists(segments_dir)) {
+      for (auto& filename : directory{segments_dir}) {
+        index_type first;
+        if (!parsers::u64(filename.basename().str(), first))
+          die("invalid raft log segment name: " + filename.str());
+        segments_.push_back(segment{first, {}, 0});
+      }
+      std::sort(segments_.begin(), segments_.end(),
+                [](auto& x, auto& y) { return x.first < y.first; });
+      for (size_t i = 0; i < segments_.size(); ++i) {
+        auto last = i + 1 == segments_.size();
+        if (auto res = load_segment(segments_[i], last); !res)
+          die("failed to load raft log segment: " + sys_.render(res.error()));
+      }
+    }
+    // Migrate the single entries file of earlier versions. If we crashed
+    // during a previous migration, the segments already hold the entries.
     if (exists(entries_filename)) {
-      std::ifstream entries{entries_filename.str(), std::ios::binary};
-      while (entries.peek() != std::ifstream::traits_type::eof()) {
+      if (segments_.empty()) {
         std::vector<log_entry> xs;
-        if (load(sys_, entries, xs))
-          die("failed to load raft log entries");
-        std::move(xs.begin(), xs.end(), std::back_inserter(entries_));
+        std::ifstream entries{entries_filename.str(), std::ios::binary};
+        while (entries.peek() != std::ifstream::traits_type::eof()) {
+          std::vector<log_entry> ys;
+          if (load(sys_, entries, ys))
+            die("failed to load raft log entries");
+          std::move(ys.begin(), ys.end(), std::back_inserter(xs));
+        }
+        if (!append(std::move(xs)) || !persist())
+          die("failed to migrate raft log entries");
       }
+      rm(entries_filename);
     }
   } else {
     if (!mkdir(dir_))
       die("failed to create raft log directory");
   }
+  persisted_ = last_index();
+  if (!segments_.empty() && !open_last_segment())
+    die("failed to open raft log segment");
+}
+
+log::~log() {
+  persist();
+  segment_file_.close();
 }
 
 log_entry& log::first() {
@@ -75,6 +125,10 @@ index_type log::last_index() const {
   return start_ + entries_.size() - 1;
 }
 
+index_type log::last_persisted_index() const {
+  return persisted_;
+}
+
 index_type log::truncate_before(index_type index) {
   if (index <= start_)
     return 0; // already truncated
@@ -82,11 +136,15 @@ index_type log::truncate_before(index_type index) {
   if (n > 0) {
     entries_.erase(entries_.begin(), entries_.begin() + n);
     start_ += n;
-    // Persists meta data and entries.
+    persisted_ = std::max(persisted_, start_ - 1);
     if (!persist_meta_data())
       die("failed to persist log meta data");
-    if (!persist_entries())
-      die("failed to persist log entries");
+    // Delete all segments that hold truncated entries only. We keep the last
+    // segment in any case, because it receives new entries.
+    while (segments_.size() > 1 && segments_[1].first <= start_) {
+      rm(segment_filename(segments_.front().first));
+      segments_.pop_front();
+    }
   }
   return n;
 }
@@ -100,8 +158,36 @@ index_type log::truncate_after(index_type index) {
   VAST_ASSERT(new_size <= old_size);
   if (new_size < old_size) {
     entries_.resize(new_size);
-    if (!persist_entries())
-      die("failed to persist log entries");
+    auto next = index + 1;
+    // Delete all segments that begin after the cut. Pending entries always
+    // belong to the last segment.
+    while (!segments_.empty() && segments_.back().first >= next) {
+      pending_.clear();
+      segment_file_.close();
+      rm(segment_filename(segments_.back().first));
+      segments_.pop_back();
+    }
+    if (!segments_.empty()) {
+      if (!segment_file_.is_open() && !open_last_segment())
+        die("failed to open raft log segment");
+      // Cut the segment at the first removed entry.
+      auto& seg = segments_.back();
+      auto k = next - seg.first;
+      if (k < seg.offsets.size()) {
+        auto cut = seg.offsets[k];
+        auto on_disk = seg.size - pending_.size();
+        if (cut >= on_disk) {
+          pending_.resize(cut - on_disk);
+        } else {
+          pending_.clear();
+          if (!segment_file_.truncate(cut) || !segment_file_.sync())
+            die("failed to truncate raft log segment");
+        }
+        seg.offsets.resize(k);
+        seg.size = cut;
+      }
+    }
+    persisted_ = std::min(persisted_, index);
   }
   return old_size - new_size;
 }
@@ -113,28 +199,48 @@ log_entry& log::at(index_type i) {
 }
 
 expected<void> log::append(std::vector<log_entry> xs) {
-  // Allocate persistent state on first entry.
-  if (!entries_file_.is_open()) {
-    auto entries_filename = dir_ / "entries";
-    auto flags = std::ios::app | std::ios::binary | std::ios::ate;
-    entries_file_.open(entries_filename.str(), flags);
-    if (!entries_file_)
-      return make_error(ec::filesystem_error, "failed to open log entry file");
-    if (!exists(dir_ / "meta")) {
-      auto res = persist_meta_data();
-      if (!res)
+  std::vector<char> buf;
+  for (auto& x : xs) {
+    // Start a new segment when the current one is full.
+    if (segments_.empty() || segments_.back().size >= segment_size_) {
+      if (auto res = persist(); !res)
+        return res;
+      segments_.push_back(segment{last_index() + 1, {}, 0});
+      segment_file_.close();
+      if (auto res = open_last_segment(); !res)
         return res;
+      if (!exists(dir_ / "meta"))
+        if (auto res = persist_meta_data(); !res)
+          return res;
     }
+    // Serialize the entry into the pending buffer...
+    buf.clear();
+    caf::binary_serializer bs{sys_, buf};
+    if (auto err = bs(x))
+      return err;
+    auto size = detail::to_network_order(
+      detail::narrow_cast<uint32_t>(buf.size()));
+    auto& seg = segments_.back();
+    seg.offsets.push_back(seg.size);
+    seg.size += record_header_size + buf.size();
+    auto ptr = reinterpret_cast<const char*>(&size);
+    pending_.insert(pending_.end(), ptr, ptr + record_header_size);
+    pending_.insert(pending_.end(), buf.begin(), buf.end());
+    // ...and keep it around until the next persist.
+    entries_.push_back(std::move(x));
   }
-  // Serialize the entries...
-  if (auto err =  save(sys_, entries_file_, xs))
-    return err;
-  // ...and make them persistent...
-  entries_file_.flush();
-  if (!entries_file_)
-    return make_error(ec::filesystem_error, "bad log entry file");
-  // ...before keeping 'em.
-  std::move(xs.begin(), xs.end(), std::back_inserter(entries_));
+  return {};
+}
+
+expected<void> log::persist() {
+  if (!pending_.empty()) {
+    if (!segment_file_.write(pending_.data(), pending_.size()))
+      return make_error(ec::filesystem_error, "failed to write log segment");
+    if (!segment_file_.sync())
+      return make_error(ec::filesystem_error, "failed to sync log segment");
+    pending_.clear();
+  }
+  persisted_ = last_index();
   return {};
 }
 
@@ -143,21 +249,75 @@ bool log::empty() const {
 }
 
 uint64_t bytes(log& l) {
-  auto pos = l.entries_file_.tellp();
-  if (pos == -1)
-    return 0;
-  return static_cast<uint64_t>(pos);
+  auto f = [](uint64_t x, auto& seg) { return x + seg.size; };
+  return std::accumulate(l.segments_.begin(), l.segments_.end(), uint64_t{0},
+                         f);
 }
 
-expected<void> log::persist_meta_data() {
-  if (auto err = save(sys_, dir_ / "meta", start_))
-    return err;
-  return caf::unit;
+path log::segment_filename(index_type first) const {
+  return dir_ / "segments" / std::to_string(first);
+}
+
+expected<void> log::load_segment(segment& seg, bool last) {
+  auto filename = segment_filename(seg.first);
+  auto contents = load_contents(filename);
+  if (!contents)
+    return contents.error();
+  auto& buf = *contents;
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    log_entry entry;
+    auto size = size_t{0};
+    if (buf.size() - pos >= record_header_size) {
+      uint32_t n;
+      std::memcpy(&n, buf.data() + pos, sizeof(n));
+      n = detail::to_host_order(n);
+      if (buf.size() - pos - record_header_size >= n) {
+        caf::binary_deserializer bd{sys_, buf.data() + pos + record_header_size,
+                                    n};
+        if (!bd(entry))
+          size = record_header_size + n;
+      }
+    }
+    if (size == 0) {
+      // Only the last segment can end in an incomplete write, which stems from
+      // a crash during persist. We never acknowledged these entries.
+      if (!last)
+        return make_error(ec::format_error, "corrupt raft log segment",
+                          filename.str());
+      VAST_WARNING_ANON("raft log discards", buf.size() - pos,
+                        "bytes of an incomplete write in", filename.str());
+      file f{filename};
+      if (auto res = f.open(file::write_only); !res)
+        return res;
+      auto truncated = f.truncate(pos) && f.sync();
+      f.close();
+      if (!truncated)
+        return make_error(ec::filesystem_error, "failed to truncate",
+                          filename.str());
+      break;
+    }
+    auto index = seg.first + seg.offsets.size();
+    seg.offsets.push_back(pos);
+    pos += size;
+    if (index < start_)
+      continue;
+    if (index != start_ + entries_.size())
+      return make_error(ec::format_error, "raft log segments not contiguous");
+    entries_.push_back(std::move(entry));
+  }
+  seg.size = pos;
+  return {};
 }
 
-expected<void> log::persist_entries() {
-  entries_file_.close();
-  if (auto err = save(sys_, dir_ / "entries", entries_))
+expected<void> log::open_last_segment() {
+  VAST_ASSERT(!segments_.empty());
+  segment_file_ = file{segment_filename(segments_.back().first)};
+  return segment_file_.open(file::write_only, true);
+}
+
+expected<void> log::persist_meta_data() {
+  if (auto err = save(sys_, dir_ / "meta", start_))
     return err;
   return caf::unit;
 }
@@ -242,6 +402,14 @@ peer_state* current_peer(Actor* self) {
   return &*p;
 }
 
+// Retrieves the peer state for a given peer ID.
+template <class Actor>
+peer_state* find_peer(Actor* self, server_id id) {
+  auto f = [=](auto& x) { return x.id == id; };
+  auto p = std::find_if(self->state.peers.begin(), self->state.peers.end(), f);
+  return p == self->state.peers.end() ? nullptr : &*p;
+}
+
 // Picks a election timeout uniformly at random from [T, T * 2], where T is the
 // configured election timeout.
 template <class Actor>
@@ -261,11 +429,11 @@ void reset_election_time(Actor* self) {
   self->delayed_send(self, timeout, election_atom::value);
 }
 
-// Saves a state machine snapshot that represents all the applied state up to a
-// given index.
+// Begins writing a state machine snapshot that represents all the applied
+// state up to a given index. The state machine then supplies the snapshot in
+// one or more chunks.
 template <class Actor>
-result<index_type> save_snapshot(Actor* self, index_type index,
-                                 const std::vector<char>& snapshot) {
+expected<void> begin_snapshot(Actor* self, index_type index) {
   VAST_DEBUG(role(self), "creates snapshot of indices [1,", index << ']');
   VAST_ASSERT(index > 0);
   if (index == self->state.last_snapshot_index)
@@ -290,13 +458,56 @@ result<index_type> save_snapshot(Actor* self, index_type index,
   // operations at the same time.
   if (self->state.snapshot.is_open())
     return make_error(ec::unspecified, "snapshot delivery in progress");
-  // Write snapshot to file.
+  // Write the header to a temporary file, which replaces the current snapshot
+  // when complete. A previous unfinished snapshot gets discarded.
+  auto& out = self->state.pending_snapshot;
+  if (out.is_open())
+    out.close();
+  auto filename = self->state.dir / "snapshot.tmp";
+  out.open(filename.str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to open", filename);
   snapshot_header hdr;
   hdr.last_included_index = index;
   hdr.last_included_term = self->state.log->at(index).term;
-  if (auto err = save(self->system(), self->state.dir / "snapshot",
-                      hdr, snapshot))
+  if (auto err = save(self->system(), out, hdr))
     return err;
+  self->state.pending_snapshot_header = hdr;
+  return {};
+}
+
+// Appends a chunk to the snapshot in progress.
+template <class Actor>
+expected<void> append_snapshot(Actor* self, const std::vector<char>& chunk) {
+  auto& out = self->state.pending_snapshot;
+  if (!out.is_open())
+    return make_error(ec::unspecified, "no snapshot in progress");
+  out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to write snapshot chunk");
+  return {};
+}
+
+// Completes the snapshot in progress and truncates the log entries it covers.
+template <class Actor>
+result<index_type> finish_snapshot(Actor* self) {
+  auto& out = self->state.pending_snapshot;
+  if (!out.is_open())
+    return make_error(ec::unspecified, "no snapshot in progress");
+  out.close();
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to write snapshot");
+  auto& hdr = self->state.pending_snapshot_header;
+  auto index = hdr.last_included_index;
+  // A snapshot from the leader may have superseded ours in the meantime.
+  if (index <= self->state.last_snapshot_index)
+    return make_error(ec::unspecified, "discards snapshot at index", index,
+                      "that is older than current snapshot at index",
+                      self->state.last_snapshot_index);
+  auto tmp = self->state.dir / "snapshot.tmp";
+  auto filename = self->state.dir / "snapshot";
+  if (std::rename(tmp.str().c_str(), filename.str().c_str()) != 0)
+    return make_error(ec::filesystem_error, "failed to rename", tmp);
   VAST_DEBUG(role(self), "completed snapshotting, last included term =",
              hdr.last_included_term << ", index =", hdr.last_included_index);
   VAST_ASSERT(self->state.log->first_index() <= hdr.last_included_index);
@@ -310,6 +521,17 @@ result<index_type> save_snapshot(Actor* self, index_type index,
   return index;
 }
 
+// Saves a state machine snapshot in one piece.
+template <class Actor>
+result<index_type> save_snapshot(Actor* self, index_type index,
+                                 const std::vector<char>& snapshot) {
+  if (auto res = begin_snapshot(self, index); !res)
+    return res.error();
+  if (auto res = append_snapshot(self, snapshot); !res)
+    return res.error();
+  return finish_snapshot(self);
+}
+
 // Loads a snapshot header into memory and adapts the server state accordingly.
 template <class Actor>
 expected<void> load_snapshot_header(Actor* self) {
@@ -318,8 +540,9 @@ expected<void> load_snapshot_header(Actor* self) {
   // Read snapshot header from filesystem.
   if (auto err = load(self->system(), self->state.dir / "snapshot", hdr))
     return err;
-  if (hdr.version != 1)
-    return make_error(ec::version_error, "needed version 1, got", hdr.version);
+  if (hdr.version != 1 && hdr.version != 2)
+    return make_error(ec::version_error, "needed version 1 or 2, got",
+                      hdr.version);
   if (hdr.last_included_index < self->state.last_snapshot_index)
     return make_error(ec::unspecified, "stale snapshot");
   // Update actor state.
@@ -346,12 +569,27 @@ expected<void> load_snapshot_header(Actor* self) {
 template <class Actor>
 expected<std::vector<char>> load_snapshot_data(Actor* self) {
   VAST_DEBUG(role(self), "loads snapshot data");
+  auto filename = self->state.dir / "snapshot";
+  std::ifstream in{filename.str(), std::ios::binary};
+  if (!in)
+    return make_error(ec::filesystem_error, "failed to open", filename);
   snapshot_header hdr;
   std::vector<char> data;
-  if (auto err = load(self->system(), self->state.dir / "snapshot", hdr, data))
+  if (auto err = load(self->system(), in, hdr))
     return err;
-  if (hdr.version != 1)
-    return make_error(ec::version_error, "needed version 1, got", hdr.version);
+  switch (hdr.version) {
+    default:
+      return make_error(ec::version_error, "needed version 1 or 2, got",
+                        hdr.version);
+    case 1:
+      if (auto err = load(self->system(), in, data))
+        return err;
+      break;
+    case 2:
+      data.assign(std::istreambuf_iterator<char>{in},
+                  std::istreambuf_iterator<char>{});
+      break;
+  }
   return data;
 }
 
@@ -397,9 +635,12 @@ void deliver(Actor* self, index_type from, index_type to) {
 template <class Actor>
 void advance_commit_index(Actor* self) {
   VAST_ASSERT(is_leader(self));
-  auto last_index = self->state.log->last_index();
+  // The leader only votes for entries that it has made persistent.
+  auto last_index = self->state.log->last_persisted_index();
   // Without peers, we can adjust the commit index directly.
   if (self->state.peers.empty()) {
+    if (last_index <= self->state.commit_index)
+      return;
     VAST_DEBUG(role(self), "advances commitIndex", self->state.commit_index,
                "->", last_index);
     deliver(self, self->state.commit_index + 1, last_index);
@@ -427,7 +668,10 @@ void advance_commit_index(Actor* self) {
     return;
   VAST_DEBUG(role(self), "advances commitIndex", self->state.commit_index,
              "->", index);
-  VAST_ASSERT(index <= last_index);
+  // Followers may acknowledge entries that we appended but did not yet
+  // persist, so a majority of followers can carry the index beyond our own
+  // vote. The entries still exist in our in-memory log.
+  VAST_ASSERT(index <= self->state.log->last_index());
   deliver(self, self->state.commit_index + 1, index);
   self->state.commit_index = index;
 }
@@ -462,11 +706,15 @@ void become_leader(Actor* self) {
     peer.next_index = self->state.log->last_index() + 1;
     peer.match_index = 0;
     peer.last_snapshot_index = 0;
+    peer.inflight = 0;
+    peer.probing = true;
   }
   // (A no-op entry has an index of 0 and no data in our implementation.)
   log_entry entry;
   entry.term = self->state.current_term;
   auto res = self->state.log->append({std::move(entry)});
+  if (res)
+    res = self->state.log->persist();
   if (!res) {
     VAST_ERROR(role(self), "failed to append no-op entry:",
                self->system().render(res.error()));
@@ -760,6 +1008,9 @@ auto handle_install_snapshot(Actor* self, install_snapshot::request& req) {
   return resp;
 }
 
+template <class Actor>
+void replicate_entries(Actor* self, peer_state& peer);
+
 template <class Actor>
 auto send_append_entries(Actor* self, peer_state& peer) {
   // Find the previous index for this peer.
@@ -803,6 +1054,10 @@ auto send_append_entries(Actor* self, peer_state& peer) {
   VAST_IGNORE_UNUSED(peer_id);
   VAST_DEBUG(role(self), "sends AppendEntries request to peer", peer_id,
              "with", num_entries, "entries");
+  // Assume that the peer accepts the entries, such that the next request can
+  // go out before this one returns.
+  peer.next_index += num_entries;
+  ++peer.inflight;
   // Send request away and process response.
   self->request(peer.peer, request_timeout, req).then(
     [=](const append_entries::response& resp) {
@@ -820,27 +1075,60 @@ auto send_append_entries(Actor* self, peer_state& peer) {
         return;
       }
       VAST_ASSERT(resp.term == self->state.current_term);
-      if (auto p = current_peer(self)) {
+      if (auto p = find_peer(self, peer_id)) {
+        if (p->inflight > 0)
+          --p->inflight;
         if (resp.success) {
-          if (p->match_index > prev_log_index + num_entries) {
-            VAST_WARNING(role(self), "got nonmonotonic matchIndex with a term");
-          } else {
+          p->probing = false;
+          if (p->match_index < prev_log_index + num_entries) {
             p->match_index = prev_log_index + num_entries;
             advance_commit_index(self);
           }
-          p->next_index = p->match_index + 1;
-        } else {
-          if (p->next_index > 1)
-            --p->next_index;
+          p->next_index = std::max(p->next_index, p->match_index + 1);
+        } else if (prev_log_index < p->next_index) {
+          // Back off from the index of this request, unless we already did so
+          // for an earlier request in the pipeline.
+          p->probing = true;
+          p->next_index = std::max(index_type{1}, prev_log_index);
           if (p->next_index > resp.last_log_index + 1)
             p->next_index = resp.last_log_index + 1;
         }
         VAST_DEBUG(role(self), "now has peer's next index at", p->next_index);
+        replicate_entries(self, *p);
+      }
+    },
+    [=](const error& err) {
+      VAST_IGNORE_UNUSED(err);
+      VAST_DEBUG(role(self), "got no AppendEntries response from peer",
+                 peer_id << ':', self->system().render(err));
+      if (req_term != self->state.current_term)
+        return;
+      // The peer may not have received the entries we optimistically
+      // accounted for, so we fall back to probing from the last known match.
+      if (auto p = find_peer(self, peer_id)) {
+        if (p->inflight > 0)
+          --p->inflight;
+        p->next_index = p->match_index + 1;
+        p->probing = true;
       }
     }
   );
 }
 
+// Sends the entries a peer is missing unless the peer has the maximum number
+// of requests in flight. Leaves snapshots to the heartbeat.
+template <class Actor>
+void replicate_entries(Actor* self, peer_state& peer) {
+  if (!is_leader(self) || !peer.peer || peer.snapshot)
+    return;
+  if (peer.next_index > self->state.log->last_index()
+      || peer.next_index < self->state.log->first_index())
+    return;
+  auto limit = peer.probing ? size_t{1} : max_inflight_append_entries;
+  if (peer.inflight < limit)
+    send_append_entries(self, peer);
+}
+
 template <class Actor>
 result<append_entries::response>
 handle_append_entries(Actor* self, append_entries::request& req) {
@@ -908,6 +1196,11 @@ handle_append_entries(Actor* self, append_entries::request& req) {
     }
     VAST_DEBUG(role(self), "appended", n, "entries to log");
   }
+  // Make the entries persistent before acknowledging them.
+  if (auto res = self->state.log->persist(); !res) {
+    VAST_ERROR(role(self), "failed to persist log entries");
+    return res.error();
+  }
   resp.last_log_index = self->state.log->last_index();
   if (self->state.commit_index < req.commit_index) {
     deliver(self, self->state.commit_index + 1, req.commit_index);
@@ -983,6 +1276,19 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
       //                     "not enough commited entries to snapshot");
       return save_snapshot(self, index, snapshot);
     },
+    // Chunked variant of the above: the first chunk begins and the last one
+    // completes the snapshot.
+    [=](snapshot_atom, index_type index, const std::vector<char>& chunk,
+        bool first, bool last) -> result<index_type> {
+      if (first)
+        if (auto res = begin_snapshot(self, index); !res)
+          return res.error();
+      if (auto res = append_snapshot(self, chunk); !res)
+        return res.error();
+      if (last)
+        return finish_snapshot(self);
+      return index;
+    },
     [=](peer_atom, const actor& peer, server_id peer_id) {
       VAST_DEBUG(role(self), "re-activates peer", peer_id);
       VAST_ASSERT(peer_id != 0);
@@ -992,12 +1298,32 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
       VAST_ASSERT(i != self->state.peers.end()); // currently no config changes
       VAST_ASSERT(!i->peer); // must have been deactivated via DOWN message.
       i->peer = peer;
+      i->inflight = 0;
+      i->probing = true;
       if (is_leader(self) && !self->state.heartbeat_inflight) {
         VAST_DEBUG(role(self), "kicks off heartbeat");
         self->send(self, heartbeat_atom::value);
         self->state.heartbeat_inflight = true;
       }
     },
+    // Group commit of the entries a leader appended since the last persist.
+    [=](persist_atom) {
+      self->state.persist_inflight = false;
+      auto res = self->state.log->persist();
+      if (!res) {
+        VAST_ERROR(role(self), "failed to persist log entries:",
+                   self->system().render(res.error()));
+        self->quit(res.error());
+        return;
+      }
+      if (is_leader(self)) {
+        advance_commit_index(self);
+        // Replicate the new entries right away instead of waiting for the
+        // next heartbeat.
+        for (auto& peer : self->state.peers)
+          replicate_entries(self, peer);
+      }
+    },
     // When the state machine initializes, it will obtain the latest state
     // through this handler.
     [=](subscribe_atom, const actor& state_machine) {
@@ -1038,8 +1364,10 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
         VAST_DEBUG(role(self), "cancels heartbeat loop (no peers)");
         return;
       }
+      // Peers with requests in flight already hear from us. Idle peers get a
+      // request with the entries they miss, which is empty when up to date.
       for (auto& peer : self->state.peers)
-        if (peer.peer)
+        if (peer.peer && peer.inflight == 0)
           send_append_entries(self, peer);
       self->delayed_send(self, heartbeat_period, heartbeat_atom::value);
       self->state.heartbeat_inflight = true;
@@ -1061,9 +1389,12 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
                    self->system().render(res.error()));
         return res.error();
       }
-      // Without peers, we can commit the entry immediately.
-      if (self->state.peers.empty())
-        advance_commit_index(self);
+      // Persist the entry together with all other commands that are already
+      // waiting in our mailbox.
+      if (!self->state.persist_inflight) {
+        self->send(self, persist_atom::value);
+        self->state.persist_inflight = true;
+      }
       return ok_atom::value;
     }
   }.or_else(common);
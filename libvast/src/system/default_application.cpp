@@ -22,6 +22,7 @@
 #include "vast/format/mrt.hpp"
 #include "vast/format/test.hpp"
 #include "vast/system/application.hpp"
+#include "vast/system/bro_reader_command.hpp"
 #include "vast/system/configuration.hpp"
 #include "vast/system/generator_command.hpp"
 #include "vast/system/reader_command.hpp"
@@ -34,6 +35,10 @@
 #include "vast/system/pcap_writer_command.hpp"
 #endif
 
+#ifdef VAST_HAVE_ARROW
+#include "vast/format/arrow.hpp"
+#endif
+
 namespace vast::system {
 
 default_application::default_application() {
@@ -63,10 +68,16 @@ default_application::default_application() {
                   .add<bool>("blocking,b",
                              "block until the IMPORTER forwarded all data")
                   .add(backend_opt));
-  import_->add(reader_command<format::bro::reader>, "bro",
-               "imports Bro logs from STDIN or file", src_opts());
+  import_->add(bro_reader_command, "bro",
+               "imports Bro logs from STDIN or file",
+               src_opts().add<size_t>("threads,t",
+                                      "number of threads parsing log lines"));
+  import_->add(reader_command<format::json::reader>, "json",
+               "imports JSON with schema from STDIN or file", src_opts());
   import_->add(reader_command<format::mrt::reader>, "mrt",
-               "imports MRT logs from STDIN or file", src_opts());
+               "imports MRT logs from STDIN or file",
+               src_opts().add<size_t>("threads,t",
+                                      "number of threads parsing MRT records"));
   import_->add(reader_command<format::bgpdump::reader>, "bgpdump",
                "imports BGPdump logs from STDIN or file", src_opts());
   import_->add(generator_command<format::test::reader>, "test",
@@ -111,6 +122,13 @@ default_application::default_application() {
       .add<std::string>("write,w", "path to write events to")
       .add<bool>("uds,d", "treat -w as UNIX domain socket to connect to")
       .add<size_t>("flush,f", "flush to disk after this many packets"));
+#endif
+  // Add Arrow import and export commands when compiling with Arrow enabled.
+#ifdef VAST_HAVE_ARROW
+  import_->add(reader_command<format::arrow::reader>, "arrow",
+               "imports Arrow IPC streams from STDIN or file", src_opts());
+  export_->add(writer_command<format::arrow::writer>, "arrow",
+               "exports query results in Arrow IPC format", snk_opts());
 #endif
 }
 
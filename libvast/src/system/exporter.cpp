@@ -18,6 +18,8 @@
 #include "vast/concept/printable/vast/event.hpp"
 #include "vast/concept/printable/vast/expression.hpp"
 #include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/default_table_slice.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/event.hpp"
 #include "vast/expression_visitors.hpp"
@@ -40,31 +42,119 @@ namespace system {
 
 namespace {
 
-void ship_results(stateful_actor<exporter_state>* self) {
-  VAST_TRACE("");
-  if (self->state.results.empty() || self->state.stats.requested == 0) {
+// Copies the rows [first, first + n) of a slice into a new slice.
+table_slice_ptr copy_rows(const table_slice& slice,
+                          table_slice::size_type first,
+                          table_slice::size_type n) {
+  auto builder = default_table_slice::make_builder(slice.layout());
+  for (auto row = first; row < first + n; ++row)
+    for (table_slice::size_type col = 0; col < slice.columns(); ++col)
+      builder->add(slice.at(row, col));
+  auto result = builder->finish();
+  result->offset(slice.offset() + first);
+  return result;
+}
+
+// Turns the events accumulated in the builder into a result slice.
+void finish_results(stateful_actor<exporter_state>* self) {
+  auto& st = self->state;
+  if (st.builder == nullptr || st.builder->rows() == 0)
     return;
+  auto slice = st.builder->finish();
+  if (slice == nullptr) {
+    VAST_ERROR(self, "failed to finish a result slice");
+    return;
+  }
+  slice->offset(st.builder_offset);
+  st.buffered += slice->rows();
+  st.results.push_back(std::move(slice));
+}
+
+// Adds a matching event to the results. The ARCHIVE replies with events, so
+// we rebuild slices from them row by row; handing out the archived slices
+// along with a selection would avoid the copy but needs a new ARCHIVE API.
+void add_result(stateful_actor<exporter_state>* self, const event& x) {
+  auto& st = self->state;
+  if (st.builder != nullptr) {
+    // A slice covers a contiguous range of IDs, hence we start a new slice
+    // whenever the IDs of the results have a gap.
+    if (x.type() != st.builder_type) {
+      finish_results(self);
+      st.builder = nullptr;
+    } else if (x.id() != st.builder_offset + st.builder->rows()
+               || st.builder->rows() >= defaults::system::table_slice_size) {
+      finish_results(self);
+    }
   }
-  VAST_INFO(self, "relays", self->state.results.size(), "events");
-  message msg;
-  if (self->state.results.size() <= self->state.stats.requested) {
-    self->state.stats.requested -= self->state.results.size();
-    self->state.stats.shipped += self->state.results.size();
-    msg = make_message(std::move(self->state.results));
-    self->state.results = {};
-  } else {
-    std::vector<event> remainder;
-    remainder.reserve(self->state.results.size() - self->state.stats.requested);
-    auto begin = self->state.results.begin() + self->state.stats.requested;
-    auto end = self->state.results.end();
-    std::move(begin, end, std::back_inserter(remainder));
-    self->state.results.resize(self->state.stats.requested);
-    msg = make_message(std::move(self->state.results));
-    self->state.results = std::move(remainder);
-    self->state.stats.shipped += self->state.stats.requested;
-    self->state.stats.requested = 0;
+  if (st.builder == nullptr) {
+    auto rt = caf::get_if<record_type>(&x.type());
+    if (rt == nullptr) {
+      VAST_WARNING(self, "ignores result with non-record type",
+                   x.type().name());
+      return;
+    }
+    // Results get the same layout as in the archive, i.e., with the
+    // timestamp as first column.
+    auto layout = *rt;
+    layout.fields.insert(layout.fields.begin(),
+                         record_field{"timestamp", timestamp_type{}});
+    st.builder = default_table_slice::make_builder(std::move(layout));
+    st.builder_type = x.type();
+  }
+  if (st.builder->rows() == 0)
+    st.builder_offset = x.id();
+  if (!st.builder->add(x.timestamp())
+      || !st.builder->recursive_add(x.data(), x.type()))
+    VAST_ERROR(self, "failed to add result", x.id());
+}
+
+// Moves up to `num` result slices into the stream, without exceeding the
+// number of requested events.
+template <class Downstream>
+size_t ship_results(stateful_actor<exporter_state>* self, Downstream& out,
+                    size_t num) {
+  auto& st = self->state;
+  size_t shipped = 0;
+  while (shipped < num && !st.results.empty() && st.stats.requested > 0) {
+    auto slice = std::move(st.results.front());
+    st.results.pop_front();
+    st.buffered -= slice->rows();
+    if (slice->rows() > st.stats.requested) {
+      // Keep the events beyond the requested ones for later.
+      auto n = static_cast<table_slice::size_type>(st.stats.requested);
+      auto rest = copy_rows(*slice, n, slice->rows() - n);
+      st.buffered += rest->rows();
+      st.results.push_front(std::move(rest));
+      slice = copy_rows(*slice, 0, n);
+    }
+    st.stats.requested -= slice->rows();
+    st.stats.shipped += slice->rows();
+    out.push(std::move(slice));
+    ++shipped;
+  }
+  if (shipped > 0)
+    VAST_DEBUG(self, "relays", shipped, "result slices");
+  return shipped;
+}
+
+// Ships results right away if the sinks have credit left.
+void push_results(stateful_actor<exporter_state>* self) {
+  auto& st = self->state;
+  if (auto n = st.mgr->out().capacity(); n > 0)
+    if (ship_results(self, st.mgr->out(), n) > 0)
+      st.mgr->push();
+}
+
+// Sends queued index hits to the archive while the results fit into the
+// buffer.
+void dispatch_lookups(stateful_actor<exporter_state>* self) {
+  auto& st = self->state;
+  while (!st.lookups.empty() && st.buffered < st.max_buffered) {
+    VAST_DEBUG(self, "forwards hits to archive");
+    st.scheduler.lookup_sent(rank(st.lookups.front()), steady_clock::now());
+    self->send(st.archive, std::move(st.lookups.front()));
+    st.lookups.pop_front();
   }
-  self->send(self->state.sink, msg);
 }
 
 void report_statistics(stateful_actor<exporter_state>* self) {
@@ -76,7 +166,7 @@ void report_statistics(stateful_actor<exporter_state>* self) {
     auto hits = rank(self->state.hits);
     auto processed = self->state.stats.processed;
     auto shipped = self->state.stats.shipped;
-    auto results = shipped + self->state.results.size();
+    auto results = shipped + self->state.buffered;
     auto selectivity = double(results) / hits;
     self->send(self->state.accountant, "exporter.hits", hits);
     self->send(self->state.accountant, "exporter.processed", processed);
@@ -101,24 +191,22 @@ void shutdown(stateful_actor<exporter_state>* self) {
 }
 
 void request_more_hits(stateful_actor<exporter_state>* self) {
-  if (!has_historical_option(self->state.options))
+  auto& st = self->state;
+  if (!has_historical_option(st.options))
     return;
-  auto waiting_for_hits =
-    self->state.stats.received == self->state.stats.scheduled;
-  auto need_more_results = self->state.stats.requested > 0;
-  auto have_no_inflight_requests = any<1>(self->state.unprocessed);
-  // If we're (1) no longer waiting for index hits, (2) still need more
-  // results, and (3) have no inflight requests to the archive, we ask
-  // the index for more hits.
-  if (!waiting_for_hits && need_more_results && have_no_inflight_requests) {
-    auto remaining = self->state.stats.expected - self->state.stats.received;
-    VAST_ASSERT(remaining > 0);
-    // TODO: Figure out right number of partitions to ask for. For now, we
-    // bound the number by an arbitrary constant.
-    auto n = std::min(remaining, size_t{2});
-    VAST_DEBUG(self, "asks index to process", n, "more partitions");
-    self->send(self->state.index, self->state.id, n);
-  }
+  // The sinks take no more than the requested results, and the buffer
+  // bounds the results we hold for them.
+  auto wanted = st.stats.requested - std::min(st.stats.requested,
+                                              uint64_t{st.buffered});
+  auto space = st.max_buffered - std::min(st.max_buffered, st.buffered);
+  auto n = st.scheduler.next(std::min(wanted, uint64_t{space}));
+  if (n == 0)
+    return;
+  VAST_DEBUG(self, "asks index to process", n, "more partitions at",
+             st.scheduler.hits_per_partition(), "hits per partition");
+  st.scheduler.schedule(n, steady_clock::now());
+  st.stats.scheduled += n;
+  self->send(st.index, st.id, n);
 }
 
 } // namespace <anonymous>
@@ -151,6 +239,29 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         report_statistics(self);
     }
   );
+  // Stream results to the sinks. The sinks grant credit as they write, and
+  // the exporter stops pulling once results pile up in its buffer.
+  self->state.mgr = self->make_continuous_source(
+    // init
+    [](unit_t&) {
+      // nop
+    },
+    // get next element
+    [=](unit_t&, downstream<table_slice_ptr>& out, size_t num) {
+      auto& st = self->state;
+      if (ship_results(self, out, num) == 0)
+        return;
+      // Resume pulling now that the sinks caught up.
+      dispatch_lookups(self);
+      request_more_hits(self);
+      if (st.stats.expected > 0 && st.stats.received == st.stats.expected)
+        shutdown(self);
+    },
+    // done?
+    [](const unit_t&) {
+      return false;
+    }
+  );
   auto handle_batch = [=](std::vector<event>& candidates) {
     VAST_DEBUG(self, "got batch of", candidates.size(), "events");
     // Events can arrive in any order: sort them by ID first. Otherwise, we
@@ -158,6 +269,7 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
     std::sort(candidates.begin(), candidates.end(),
               [](auto& x, auto& y) { return x.id() < y.id(); });
     bitmap mask;
+    uint64_t matched = 0;
     auto sender = self->current_sender();
     for (auto& candidate : candidates) {
       auto& checker = self->state.checkers[candidate.type()];
@@ -167,7 +279,8 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         if (!x) {
           VAST_ERROR(self, "failed to tailor expression:",
                      self->system().render(x.error()));
-          ship_results(self);
+          finish_results(self);
+          push_results(self);
           self->send_exit(self, exit_reason::normal);
           return;
         }
@@ -180,15 +293,21 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         mask.append_bit(true);
       }
       // Perform candidate check and keep event as result on success.
-      if (caf::visit(event_evaluator{candidate}, checker))
-        self->state.results.push_back(std::move(candidate));
-      else
+      if (caf::visit(event_evaluator{candidate}, checker)) {
+        add_result(self, candidate);
+        ++matched;
+      } else {
         VAST_DEBUG(self, "ignores false positive:", candidate);
+      }
     }
     self->state.stats.processed += candidates.size();
-    if (sender == self->state.archive)
+    if (sender == self->state.archive) {
       self->state.unprocessed -= mask;
-    ship_results(self);
+      self->state.scheduler.lookup_done(candidates.size(), matched,
+                                        steady_clock::now());
+    }
+    finish_results(self);
+    push_results(self);
     request_more_hits(self);
     if (self->state.stats.received == self->state.stats.expected)
       shutdown(self);
@@ -210,12 +329,13 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       if (count > 0) {
         self->state.hits |= hits;
         self->state.unprocessed |= hits;
-        VAST_DEBUG(self, "forwards hits to archive");
         // FIXME: restrict according to configured limit.
-        self->send(self->state.archive, std::move(hits));
+        self->state.lookups.push_back(std::move(hits));
+        dispatch_lookups(self);
       }
       // Figure out if we're done.
       ++self->state.stats.received;
+      self->state.scheduler.partition_done(count, steady_clock::now());
       self->send(self->state.sink, self->state.id, self->state.stats);
       if (self->state.stats.received < self->state.stats.expected) {
         VAST_DEBUG(self, "received", self->state.stats.received << '/'
@@ -238,7 +358,7 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         return;
       }
       self->state.stats.requested = max_events;
-      ship_results(self);
+      push_results(self);
       request_more_hits(self);
     },
     [=](extract_atom, uint64_t requested) {
@@ -250,7 +370,7 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       self->state.stats.requested += n;
       VAST_DEBUG(self, "got request to extract", n, "new events in addition to",
                  self->state.stats.requested, "pending results");
-      ship_results(self);
+      push_results(self);
       request_more_hits(self);
     },
     [=](const archive_type& archive) {
@@ -269,6 +389,7 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       VAST_DEBUG(self, "registers sink", sink);
       self->send(self->state.sink, sys_atom::value, put_atom::value, sink);
       self->monitor(self->state.sink);
+      self->state.mgr->add_outbound_path(sink);
     },
     [=](importer_atom, const std::vector<actor>& importers) {
       // Register for events at running IMPORTERs.
@@ -289,6 +410,9 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
           if (partitions > 0) {
             self->state.stats.expected = partitions;
             self->state.stats.scheduled = scheduled;
+            self->state.scheduler.start(partitions, scheduled,
+                                        steady_clock::now());
+            request_more_hits(self);
           } else {
             shutdown(self);
           }
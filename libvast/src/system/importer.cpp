@@ -13,7 +13,12 @@
 
 #include "vast/system/importer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <limits>
+#include <sstream>
 
 #include <caf/config_value.hpp>
 #include <caf/dictionary.hpp>
@@ -21,6 +26,8 @@
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/error.hpp"
 #include "vast/concept/printable/vast/filesystem.hpp"
+#include "vast/error.hpp"
+#include "vast/detail/byte_swap.hpp"
 #include "vast/detail/fill_status_map.hpp"
 #include "vast/logger.hpp"
 #include "vast/system/atoms.hpp"
@@ -32,6 +39,42 @@ using namespace caf;
 
 namespace vast::system {
 
+namespace {
+
+// The importer journals ID ranges as fixed-size binary records: a tag byte
+// followed by the first and the last ID of the range in network byte order.
+enum journal_tag : char {
+  lease_record = 1,     // A range we received from the meta store.
+  available_record = 2, // A range we did not use before shutting down.
+  end_record = 3        // Completes a checkpoint of available ranges.
+};
+
+constexpr size_t journal_record_size = 1 + 2 * sizeof(uint64_t);
+
+// Number of ID blocks we acquire per replenish at least.
+constexpr size_t min_blocks_per_replenish = 100;
+
+// A lease should last for about this long at the current ingest rate.
+constexpr auto lease_duration = 10s;
+
+void append(std::ofstream& out, journal_tag tag, id first, id last) {
+  char buf[journal_record_size];
+  buf[0] = tag;
+  auto x = detail::to_network_order(static_cast<uint64_t>(first));
+  auto y = detail::to_network_order(static_cast<uint64_t>(last));
+  std::memcpy(buf + 1, &x, sizeof(x));
+  std::memcpy(buf + 1 + sizeof(x), &y, sizeof(y));
+  out.write(buf, sizeof(buf));
+}
+
+uint64_t read_id(const char* ptr) {
+  uint64_t x;
+  std::memcpy(&x, ptr, sizeof(x));
+  return detail::to_host_order(x);
+}
+
+} // namespace <anonymous>
+
 importer_state::importer_state(event_based_actor* self_ptr) : self(self_ptr) {
   // nop
 }
@@ -43,10 +86,16 @@ importer_state::~importer_state() {
 caf::error importer_state::read_state() {
   VAST_TRACE("");
   id_generators.clear();
-  auto file = dir / "available_ids";
-  if (exists(file)) {
-    VAST_DEBUG(self, "reads persistent state from", to_string(file));
-    std::ifstream available{to_string(file)};
+  if (!exists(dir)) {
+    auto result = mkdir(dir);
+    if (!result)
+      return std::move(result.error());
+  }
+  // Migrate the text file of earlier versions.
+  auto legacy = dir / "available_ids";
+  if (exists(legacy)) {
+    VAST_DEBUG(self, "reads persistent state from", to_string(legacy));
+    std::ifstream available{to_string(legacy)};
     std::string line;
     while (std::getline(available, line)) {
       id i;
@@ -57,33 +106,100 @@ caf::error importer_state::read_state() {
         id_generators.emplace_back(i, last);
       } else {
         VAST_ERROR(self, "got an invalidly formatted persistence file:",
-                   to_string(file));
+                   to_string(legacy));
         return ec::parse_error;
       }
     }
   }
+  auto file = dir / "id_journal";
+  if (exists(file)) {
+    VAST_DEBUG(self, "reads persistent state from", to_string(file));
+    auto contents = load_contents(file);
+    if (!contents)
+      return std::move(contents.error());
+    // Only a journal that ends in a complete checkpoint stems from a clean
+    // shutdown. Otherwise, we cannot know which IDs we handed out after the
+    // last checkpoint and must discard all ranges, because reusing an ID is
+    // worse than skipping some.
+    std::vector<id_generator> checkpoint;
+    std::vector<id_generator> pending;
+    id leased = 0;
+    auto clean = false;
+    auto n = contents->size() / journal_record_size * journal_record_size;
+    for (size_t i = 0; i < n; i += journal_record_size) {
+      auto ptr = contents->data() + i;
+      auto first = read_id(ptr + 1);
+      auto last = read_id(ptr + 1 + sizeof(uint64_t));
+      if (first > last) {
+        VAST_ERROR(self, "got an invalid ID range in", to_string(file));
+        return ec::parse_error;
+      }
+      switch (ptr[0]) {
+        default:
+          VAST_ERROR(self, "got an invalid journal record in",
+                     to_string(file));
+          return ec::parse_error;
+        case lease_record:
+          leased += last - first;
+          clean = false;
+          break;
+        case available_record:
+          pending.emplace_back(first, last);
+          clean = false;
+          break;
+        case end_record:
+          checkpoint = std::move(pending);
+          pending.clear();
+          clean = true;
+          break;
+      }
+    }
+    if (clean && n == contents->size()) {
+      for (auto& g : checkpoint) {
+        VAST_DEBUG(self, "found ID range:", g.i, "to", g.last);
+        id_generators.push_back(g);
+      }
+    } else if (!contents->empty()) {
+      VAST_WARNING(self, "discards", leased,
+                   "leased IDs after an unclean shutdown");
+    }
+  }
+  // Start a fresh journal. The restored ranges live in memory only until the
+  // next checkpoint, i.e., a crash discards them.
+  journal.open(to_string(file),
+               std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!journal)
+    return make_error(ec::filesystem_error, "failed to open ID journal",
+                      to_string(file));
+  if (exists(legacy))
+    rm(legacy);
   return caf::none;
 }
 
 caf::error importer_state::write_state() {
   VAST_TRACE("");
-  if (id_generators.empty() || available_ids() == 0)
+  if (!journal.is_open())
     return caf::none;
-  if (!exists(dir)) {
-    auto result = mkdir(dir);
-    if (!result)
-      return std::move(result.error());
-  }
-  std::ofstream available{to_string(dir / "available_ids")};
-  auto i = id_generators.begin();
-  available << i->i << ' ' << i->last;
-  for (++i; i != id_generators.end(); ++i) {
-    available << '\n' << i->i << ' ' << i->last;
-  }
+  for (auto& g : id_generators)
+    if (!g.at_end())
+      append(journal, available_record, g.i, g.last);
+  append(journal, end_record, 0, 0);
+  journal.flush();
+  if (!journal)
+    return make_error(ec::filesystem_error, "failed to write ID journal");
   VAST_DEBUG(self, "saved", available_ids(), "available IDs");
   return caf::none;
 }
 
+caf::error importer_state::record_lease(id first, id last) {
+  VAST_TRACE(VAST_ARG(first), VAST_ARG(last));
+  append(journal, lease_record, first, last);
+  journal.flush();
+  if (!journal)
+    return make_error(ec::filesystem_error, "failed to write ID journal");
+  return caf::none;
+}
+
 int32_t importer_state::available_ids() const noexcept {
   auto f = [](int32_t x, const id_generator& y) {
     return x + y.remaining();
@@ -92,6 +208,10 @@ int32_t importer_state::available_ids() const noexcept {
                          int32_t{0}, f);
 }
 
+int32_t importer_state::unclaimed_ids() const noexcept {
+  return available_ids() - in_flight_slices * max_table_slice_size;
+}
+
 id importer_state::next_id_block() {
   VAST_ASSERT(!id_generators.empty());
   auto& g = id_generators.front();
@@ -99,6 +219,7 @@ id importer_state::next_id_block() {
   auto result = g.next(max_table_slice_size);
   if (g.at_end())
     id_generators.erase(id_generators.begin());
+  consumed_ids += max_table_slice_size;
   return result;
 }
 
@@ -111,6 +232,7 @@ caf::dictionary<caf::config_value> importer_state::status() const {
   result.emplace("last-replenish", caf::deep_to_string(last_replenish));
   result.emplace("awaiting-ids", awaiting_ids);
   result.emplace("available-ids", available_ids());
+  result.emplace("consumed-ids", consumed_ids);
   if (!id_generators.empty())
     result.emplace("next-id", id_generators.front().i);
   // General state such as open streams.
@@ -120,57 +242,74 @@ caf::dictionary<caf::config_value> importer_state::status() const {
 
 namespace {
 
-// Asks the metastore for more IDs.
+// Asks the metastore for more IDs without blocking the stream stage. The
+// importer keeps assigning IDs from its remaining ranges until the response
+// arrives.
 void replenish(stateful_actor<importer_state>* self) {
   VAST_TRACE("");
   auto& st = self->state;
   // Do nothing if we're already waiting for a response of the meta store.
   if (st.awaiting_ids)
     return;
-  // Check whether we obtain new IDs too frequently.
+  // Size the lease such that it lasts for about `lease_duration` at the
+  // ingest rate since the last replenish.
   auto now = steady_clock::now();
-  if ((now - st.last_replenish) < 10s) {
-    VAST_DEBUG(self, "had to replenish twice within 10 secs");
-    VAST_DEBUG(self, "increase blocks_per_replenish:", st.blocks_per_replenish,
-                    "->", st.blocks_per_replenish + 100);
-    st.blocks_per_replenish += 100;
+  if (st.last_replenish != steady_clock::time_point::min()) {
+    auto elapsed = duration_cast<duration<double>>(now - st.last_replenish);
+    auto consumed = st.consumed_ids - st.consumed_ids_at_replenish;
+    auto slice_size = static_cast<size_t>(st.max_table_slice_size);
+    auto max_blocks = std::numeric_limits<int32_t>::max() / 4 / slice_size;
+    auto blocks = max_blocks;
+    if (elapsed.count() > 0) {
+      auto wanted = consumed * (lease_duration / elapsed);
+      blocks = static_cast<size_t>(std::min(
+        std::ceil(wanted / slice_size), static_cast<double>(max_blocks)));
+    }
+    blocks = std::clamp(blocks, min_blocks_per_replenish,
+                        std::max(min_blocks_per_replenish, max_blocks));
+    if (blocks != st.blocks_per_replenish)
+      VAST_DEBUG(self, "adjusts blocks_per_replenish:",
+                 st.blocks_per_replenish, "->", blocks);
+    st.blocks_per_replenish = blocks;
   }
   st.last_replenish = now;
+  st.consumed_ids_at_replenish = st.consumed_ids;
   VAST_DEBUG(self, "replenishes", st.blocks_per_replenish, "ID blocks");
-  // If we get an EXIT message while expecting a response from the metastore,
-  // we'll give it a bit of time to come back;
-  self->set_default_handler(skip);
-  // Trigger meta store and wait for response.
   auto n = st.max_table_slice_size * st.blocks_per_replenish;
-  self->send(st.meta_store, add_atom::value, "id", data{n});
   st.awaiting_ids = true;
-  self->become(
-    keep_behavior,
+  self->request(st.meta_store, infinite, add_atom::value, "id", data{n}).then(
     [=](const data& old) {
       auto x = caf::holds_alternative<caf::none_t>(old) ? count{0}
                                                         : caf::get<count>(old);
       VAST_DEBUG(self, "got", n, "new IDs starting at", x);
       auto& st = self->state;
-      // Add a new ID generator for the available range.
       VAST_ASSERT(st.awaiting_ids);
-      st.id_generators.emplace_back(x, x + n);
-      // Save state.
-      auto err = self->state.write_state();
-      if (err) {
+      st.awaiting_ids = false;
+      // Record the lease before handing out any of its IDs.
+      if (auto err = st.record_lease(x, x + n)) {
         VAST_ERROR(self, "failed to save state:", self->system().render(err));
         self->quit(std::move(err));
         return;
       }
-      // Try to emit more credit with out new IDs.
+      // Add a new ID generator for the available range.
+      st.id_generators.emplace_back(x, x + n);
+      // Try to emit more credit with our new IDs.
       st.stg->advance();
-      // Return to previous behavior.
-      st.awaiting_ids = false;
-      self->set_default_handler(print_and_drop);
-      self->unbecome();
+    },
+    [=](const error& err) {
+      VAST_ERROR(self, "failed to obtain new IDs:",
+                 self->system().render(err));
+      self->state.awaiting_ids = false;
     }
   );
 }
 
+// Checks whether the unclaimed IDs fall below half a lease.
+bool running_low(const importer_state& st) {
+  auto lease = st.blocks_per_replenish * st.max_table_slice_size;
+  return static_cast<size_t>(std::max(st.unclaimed_ids(), 0)) < lease / 2;
+}
+
 class driver : public importer_state::driver_base {
 public:
   using super = importer_state::driver_base;
@@ -197,6 +336,9 @@ public:
       x.unshared().offset(st.next_id_block());
       out.push(std::move(x));
     }
+    // Prefetch the next lease before we run out of IDs.
+    if (running_low(st))
+      replenish(self_);
   }
 
   int32_t acquire_credit(inbound_path* path, int32_t desired) override {
@@ -214,15 +356,16 @@ public:
     auto max_credit = (st.available_ids() / st.max_table_slice_size)
                       - st.in_flight_slices;
     VAST_ASSERT(max_credit >= 0);
+    auto result = desired;
     if (max_credit <= desired) {
-      // Get more IDs if we're running out.
       VAST_DEBUG(self_, "had to limit acquired credit to", max_credit);
-      replenish(self_);
-      st.in_flight_slices += max_credit;
-      return max_credit;
+      result = max_credit;
     }
-    st.in_flight_slices += desired;
-    return desired;
+    st.in_flight_slices += result;
+    // Get more IDs if we're running out.
+    if (running_low(st))
+      replenish(self_);
+    return result;
   }
 
   pointer self() const {
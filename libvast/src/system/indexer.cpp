@@ -65,7 +65,8 @@ behavior indexer(stateful_actor<indexer_state>* self, path dir,
       return self->state.tbl.lookup(expr);
     },
     [=](persist_atom) -> result<void> {
-      if (auto err = self->state.tbl.flush_to_disk(); err != caf::none)
+      // The INDEX only sends 'persist' once our partition becomes full.
+      if (auto err = self->state.tbl.seal(); err != caf::none)
         return err;
       return caf::unit;
     },
@@ -0,0 +1,120 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/partition_scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vast::system {
+
+namespace {
+
+// The weight of a new sample in the moving averages.
+constexpr double alpha = 0.25;
+
+double update(double average, double sample) {
+  return average + alpha * (sample - average);
+}
+
+timespan update(timespan average, timespan sample) {
+  return average + std::chrono::duration_cast<timespan>(
+                     alpha * (sample - average));
+}
+
+} // namespace <anonymous>
+
+void partition_scheduler::start(size_t partitions, size_t scheduled,
+                                clock::time_point now) {
+  partitions_ = partitions;
+  scheduled_ = 0;
+  received_ = 0;
+  batches_.clear();
+  schedule(scheduled, now);
+}
+
+void partition_scheduler::schedule(size_t n, clock::time_point now) {
+  n = std::min(n, remaining());
+  if (n == 0)
+    return;
+  scheduled_ += n;
+  last_batch_ = n;
+  batches_.emplace_back(now, n);
+}
+
+void partition_scheduler::partition_done(uint64_t hits,
+                                         clock::time_point now) {
+  auto x = static_cast<double>(hits);
+  hits_per_partition_ = received_ == 0 ? x : update(hits_per_partition_, x);
+  ++received_;
+  if (batches_.empty())
+    return;
+  auto& [start, outstanding] = batches_.front();
+  if (--outstanding > 0)
+    return;
+  auto latency = std::chrono::duration_cast<timespan>(now - start);
+  index_latency_ = index_latency_ == timespan::zero()
+                     ? latency
+                     : update(index_latency_, latency);
+  batches_.pop_front();
+}
+
+void partition_scheduler::lookup_sent(uint64_t candidates,
+                                      clock::time_point now) {
+  pending_candidates_ += candidates;
+  lookups_.emplace_back(now, candidates);
+}
+
+void partition_scheduler::lookup_done(uint64_t candidates, uint64_t results,
+                                      clock::time_point now) {
+  if (lookups_.empty())
+    return;
+  auto [start, sent] = lookups_.front();
+  lookups_.pop_front();
+  pending_candidates_ -= sent;
+  auto latency = std::chrono::duration_cast<timespan>(now - start);
+  auto first = completed_lookups_++ == 0;
+  archive_latency_ = first ? latency : update(archive_latency_, latency);
+  if (candidates > 0) {
+    auto x = static_cast<double>(results) / candidates;
+    selectivity_ = first ? x : update(selectivity_, x);
+  }
+}
+
+size_t partition_scheduler::next(uint64_t demand) const {
+  if (remaining() == 0 || demand == 0 || batches_.size() >= max_batches)
+    return 0;
+  // Before the first ID set arrives, we know nothing about the query and
+  // wait for the partitions that the INDEX scheduled up front.
+  if (received_ == 0)
+    return inflight() == 0 ? 1 : 0;
+  // Hold back while the ARCHIVE has more work queued than the INDEX needs
+  // for a batch, because the hits of the next batch would only wait.
+  auto backlog = archive_latency_ * static_cast<timespan::rep>(lookups_.size());
+  if (backlog > index_latency_)
+    return 0;
+  // Estimate the results that the work in flight produces.
+  auto yield = hits_per_partition_ * selectivity_;
+  auto pending = yield * inflight() + selectivity_ * pending_candidates_;
+  auto wanted = static_cast<double>(demand);
+  if (pending >= wanted)
+    return 0;
+  auto n = remaining();
+  if (yield > 0)
+    n = std::min(n, static_cast<size_t>(std::ceil((wanted - pending) / yield)));
+  // Grow batches gradually, since the estimates stem from few partitions.
+  n = std::min(n, std::max(size_t{1}, 2 * last_batch_));
+  return std::max(n, size_t{1});
+}
+
+} // namespace vast::system
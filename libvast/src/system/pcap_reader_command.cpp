@@ -15,6 +15,7 @@
 
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include <caf/event_based_actor.hpp>
 #include <caf/scoped_actor.hpp>
@@ -39,7 +40,9 @@ caf::message pcap_reader_command(const command& cmd, caf::actor_system& sys,
                                  command::argument_iterator first,
                                  command::argument_iterator last) {
   VAST_TRACE(VAST_ARG(options), VAST_ARG("args", first, last));
-  auto input = get_or(options, "read", defaults::command::read_path);
+  auto inputs = source_inputs(options);
+  if (!inputs)
+    return caf::make_message(std::move(inputs.error()));
   auto cutoff = get_or(options, "cutoff", defaults::command::cutoff);
   auto flow_max = get_or(options, "flow-max", defaults::command::max_flows);
   auto flow_age = get_or(options, "flow-age", defaults::command::max_flow_age);
@@ -47,10 +50,14 @@ caf::message pcap_reader_command(const command& cmd, caf::actor_system& sys,
                             defaults::command::flow_expiry);
   auto pseudo_realtime = get_or(options, "pseudo-realtime",
                                 defaults::command::pseudo_realtime_factor);
-  format::pcap::reader reader{input,    cutoff,      flow_max,
-                              flow_age, flow_expiry, pseudo_realtime};
-  auto src = sys.spawn(default_source<format::pcap::reader>, std::move(reader));
-  return source_command(cmd, sys, std::move(src), options, first, last);
+  std::vector<caf::actor> srcs;
+  for (auto& input : *inputs) {
+    format::pcap::reader reader{input,    cutoff,      flow_max,
+                                flow_age, flow_expiry, pseudo_realtime};
+    srcs.push_back(sys.spawn(default_source<format::pcap::reader>,
+                             std::move(reader)));
+  }
+  return source_command(cmd, sys, std::move(srcs), options, first, last);
 }
 
 } // namespace vast::system
@@ -19,6 +19,8 @@
 #include <caf/scoped_actor.hpp>
 #include <caf/typed_event_based_actor.hpp>
 
+#include "vast/defaults.hpp"
+#include "vast/detail/assert.hpp"
 #include "vast/detail/string.hpp"
 #include "vast/error.hpp"
 #include "vast/expression.hpp"
@@ -60,40 +62,73 @@ caf::expected<expression> parse_expression(command::argument_iterator begin,
 
 } // namespace <anonymous>
 
+caf::expected<std::vector<std::string>>
+source_inputs(const caf::config_value_map& options) {
+  auto input = get_or(options, "read", defaults::command::read_path);
+  // A UNIX domain socket always denotes a single input.
+  if (get_or(options, "uds", false))
+    return std::vector<std::string>{std::move(input)};
+  std::vector<std::string> result;
+  for (auto& pattern : detail::split(input, ",")) {
+    if (pattern.empty())
+      continue;
+    auto paths = glob(std::string{pattern});
+    if (paths.empty())
+      return make_error(ec::filesystem_error, "no input matches",
+                        std::string{pattern});
+    for (auto& p : paths)
+      result.push_back(p.str());
+  }
+  if (result.empty())
+    return make_error(ec::filesystem_error, "no input given");
+  return result;
+}
+
 caf::message source_command(const command& cmd, caf::actor_system& sys,
-                            caf::actor src, caf::config_value_map& options,
+                            std::vector<caf::actor> srcs,
+                            caf::config_value_map& options,
                             command::argument_iterator begin,
                             command::argument_iterator end) {
   using namespace caf;
   using namespace std::chrono_literals;
   VAST_UNUSED(cmd);
+  VAST_ASSERT(!srcs.empty());
   // Helper for blocking actor communication.
   scoped_actor self{sys};
+  // Terminates all sources when bailing out early.
+  auto shutdown = [&](caf::error err) {
+    for (auto& src : srcs)
+      self->send_exit(src, exit_reason::user_shutdown);
+    return make_message(std::move(err));
+  };
   // Supply an alternate schema, if requested.
   expected<vast::schema> schema{caf::none};
   if (auto sf = caf::get_if<std::string>(&options, "schema-file")) {
     if (caf::get_if<std::string>(&options, "schema"))
-      return make_message(make_error(
+      return shutdown(make_error(
         ec::invalid_configuration, "had both schema and schema-file provided"));
     schema = load_schema_file(*sf);
   } else if (auto sc = caf::get_if<std::string>(&options, "schema")) {
     schema = to<vast::schema>(*sc);
   }
-  if (schema)
-    self->send(src, put_atom::value, std::move(*schema));
-  else if (schema.error())
-    return make_message(std::move(schema.error()));
+  if (schema) {
+    for (auto& src : srcs)
+      self->send(src, put_atom::value, *schema);
+  } else if (schema.error()) {
+    return shutdown(std::move(schema.error()));
+  }
   // Attempt to parse the remainder as an expression.
   if (begin != end) {
     auto expr = parse_expression(begin, end);
     if (!expr)
-      return make_message(std::move(expr.error()));
-    self->send(src, std::move(*expr));
+      return shutdown(std::move(expr.error()));
+    for (auto& src : srcs)
+      self->send(src, *expr);
   }
   // Get VAST node.
   auto node_opt = spawn_or_connect_to_node(self, options);
   if (auto err = caf::get_if<caf::error>(&node_opt))
-    return make_message(std::move(*err));
+    return shutdown(std::move(*err));
   auto& node = caf::holds_alternative<caf::actor>(node_opt)
                ? caf::get<caf::actor>(node_opt)
                : caf::get<scope_linked_actor>(node_opt).get();
@@ -106,17 +141,21 @@ caf::message source_command(const command& cmd, caf::actor_system& sys,
   });
   // Set defaults.
   caf::error err;
-  // Connect source to importers.
+  // Connect sources to importers.
   caf::actor importer;
   self->request(node, infinite, get_atom::value).receive(
     [&](const std::string& id, system::registry& reg) {
-      // Assign accountant to source.
-      VAST_DEBUG(&cmd, "assigns accountant from node", id, "to new source");
+      // Assign accountant to the sources. The accountant records the actor
+      // ID of the sender, which keeps the metrics of each source apart.
+      VAST_DEBUG(&cmd, "assigns accountant from node", id, "to",
+                 srcs.size(), "new source(s)");
       auto er = reg.components[id].equal_range("accountant");
       VAST_ASSERT(er.first != er.second);
-      auto accountant = er.first->second.actor;
-      self->send(src, actor_cast<accountant_type>(accountant));
-      // Assign IMPORTER to SOURCE and start streaming.
+      auto accountant = actor_cast<accountant_type>(er.first->second.actor);
+      for (auto& src : srcs)
+        self->send(src, accountant);
+      // Assign IMPORTER to the sources and start streaming. The IMPORTER
+      // merges all inbound streams and hands out credit to each of them.
       er = reg.components[id].equal_range("importer");
       if (er.first == er.second) {
         err = make_error(ec::no_importer);
@@ -126,7 +165,8 @@ caf::message source_command(const command& cmd, caf::actor_system& sys,
       } else {
         VAST_DEBUG(&cmd, "connects to importer");
         importer = er.first->second.actor;
-        self->send(src, system::sink_atom::value, importer);
+        for (auto& src : srcs)
+          self->send(src, system::sink_atom::value, importer);
       }
     },
     [&](error& e) {
@@ -134,19 +174,24 @@ caf::message source_command(const command& cmd, caf::actor_system& sys,
     }
   );
   if (err)
-    return make_message(std::move(err));
-  // Start the source.
+    return shutdown(std::move(err));
+  // Start the sources.
   bool stop = false;
-  self->monitor(src);
+  auto running = srcs.size();
+  for (auto& src : srcs)
+    self->monitor(src);
   self->do_receive(
     [&](const down_msg& msg) {
       if (msg.source == node)  {
         VAST_DEBUG(&cmd, "received DOWN from node");
-        self->send_exit(src, exit_reason::user_shutdown);
+        for (auto& src : srcs)
+          self->send_exit(src, exit_reason::user_shutdown);
         err = ec::remote_node_down;
         stop = true;
-      } else if (msg.source == src) {
-        VAST_DEBUG(&cmd, "received DOWN from source");
+      } else if (--running > 0) {
+        VAST_DEBUG(&cmd, "received DOWN from source,", running, "remaining");
+      } else {
+        VAST_DEBUG(&cmd, "received DOWN from last source");
         if (caf::get_or(options, "blocking", false))
           self->send(importer, subscribe_atom::value, flush_atom::value, self);
         else
@@ -160,7 +205,8 @@ caf::message source_command(const command& cmd, caf::actor_system& sys,
     [&](system::signal_atom, int signal) {
       VAST_DEBUG(&cmd, "got " << ::strsignal(signal));
       if (signal == SIGINT || signal == SIGTERM)
-        self->send_exit(src, exit_reason::user_shutdown);
+        for (auto& src : srcs)
+          self->send_exit(src, exit_reason::user_shutdown);
     }
   ).until(stop);
   if (err)
@@ -168,4 +214,13 @@ caf::message source_command(const command& cmd, caf::actor_system& sys,
   return caf::none;
 }
 
+caf::message source_command(const command& cmd, caf::actor_system& sys,
+                            caf::actor src, caf::config_value_map& options,
+                            command::argument_iterator begin,
+                            command::argument_iterator end) {
+  std::vector<caf::actor> srcs;
+  srcs.push_back(std::move(src));
+  return source_command(cmd, sys, std::move(srcs), options, begin, end);
+}
+
 } // namespace vast::system
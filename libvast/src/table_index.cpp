@@ -84,6 +84,19 @@ caf::error table_index::flush_to_disk() {
   return caf::none;
 }
 
+caf::error table_index::seal() {
+  VAST_TRACE("");
+  // Sealing writes the complete column indexes, so we skip their delta logs.
+  if (auto err = save(sys_, base_dir_ / "row_ids", row_ids_))
+    return err;
+  for (auto& col : columns_)
+    if (col != nullptr)
+      if (auto err = col->seal())
+        return err;
+  dirty_ = false;
+  return caf::none;
+}
+
 /// -- properties --------------------------------------------------------------
 
 column_index& table_index::at(size_t column_index) {
@@ -44,6 +44,10 @@ bool table_slice_builder::recursive_add(const data& x, const type& t) {
                     x, t);
 }
 
+bool table_slice_builder::add_unchecked(data_view x) {
+  return add(std::move(x));
+}
+
 void table_slice_builder::reserve(size_t) {
   // nop
 }
@@ -11,6 +11,7 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <cctype>
 #include <cmath>
 
 #include "vast/base.hpp"
@@ -40,6 +41,103 @@ optional<base> parse_base(const type& t) {
   return base::uniform<64>(8);
 }
 
+// Computes the digest that a string_hash_index stores for a string.
+string_hash_index::digest_type digest(std::string_view str) {
+  xxhash64 h;
+  h(str.data(), str.size());
+  return static_cast<string_hash_index::digest_type>(h);
+}
+
+// Packs the n-gram starting at the given position into a single integer.
+uint32_t make_ngram(std::string_view str, size_t i) {
+  auto result = uint32_t{0};
+  for (auto j = i; j < i + string_index::ngram_size; ++j)
+    result = (result << 8) | static_cast<uint8_t>(str[j]);
+  return result;
+}
+
+// Extracts the literal fragments that every string matching the regular
+// expression `pat` must contain. Expressions with alternations or groups,
+// where any fragment could be optional, yield no fragments.
+std::vector<std::string> required_literals(std::string_view pat) {
+  std::vector<std::string> result;
+  std::string fragment;
+  auto flush = [&] {
+    if (!fragment.empty())
+      result.push_back(std::move(fragment));
+    fragment.clear();
+  };
+  // Removes the last character, which may span several UTF-8 bytes.
+  auto pop = [&] {
+    while (!fragment.empty()
+           && (static_cast<unsigned char>(fragment.back()) & 0xC0) == 0x80)
+      fragment.pop_back();
+    if (!fragment.empty())
+      fragment.pop_back();
+  };
+  for (size_t i = 0; i < pat.size(); ++i) {
+    switch (pat[i]) {
+      default:
+        fragment += pat[i];
+        break;
+      case '|':
+      case '(':
+      case ')':
+        return {};
+      case '*':
+      case '?':
+        // The preceding atom may not occur at all.
+        pop();
+        flush();
+        break;
+      case '{':
+        pop();
+        flush();
+        i = pat.find('}', i);
+        if (i == std::string_view::npos)
+          return {};
+        break;
+      case '[': {
+        flush();
+        // A leading bracket and nested classes mean different things across
+        // regex flavors, so we give up on them.
+        auto j = i + 1;
+        if (j < pat.size() && pat[j] == '^')
+          ++j;
+        if (j < pat.size() && pat[j] == ']')
+          return {};
+        for (; j < pat.size() && pat[j] != ']'; ++j) {
+          if (pat[j] == '\\')
+            ++j;
+          else if (pat[j] == '[')
+            return {};
+        }
+        if (j >= pat.size())
+          return {};
+        i = j;
+        break;
+      }
+      case '+':
+      case '.':
+      case '^':
+      case '$':
+        flush();
+        break;
+      case '\\':
+        if (++i == pat.size())
+          return {};
+        // Escaped letters and digits denote character classes or anchors.
+        if (std::isalnum(static_cast<unsigned char>(pat[i])))
+          flush();
+        else
+          fragment += pat[i];
+        break;
+    }
+  }
+  flush();
+  return result;
+}
+
 } // namespace <anonymous>
 
 // -- value_index --------------------------------------------------------------
@@ -88,6 +186,8 @@ std::unique_ptr<value_index> value_index::make(const type& t) {
       return std::make_unique<arithmetic_index<timestamp>>(std::move(*b));
     }
     result_type operator()(const string_type& t) const {
+      if (has_index_attribute(t, "hash"))
+        return std::make_unique<string_hash_index>();
       auto max_length = size_t{1024};
       if (auto a = extract_attribute(t, "max_length")) {
         if (auto x = to<size_t>(*a))
@@ -95,13 +195,37 @@ std::unique_ptr<value_index> value_index::make(const type& t) {
         else
           return nullptr;
       }
-      return std::make_unique<string_index>(max_length);
+      auto ngrams = false;
+      if (auto a = extract_attribute(t, "index")) {
+        if (*a == "ngram")
+          ngrams = true;
+        else
+          return nullptr;
+      }
+      auto max_cardinality = size_t{256};
+      if (auto a = extract_attribute(t, "max_cardinality")) {
+        if (auto x = to<size_t>(*a))
+          max_cardinality = *x;
+        else
+          return nullptr;
+      }
+      return std::make_unique<string_index>(max_length, ngrams,
+                                            max_cardinality);
     }
     result_type operator()(const pattern_type&) const {
       return nullptr;
     }
-    result_type operator()(const address_type&) const {
-      return std::make_unique<address_index>();
+    result_type operator()(const address_type& t) const {
+      if (!has_index_attribute(t, "prefix"))
+        return std::make_unique<address_index>();
+      auto stride = size_t{8};
+      if (auto a = extract_attribute(t, "stride")) {
+        if (auto x = to<size_t>(*a); x && *x > 0 && *x < 128)
+          stride = *x;
+        else
+          return nullptr;
+      }
+      return std::make_unique<address_index>(stride);
     }
     result_type operator()(const subnet_type&) const {
       return std::make_unique<subnet_index>();
@@ -185,7 +309,12 @@ value_index::size_type value_index::offset() const {
 
 // -- string_index -------------------------------------------------------------
 
-string_index::string_index(size_t max_length) : max_length_{max_length} {
+string_index::string_index(size_t max_length, bool ngrams,
+                           size_t max_cardinality)
+  : max_length_{max_length},
+    ngrams_enabled_{ngrams},
+    max_cardinality_{max_cardinality},
+    dictionary_encoded_{max_cardinality > 0} {
 }
 
 void string_index::init() {
@@ -201,23 +330,102 @@ bool string_index::append_impl(data_view x, id pos) {
   auto str = caf::get_if<view<std::string>>(&x);
   if (!str)
     return false;
+  if (dictionary_encoded_) {
+    if (dictionary_append(*str, pos))
+      return true;
+    spill();
+  }
+  chars_append(*str, pos);
+  return true;
+}
+
+bool string_index::dictionary_append(std::string_view str, id pos) {
+  if (code_.coder().storage().empty())
+    code_ = code_bitmap_index{max_cardinality_};
+  auto code = find_code(str);
+  if (!code) {
+    if (dictionary_.size() == max_cardinality_)
+      return false;
+    code = static_cast<uint32_t>(dictionary_.size());
+    codes_.emplace(hash_code(str), *code);
+    dictionary_.emplace_back(str);
+  }
+  code_.skip(pos - code_.size());
+  code_.append(*code);
+  return true;
+}
+
+optional<uint32_t> string_index::find_code(std::string_view str) const {
+  auto [first, last] = codes_.equal_range(hash_code(str));
+  for (auto i = first; i != last; ++i)
+    if (dictionary_[i->second] == str)
+      return i->second;
+  return {};
+}
+
+void string_index::chars_append(std::string_view str, id pos) {
   init();
-  auto length = str->size();
+  auto length = str.size();
   if (length > max_length_)
     length = max_length_;
   if (length > chars_.size())
     chars_.resize(length, char_bitmap_index{8});
   for (auto i = 0u; i < length; ++i) {
     chars_[i].skip(pos - chars_[i].size());
-    chars_[i].append(static_cast<uint8_t>((*str)[i]));
+    chars_[i].append(static_cast<uint8_t>(str[i]));
   }
   length_.skip(pos - length_.size());
   length_.append(length);
-  return true;
+  if (ngrams_enabled_ && str.size() >= ngram_size) {
+    for (auto i = 0u; i + ngram_size <= str.size(); ++i) {
+      auto& bm = ngrams_[make_ngram(str, i)];
+      // Record repeated n-grams of the same string only once.
+      if (bm.size() > pos)
+        continue;
+      bm.append_bits(false, pos - bm.size());
+      bm.append_bit(true);
+    }
+  }
+}
+
+void string_index::spill() {
+  VAST_ASSERT(dictionary_encoded_);
+  // Restore the sequence of (ID, code) pairs and replay it in ID order.
+  std::vector<std::pair<id, uint32_t>> rows;
+  rows.reserve(code_.size());
+  auto& bitmaps = code_.coder().storage();
+  for (auto code = 0u; code < dictionary_.size(); ++code)
+    for (auto rng = select(bitmaps[code]); rng; rng.next())
+      rows.emplace_back(rng.get(), code);
+  std::sort(rows.begin(), rows.end());
+  for (auto& [pos, code] : rows)
+    chars_append(dictionary_[code], pos);
+  dictionary_encoded_ = false;
+  dictionary_.clear();
+  codes_.clear();
+  code_ = code_bitmap_index{};
+}
+
+ids string_index::ngram_lookup(std::string_view str) const {
+  VAST_ASSERT(ngrams_enabled_ && str.size() >= ngram_size);
+  ids result{offset(), true};
+  for (auto i = 0u; i + ngram_size <= str.size(); ++i) {
+    auto j = ngrams_.find(make_ngram(str, i));
+    if (j == ngrams_.end())
+      return ids{offset(), false};
+    result &= j->second;
+    if (all<0>(result))
+      return ids{offset(), false};
+  }
+  // Postings end at their last hit, which shortens the conjunction.
+  result.append_bits(false, offset() - result.size());
+  return result;
 }
 
 expected<ids>
 string_index::lookup_impl(relational_operator op, data_view x) const {
+  if (dictionary_encoded_)
+    return dictionary_lookup(op, x);
   return caf::visit(detail::overload(
     [&](auto x) -> expected<ids> {
       return make_error(ec::type_clash, materialize(x));
@@ -256,6 +464,10 @@ string_index::lookup_impl(relational_operator op, data_view x) const {
         case not_ni: {
           if (str_size == 0)
             return ids{offset(), op == ni};
+          // The n-gram candidates form a superset of the actual result, which
+          // we cannot negate.
+          if (op == ni && ngrams_enabled_ && str.size() >= ngram_size)
+            return ngram_lookup(str);
           if (str_size > chars_.size())
             return ids{offset(), op == not_ni};
           // TODO: Be more clever than iterating over all k-grams (#45).
@@ -280,6 +492,129 @@ string_index::lookup_impl(relational_operator op, data_view x) const {
         }
       }
     },
+    [&](view<pattern> pat) -> expected<ids> {
+      if (!ngrams_enabled_)
+        return make_error(ec::type_clash, materialize(pat));
+      switch (op) {
+        default:
+          return make_error(ec::unsupported_operator, op);
+        case not_match:
+          // Without exact matching every string remains a candidate.
+          return ids{offset(), true};
+        case match: {
+          ids result{offset(), true};
+          for (auto& literal : required_literals(pat.string())) {
+            if (literal.size() < ngram_size)
+              continue;
+            result &= ngram_lookup(literal);
+            if (all<0>(result))
+              break;
+          }
+          return result;
+        }
+      }
+    },
+    [&](view<vector> xs) { return detail::container_lookup(*this, op, xs); },
+    [&](view<set> xs) { return detail::container_lookup(*this, op, xs); }
+  ), x);
+}
+
+expected<ids>
+string_index::dictionary_lookup(relational_operator op, data_view x) const {
+  // Computes the disjunction of all codes whose string satisfies `pred`.
+  auto select_codes = [&](auto pred) {
+    ids result{offset(), false};
+    for (auto code = 0u; code < dictionary_.size(); ++code)
+      if (pred(dictionary_[code]))
+        result |= code_.lookup(equal, code);
+    return result;
+  };
+  return caf::visit(detail::overload(
+    [&](auto x) -> expected<ids> {
+      return make_error(ec::type_clash, materialize(x));
+    },
+    [&](view<std::string> str) -> expected<ids> {
+      switch (op) {
+        default:
+          return make_error(ec::unsupported_operator, op);
+        case equal:
+        case not_equal: {
+          auto code = find_code(str);
+          if (!code)
+            return ids{offset(), op == not_equal};
+          ids result = code_.lookup(equal, *code);
+          if (op == not_equal)
+            result.flip();
+          return result;
+        }
+        case ni:
+        case not_ni: {
+          auto result = select_codes([&](const std::string& candidate) {
+            return candidate.find(str) != std::string::npos;
+          });
+          if (op == not_ni)
+            result.flip();
+          return result;
+        }
+      }
+    },
+    [&](view<pattern> pat) -> expected<ids> {
+      if (!(op == match || op == not_match))
+        return make_error(ec::unsupported_operator, op);
+      auto result = select_codes([&](const std::string& candidate) {
+        return pat.match(candidate);
+      });
+      if (op == not_match)
+        result.flip();
+      return result;
+    },
+    [&](view<vector> xs) { return detail::container_lookup(*this, op, xs); },
+    [&](view<set> xs) { return detail::container_lookup(*this, op, xs); }
+  ), x);
+}
+
+// -- string_hash_index --------------------------------------------------------
+
+void string_hash_index::init() {
+  if (digests_.coder().storage().empty())
+    digests_ = digest_bitmap_index{sizeof(digest_type) * 8};
+}
+
+bool string_hash_index::append_impl(data_view x, id pos) {
+  auto str = caf::get_if<view<std::string>>(&x);
+  if (!str)
+    return false;
+  init();
+  digests_.skip(pos - digests_.size());
+  digests_.append(digest(*str));
+  return true;
+}
+
+expected<ids>
+string_hash_index::lookup_impl(relational_operator op, data_view x) const {
+  return caf::visit(detail::overload(
+    [&](auto x) -> expected<ids> {
+      return make_error(ec::type_clash, materialize(x));
+    },
+    [&](view<std::string> str) -> expected<ids> {
+      switch (op) {
+        default:
+          return make_error(ec::unsupported_operator, op);
+        case equal:
+          return digests_.lookup(equal, digest(str));
+        // Rows whose digest collides with `str` may still differ from it, so
+        // every row remains a candidate.
+        case not_equal:
+        case ni:
+        case not_ni:
+          return ids{offset(), true};
+      }
+    },
+    [&](view<pattern>) -> expected<ids> {
+      if (!(op == match || op == not_match))
+        return make_error(ec::unsupported_operator, op);
+      return ids{offset(), true};
+    },
     [&](view<vector> xs) { return detail::container_lookup(*this, op, xs); },
     [&](view<set> xs) { return detail::container_lookup(*this, op, xs); }
   ), x);
@@ -287,10 +622,17 @@ string_index::lookup_impl(relational_operator op, data_view x) const {
 
 // -- address_index ------------------------------------------------------------
 
+address_index::address_index(size_t stride) : stride_{stride} {
+  VAST_ASSERT(stride < 128);
+}
+
 void address_index::init() {
-  if (bytes_[0].coder().storage().empty())
+  if (bytes_[0].coder().storage().empty()) {
     // Initialize on first to make deserialization feasible.
     bytes_.fill(byte_index{8});
+    if (stride_ > 0)
+      prefixes_.resize(127 / stride_);
+  }
 }
 
 bool address_index::append_impl(data_view x, id pos) {
@@ -305,9 +647,58 @@ bool address_index::append_impl(data_view x, id pos) {
   }
   v4_.skip(pos - v4_.size());
   v4_.append(addr->is_v4());
+  if (stride_ > 0) {
+    // All IPv4 addresses share the top 96 bits, hence we only need to record
+    // their longer prefixes.
+    auto first = addr->is_v4() ? (96 / stride_ + 1) * stride_ : stride_;
+    for (auto length = first; length < 128; length += stride_) {
+      auto prefix = address{*addr};
+      prefix.mask(length);
+      auto& bm = prefixes_[length / stride_ - 1][prefix];
+      bm.append_bits(false, pos - bm.size());
+      bm.append_bit(true);
+    }
+  }
   return true;
 }
 
+optional<ids> address_index::prefix_lookup(const subnet& x) const {
+  if (prefixes_.empty())
+    return {};
+  auto& network = x.network();
+  auto length = network.is_v4() ? x.length() + 96u : x.length() + 0u;
+  auto level_length = length - length % stride_;
+  if (level_length == 0)
+    return {};
+  // Levels up to /96 lack IPv4 addresses, so they can only answer queries for
+  // networks that cannot contain IPv4 addresses.
+  if (level_length <= 96) {
+    static const auto v4_prefix = [] {
+      uint32_t any = 0;
+      return address::v4(&any);
+    }();
+    if (network.compare(v4_prefix, level_length))
+      return {};
+  }
+  auto key = network;
+  key.mask(level_length);
+  auto& level = prefixes_[level_length / stride_ - 1];
+  auto i = level.find(key);
+  if (i == level.end())
+    return ids{offset(), false};
+  ids result = i->second;
+  // Refine the remaining bits with the bit slices of the byte indexes, which
+  // store the complement of each bit.
+  auto& bytes = network.data();
+  for (auto j = level_length; j < length; ++j) {
+    auto bit = 7 - j % 8;
+    auto& bm = bytes_[j / 8].coder().storage()[bit];
+    result &= (bytes[j / 8] >> bit) & 1 ? ~bm : bm;
+  }
+  result.append_bits(false, offset() - result.size());
+  return result;
+}
+
 expected<ids>
 address_index::lookup_impl(relational_operator op, data_view d) const {
   return caf::visit(detail::overload(
@@ -338,6 +729,11 @@ address_index::lookup_impl(relational_operator op, data_view d) const {
       if ((is_v4 ? topk + 96 : topk) == 128)
         // Asking for /32 or /128 membership is equivalent to an equality lookup.
         return lookup_impl(op == in ? equal : not_equal, x.network());
+      if (auto result = prefix_lookup(x)) {
+        if (op == not_in)
+          result->flip();
+        return std::move(*result);
+      }
       auto result = is_v4 ? v4_.coder().storage() : ids{offset(), true};
       auto& bytes = x.network().data();
       size_t i = is_v4 ? 12 : 0;
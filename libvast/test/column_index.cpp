@@ -20,10 +20,14 @@
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/default_table_slice.hpp"
+#include "vast/defaults.hpp"
+#include "vast/filesystem.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/table_slice_builder.hpp"
 #include "vast/type.hpp"
 
+#include <fstream>
+
 #include <caf/test/dsl.hpp>
 
 using namespace vast;
@@ -80,6 +84,84 @@ TEST(integer values) {
   CHECK_EQUAL(unbox(col->lookup(is4)), make_ids({}, slice_size));
 }
 
+TEST(incremental persistence) {
+  integer_type column_type;
+  record_type layout{{"value", column_type}};
+  auto col = unbox(make_column_index(sys, directory, column_type, 0));
+  auto is1 = unbox(to<predicate>(":int == +1"));
+  MESSAGE("flush two deltas");
+  auto first = default_table_slice::make(layout, make_rows(1, 2, 3));
+  col->add(first);
+  REQUIRE_EQUAL(col->flush_to_disk(), caf::none);
+  CHECK(!exists(col->filename()));
+  CHECK(exists(col->journal_filename()));
+  auto second = default_table_slice::make(layout, make_rows(3, 2, 1));
+  second.unshared().offset(3);
+  col->add(second);
+  REQUIRE_EQUAL(col->flush_to_disk(), caf::none);
+  MESSAGE("replay delta log");
+  col.reset();
+  col = unbox(make_column_index(sys, directory, column_type, 0));
+  CHECK_EQUAL(unbox(col->lookup(is1)), make_ids({0, 5}, 6));
+  MESSAGE("seal and reload from disk");
+  REQUIRE_EQUAL(col->seal(), caf::none);
+  CHECK(exists(col->filename()));
+  CHECK(!exists(col->journal_filename()));
+  col.reset();
+  col = unbox(make_column_index(sys, directory, column_type, 0));
+  CHECK_EQUAL(unbox(col->lookup(is1)), make_ids({0, 5}, 6));
+}
+
+TEST(bounded delta buffer) {
+  integer_type column_type;
+  record_type layout{{"value", column_type}};
+  auto col = unbox(make_column_index(sys, directory, column_type, 0));
+  auto max_pending = defaults::system::max_pending_column_values;
+  defaults::system::max_pending_column_values = 4;
+  MESSAGE("buffer values below the limit");
+  col->add(default_table_slice::make(layout, make_rows(1, 2, 3)));
+  CHECK(!exists(col->journal_filename()));
+  MESSAGE("flush values once reaching the limit");
+  auto second = default_table_slice::make(layout, make_rows(3, 2, 1));
+  second.unshared().offset(3);
+  col->add(second);
+  CHECK(exists(col->journal_filename()));
+  defaults::system::max_pending_column_values = max_pending;
+  col.reset();
+  col = unbox(make_column_index(sys, directory, column_type, 0));
+  auto is1 = unbox(to<predicate>(":int == +1"));
+  CHECK_EQUAL(unbox(col->lookup(is1)), make_ids({0, 5}, 6));
+}
+
+TEST(torn delta log) {
+  integer_type column_type;
+  record_type layout{{"value", column_type}};
+  auto col = unbox(make_column_index(sys, directory, column_type, 0));
+  col->add(default_table_slice::make(layout, make_rows(1, 2, 3)));
+  REQUIRE_EQUAL(col->flush_to_disk(), caf::none);
+  auto journal = col->journal_filename();
+  auto file_size = [&] {
+    std::ifstream fs{journal.str(), std::ios::binary | std::ios::ate};
+    return static_cast<size_t>(fs.tellg());
+  };
+  auto intact = file_size();
+  auto second = default_table_slice::make(layout, make_rows(3, 2, 1));
+  second.unshared().offset(3);
+  col->add(second);
+  REQUIRE_EQUAL(col->flush_to_disk(), caf::none);
+  col.reset();
+  MESSAGE("cut off the last delta");
+  file f{journal};
+  REQUIRE(f.open(file::write_only));
+  REQUIRE(f.truncate(file_size() - 2));
+  f.close();
+  MESSAGE("replay the complete deltas");
+  col = unbox(make_column_index(sys, directory, column_type, 0));
+  auto is1 = unbox(to<predicate>(":int == +1"));
+  CHECK_EQUAL(unbox(col->lookup(is1)), make_ids({0}, 3));
+  CHECK_EQUAL(file_size(), intact);
+}
+
 TEST(bro conn log) {
   MESSAGE("ingest originators from bro conn log");
   auto row_type = bro_conn_log_layout();
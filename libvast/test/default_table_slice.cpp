@@ -12,6 +12,7 @@
  ******************************************************************************/
 
 #include <string>
+#include <string_view>
 
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
@@ -145,6 +146,37 @@ TEST(rows to values) {
   CHECK_EQUAL(subset(*slice, 1, 2), select(1, 2));
 }
 
+TEST(add row) {
+  for (auto& x : test_data)
+    std::apply([&](auto&... xs) { CHECK(builder->add_row(xs...)); }, x);
+  auto slice = builder->finish();
+  CHECK_EQUAL(slice->rows(), test_data.size());
+  CHECK_EQUAL(subset(*slice), test_values);
+  MESSAGE("string views avoid temporary strings");
+  auto abc = std::string_view{"abc"};
+  CHECK(builder->add_row(integer{1}, abc, real{1.2}));
+  slice = builder->finish();
+  CHECK_EQUAL(subset(*slice), select(0, 1));
+}
+
+TEST(recycling) {
+  auto slice = make_slice();
+  auto& xs = static_cast<const default_table_slice&>(*slice).container();
+  auto cells = caf::get<vector>(xs[0]).data();
+  slice.reset();
+  MESSAGE("the builder refills the rows of destroyed slices");
+  CHECK(builder->add(make_view(7)));
+  CHECK(builder->add(make_view("xyz")));
+  slice = builder->finish();
+  CHECK_EQUAL(slice->rows(), 1u);
+  CHECK_EQUAL(slice->at(0, 0), make_view(integer{7}));
+  CHECK_EQUAL(slice->at(0, 1), make_view("xyz"));
+  MESSAGE("incomplete rows do not leak stale values");
+  CHECK_EQUAL(slice->at(0, 2), make_view(data{}));
+  auto& ys = static_cast<const default_table_slice&>(*slice).container();
+  CHECK(caf::get<vector>(ys[0]).data() == cells);
+}
+
 TEST(equality) {
   auto slice1 = make_slice();
   auto slice2 = make_slice();
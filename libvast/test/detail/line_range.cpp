@@ -0,0 +1,85 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#define SUITE line_range
+#include "vast/test/test.hpp"
+
+#include "vast/detail/line_range.hpp"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "vast/chunk.hpp"
+#include "vast/detail/chunkbuf.hpp"
+
+using namespace vast;
+using namespace std::string_literals;
+
+namespace {
+
+auto input = "foo\n\nbar baz\r\n\n\nqux"s;
+
+std::vector<std::pair<size_t, std::string>> collect(std::istream& in) {
+  std::vector<std::pair<size_t, std::string>> result;
+  detail::line_range lines{in};
+  for (; !lines.done(); lines.next())
+    result.emplace_back(lines.line_number(), std::string{lines.get()});
+  return result;
+}
+
+const std::vector<std::pair<size_t, std::string>> expected = {
+  {1, "foo"},
+  {3, "bar baz\r"},
+  {6, "qux"},
+};
+
+} // namespace <anonymous>
+
+TEST(streamed lines) {
+  std::istringstream in{input};
+  CHECK(collect(in) == expected);
+}
+
+TEST(memory-mapped lines) {
+  auto deleter = [](char*, size_t) { /* nop */ };
+  auto chk = chunk::make(input.size(), input.data(), deleter);
+  detail::chunkbuf buf{chk};
+  std::istream in{&buf};
+  CHECK(collect(in) == expected);
+  MESSAGE("lines point into the chunk");
+  detail::chunkbuf other_buf{chk};
+  std::istream other_in{&other_buf};
+  detail::line_range lines{other_in};
+  CHECK(lines.get().data() == chk->data());
+}
+
+TEST(lines spanning blocks) {
+  auto line = std::string(detail::line_range::block_size + 42, 'x');
+  std::istringstream in{line + '\n' + line};
+  detail::line_range lines{in};
+  REQUIRE(!lines.done());
+  CHECK(lines.get() == line);
+  lines.next();
+  REQUIRE(!lines.done());
+  CHECK(lines.get() == line);
+  lines.next();
+  CHECK(lines.done());
+}
+
+TEST(empty input) {
+  std::istringstream in;
+  detail::line_range lines{in};
+  CHECK(lines.done());
+}
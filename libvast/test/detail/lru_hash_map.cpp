@@ -0,0 +1,80 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE detail
+#include "vast/test/test.hpp"
+
+#include "vast/detail/lru_hash_map.hpp"
+
+using namespace vast;
+
+namespace {
+
+// Sends many keys into the same cluster to exercise probing and shifting.
+struct colliding_hash {
+  size_t operator()(int x) const {
+    return x % 3;
+  }
+};
+
+} // namespace <anonymous>
+
+TEST(lru hash map eviction) {
+  detail::lru_hash_map<int, int> xs{3};
+  CHECK(xs.empty());
+  CHECK(xs.get_or_add(1, 10).second);
+  CHECK(xs.get_or_add(2, 20).second);
+  CHECK(xs.get_or_add(3, 30).second);
+  CHECK_EQUAL(xs.size(), 3u);
+  MESSAGE("accessing an entry protects it from eviction");
+  auto [x, added] = xs.get_or_add(1, 0);
+  CHECK(!added);
+  CHECK_EQUAL(*x, 10);
+  CHECK(xs.get_or_add(4, 40).second);
+  CHECK_EQUAL(xs.size(), 3u);
+  CHECK(xs.find(2) == nullptr);
+  REQUIRE(xs.find(1) != nullptr);
+  CHECK_EQUAL(*xs.find(3), 30);
+  MESSAGE("find leaves the access order untouched");
+  CHECK(xs.get_or_add(5, 50).second);
+  CHECK(xs.find(3) == nullptr);
+  MESSAGE("evict_while stops at the first entry to keep");
+  auto n = xs.evict_while([](int, int v) { return v < 45; });
+  CHECK_EQUAL(n, 2u);
+  CHECK_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(*xs.find(5), 50);
+}
+
+TEST(lru hash map collisions) {
+  detail::lru_hash_map<int, int, colliding_hash> xs{10};
+  for (auto i = 0; i < 10; ++i)
+    xs.get_or_add(i, i * 10);
+  CHECK(xs.erase(3));
+  CHECK(!xs.erase(3));
+  CHECK(xs.erase(0));
+  for (auto i = 0; i < 10; ++i) {
+    auto x = xs.find(i);
+    if (i == 0 || i == 3) {
+      CHECK(x == nullptr);
+    } else {
+      REQUIRE(x != nullptr);
+      CHECK_EQUAL(*x, i * 10);
+    }
+  }
+  MESSAGE("freed slots get reused");
+  CHECK(xs.get_or_add(42, 420).second);
+  CHECK(xs.get_or_add(43, 430).second);
+  CHECK_EQUAL(xs.size(), 10u);
+  CHECK_EQUAL(*xs.find(42), 420);
+  CHECK(xs.find(1) != nullptr);
+}
@@ -0,0 +1,67 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE detail
+#include "vast/test/test.hpp"
+
+#include "vast/detail/spsc_queue.hpp"
+
+#include <memory>
+#include <thread>
+
+using namespace vast;
+
+TEST(spsc queue bounds) {
+  detail::spsc_queue<std::unique_ptr<int>> q{2};
+  CHECK_EQUAL(q.capacity(), 2u);
+  CHECK(q.empty());
+  auto x = std::make_unique<int>(1);
+  CHECK(q.try_push(std::move(x)));
+  CHECK(q.try_push(std::make_unique<int>(2)));
+  MESSAGE("a failed push leaves the element untouched");
+  x = std::make_unique<int>(3);
+  CHECK(!q.try_push(std::move(x)));
+  REQUIRE(x != nullptr);
+  CHECK_EQUAL(*x, 3);
+  std::unique_ptr<int> y;
+  REQUIRE(q.try_pop(y));
+  CHECK_EQUAL(*y, 1);
+  CHECK(q.try_push(std::move(x)));
+  REQUIRE(q.try_pop(y));
+  CHECK_EQUAL(*y, 2);
+  REQUIRE(q.try_pop(y));
+  CHECK_EQUAL(*y, 3);
+  CHECK(!q.try_pop(y));
+  CHECK(q.empty());
+}
+
+TEST(spsc queue threads) {
+  constexpr size_t n = 100000;
+  detail::spsc_queue<size_t> q{64};
+  std::thread producer{[&] {
+    for (size_t i = 0; i < n; ++i)
+      while (!q.try_push(i))
+        std::this_thread::yield();
+  }};
+  size_t mismatches = 0;
+  for (size_t i = 0; i < n; ++i) {
+    size_t x;
+    while (!q.try_pop(x))
+      std::this_thread::yield();
+    if (x != i)
+      ++mismatches;
+  }
+  producer.join();
+  CHECK_EQUAL(mismatches, 0u);
+  CHECK(q.empty());
+}
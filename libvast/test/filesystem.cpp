@@ -11,6 +11,8 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <fstream>
+
 #include "vast/filesystem.hpp"
 #include "vast/detail/system.hpp"
 
@@ -179,3 +181,27 @@ TEST(file_and_directory_manipulation) {
   CHECK(rm(p.parent()));
   CHECK(!p.parent().is_directory());
 }
+
+TEST(globbing) {
+  path dir = "/tmp/vast-unit-test-glob-" + std::to_string(detail::process_id());
+  REQUIRE(mkdir(dir / "sub"));
+  for (auto name : {"conn.1.log", "conn.0.log", "dns.log"})
+    std::ofstream{(dir / name).str()} << "x\n";
+  MESSAGE("directories expand to the regular files they contain");
+  auto xs = glob(dir);
+  REQUIRE_EQUAL(xs.size(), 3u);
+  CHECK(xs[0] == dir / "conn.0.log");
+  CHECK(xs[1] == dir / "conn.1.log");
+  CHECK(xs[2] == dir / "dns.log");
+  MESSAGE("wildcards match within the parent directory");
+  xs = glob(dir / "conn.*.log");
+  REQUIRE_EQUAL(xs.size(), 2u);
+  CHECK(xs[0] == dir / "conn.0.log");
+  CHECK(xs[1] == dir / "conn.1.log");
+  CHECK(glob(dir / "*.pcap").empty());
+  MESSAGE("other paths expand to themselves");
+  xs = glob("-");
+  REQUIRE_EQUAL(xs.size(), 1u);
+  CHECK(xs[0] == path{"-"});
+  CHECK(rm(dir));
+}
@@ -0,0 +1,126 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include <sstream>
+
+#include <caf/streambuf.hpp>
+
+#include "vast/error.hpp"
+#include "vast/event.hpp"
+#include "vast/ids.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
+
+#include "vast/format/arrow.hpp"
+
+#define SUITE format
+#include "vast/test/test.hpp"
+#include "vast/test/fixtures/events.hpp"
+
+using namespace vast;
+
+namespace {
+
+// Writes all rows of `slices` in Arrow format.
+std::string write(const std::vector<table_slice_ptr>& slices) {
+  std::string str;
+  auto sb = new caf::containerbuf<std::string>{str};
+  format::arrow::writer writer{std::make_unique<std::ostream>(sb)};
+  for (auto& slice : slices) {
+    ids selection;
+    selection.append_bits(false, slice->offset());
+    selection.append_bits(true, slice->rows());
+    REQUIRE(writer.write(*slice, selection));
+  }
+  writer.cleanup();
+  return str;
+}
+
+// Reads table slices from Arrow data.
+std::vector<table_slice_ptr> read(std::string str) {
+  auto in = std::make_unique<std::istringstream>(std::move(str));
+  format::arrow::reader reader{std::move(in)};
+  std::vector<table_slice_ptr> result;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    result.emplace_back(std::move(x));
+  };
+  auto [err, produced] = reader.read_slices(size_t(-1), 100, f);
+  CHECK(err == ec::end_of_input);
+  return result;
+}
+
+// Checks that two sequences of slices contain the same rows.
+void check_rows(const std::vector<table_slice_ptr>& xs,
+                const std::vector<table_slice_ptr>& ys) {
+  auto flatten_rows = [](auto& slices) {
+    std::vector<std::pair<table_slice*, table_slice::size_type>> rows;
+    for (auto& slice : slices)
+      for (table_slice::size_type row = 0; row < slice->rows(); ++row)
+        rows.emplace_back(slice.get(), row);
+    return rows;
+  };
+  auto lhs = flatten_rows(xs);
+  auto rhs = flatten_rows(ys);
+  REQUIRE_EQUAL(lhs.size(), rhs.size());
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    auto [x, x_row] = lhs[i];
+    auto [y, y_row] = rhs[i];
+    CHECK_EQUAL(x->layout().name(), y->layout().name());
+    REQUIRE_EQUAL(x->columns(), y->columns());
+    for (table_slice::size_type col = 0; col < x->columns(); ++col)
+      CHECK_EQUAL(materialize(x->at(x_row, col)),
+                  materialize(y->at(y_row, col)));
+  }
+}
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(arrow_tests, fixtures::events)
+
+TEST(Arrow table slice roundtrip) {
+  MESSAGE("single layout");
+  check_rows(bro_conn_log_slices, read(write(bro_conn_log_slices)));
+  MESSAGE("layout changes");
+  auto slices = bgpdump_txt_slices;
+  slices.insert(slices.end(), bro_conn_log_slices.begin(),
+                bro_conn_log_slices.end());
+  slices.insert(slices.end(), bgpdump_txt_slices.begin(),
+                bgpdump_txt_slices.end());
+  check_rows(slices, read(write(slices)));
+}
+
+TEST(Arrow event roundtrip) {
+  std::string str;
+  auto sb = new caf::containerbuf<std::string>{str};
+  format::arrow::writer writer{std::make_unique<std::ostream>(sb)};
+  for (auto& e : bgpdump_txt)
+    REQUIRE(writer.write(e));
+  writer.cleanup();
+  format::arrow::reader reader{std::make_unique<std::istringstream>(str)};
+  std::vector<event> events;
+  auto e = expected<event>{no_error};
+  while (e || !e.error()) {
+    e = reader.read();
+    if (e)
+      events.push_back(std::move(*e));
+  }
+  CHECK(e.error() == ec::end_of_input);
+  REQUIRE_EQUAL(events.size(), bgpdump_txt.size());
+  for (size_t i = 0; i < events.size(); ++i) {
+    CHECK_EQUAL(events[i].type().name(), bgpdump_txt[i].type().name());
+    CHECK_EQUAL(events[i].timestamp(), bgpdump_txt[i].timestamp());
+    CHECK_EQUAL(events[i].data(), bgpdump_txt[i].data());
+  }
+}
+
+FIXTURE_SCOPE_END()
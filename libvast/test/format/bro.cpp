@@ -11,13 +11,23 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <map>
+#include <memory>
+#include <sstream>
+
 #include "vast/concept/parseable/to.hpp"
+#include "vast/detail/make_io_stream.hpp"
 #include "vast/event.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/pattern.hpp"
+#include "vast/subset.hpp"
+#include "vast/table_slice.hpp"
 
 #include "vast/format/bro.hpp"
 
 #define SUITE format
 #include "vast/test/test.hpp"
+#include "vast/test/data.hpp"
 #include "vast/test/fixtures/events.hpp"
 
 using namespace vast;
@@ -54,12 +64,52 @@ TEST(bro data parsing) {
   CHECK(d == *to<subnet>("10.0.0.0/24"));
   CHECK(bro_parse(port_type{}, "49329", d));
   CHECK(d == port{49329, port::unknown});
+  CHECK(bro_parse(pattern_type{}, "^ab*c$"s, d));
+  CHECK(d == pattern{"^ab*c$"});
   CHECK(bro_parse(vector_type{integer_type{}}, "49329", d));
   CHECK(d == vector{49329});
   CHECK(bro_parse(set_type{string_type{}}, "49329,42", d));
   CHECK(d == set{"49329", "42"});
 }
 
+TEST(bro field decoding) {
+  using namespace std::chrono;
+  auto decode = [](const type& t, std::string_view str, data& x) {
+    return format::bro::field_decoder{t, ","}(str, x);
+  };
+  data d;
+  CHECK(decode(boolean_type{}, "T", d));
+  CHECK(d == true);
+  CHECK(decode(integer_type{}, "-49329", d));
+  CHECK(d == integer{-49329});
+  CHECK(decode(count_type{}, "49329", d));
+  CHECK(d == count{49329});
+  CHECK(decode(real_type{}, "4.2", d));
+  CHECK(d == real{4.2});
+  CHECK(decode(timestamp_type{}, "1258594163.566694", d));
+  auto ts = duration_cast<timespan>(double_seconds{1258594163.566694});
+  CHECK(d == timestamp{ts});
+  CHECK(decode(timespan_type{}, "1258594163.566694", d));
+  CHECK(d == ts);
+  CHECK(decode(string_type{}, "\\x2afoo*", d));
+  CHECK(d == "*foo*");
+  MESSAGE("strings reuse the previous buffer");
+  CHECK(decode(string_type{}, "bar", d));
+  CHECK(d == "bar");
+  CHECK(!decode(string_type{}, "", d));
+  CHECK(decode(address_type{}, "192.168.1.103", d));
+  CHECK(d == *to<address>("192.168.1.103"));
+  CHECK(decode(subnet_type{}, "10.0.0.0/24", d));
+  CHECK(d == *to<subnet>("10.0.0.0/24"));
+  CHECK(decode(port_type{}, "49329", d));
+  CHECK(d == port{49329, port::unknown});
+  CHECK(decode(vector_type{integer_type{}}, "49329,-1", d));
+  CHECK(d == vector{49329, -1});
+  CHECK(decode(set_type{string_type{}}, "49329,42", d));
+  CHECK(d == set{"49329", "42"});
+  CHECK(!decode(set_type{count_type{}}, "1,x", d));
+}
+
 FIXTURE_SCOPE(bro_tests, fixtures::events)
 
 TEST(bro writer) {
@@ -85,4 +135,120 @@ TEST(bro writer) {
   CHECK(exists(dir / bro_http_log[0].type().name() + ".log"));
 }
 
+TEST(bro reader slices) {
+  auto stream = detail::make_input_stream(bro::small_conn);
+  REQUIRE(stream);
+  format::bro::reader reader{std::move(*stream)};
+  std::vector<table_slice_ptr> slices;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    slices.emplace_back(std::move(x));
+  };
+  MESSAGE("stop after the maximum number of events");
+  auto [err, produced] = reader.read_slices(15, 8, f);
+  CHECK(!err);
+  CHECK_EQUAL(produced, 15u);
+  CHECK_EQUAL(slices.size(), 1u);
+  MESSAGE("flush the partial slice when reaching the end of input");
+  std::tie(err, produced) = reader.read_slices(100, 8, f);
+  CHECK(err == ec::end_of_input);
+  CHECK_EQUAL(produced, 5u);
+  REQUIRE_EQUAL(slices.size(), 3u);
+  CHECK_EQUAL(slices[0]->rows(), 8u);
+  CHECK_EQUAL(slices[1]->rows(), 8u);
+  CHECK_EQUAL(slices[2]->rows(), 4u);
+  MESSAGE("compare against the event-based path");
+  std::vector<value> xs;
+  for (auto& slice : slices) {
+    CHECK_EQUAL(slice->layout().name(), "bro::conn");
+    // The first column is the automagically added timestamp.
+    auto ys = subset(*slice, 0, table_slice::npos, 1);
+    std::move(ys.begin(), ys.end(), std::back_inserter(xs));
+  }
+  REQUIRE_EQUAL(xs.size(), bro_conn_log.size());
+  for (size_t i = 0; i < xs.size(); ++i)
+    CHECK_EQUAL(xs[i], value{flatten(bro_conn_log[i])});
+}
+
+TEST(bro reader parallel slices) {
+  auto stream = detail::make_input_stream(bro::small_conn);
+  REQUIRE(stream);
+  format::bro::reader reader{std::move(*stream), 4};
+  std::vector<table_slice_ptr> slices;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    slices.emplace_back(std::move(x));
+  };
+  auto [err, produced] = reader.read_slices(100, 8, f);
+  CHECK(err == ec::end_of_input);
+  CHECK_EQUAL(produced, bro_conn_log.size());
+  REQUIRE_EQUAL(slices.size(), 3u);
+  MESSAGE("the slices arrive in input order");
+  std::vector<value> xs;
+  for (auto& slice : slices) {
+    auto ys = subset(*slice, 0, table_slice::npos, 1);
+    std::move(ys.begin(), ys.end(), std::back_inserter(xs));
+  }
+  REQUIRE_EQUAL(xs.size(), bro_conn_log.size());
+  for (size_t i = 0; i < xs.size(); ++i)
+    CHECK_EQUAL(xs[i], value{flatten(bro_conn_log[i])});
+}
+
+TEST(bro reader parallel slices with header changes) {
+  auto conn = unbox(load_contents(bro::small_conn));
+  auto dns = unbox(load_contents(bro::dns));
+  auto input = conn + dns;
+  // Collects the rows of each layout, without the timestamp column.
+  auto read = [&](size_t threads) {
+    auto in = std::make_unique<std::istringstream>(input);
+    format::bro::reader reader{std::move(in), threads};
+    std::map<std::string, std::vector<value>> rows;
+    format::reader::consumer f = [&](table_slice_ptr x) {
+      auto ys = subset(*x, 0, table_slice::npos, 1);
+      auto& zs = rows[x->layout().name()];
+      std::move(ys.begin(), ys.end(), std::back_inserter(zs));
+    };
+    auto [err, produced] = reader.read_slices(100, 8, f);
+    CHECK(err == ec::end_of_input);
+    CHECK_EQUAL(produced, bro_conn_log.size() + bro_dns_log.size());
+    return rows;
+  };
+  MESSAGE("the header changes within the first chunk");
+  auto serial = read(1);
+  auto parallel = read(4);
+  REQUIRE_EQUAL(serial.size(), 2u);
+  REQUIRE_EQUAL(parallel.size(), 2u);
+  for (auto& name : {"bro::conn"s, "bro::dns"s}) {
+    MESSAGE("compare " << name << " events");
+    auto& xs = serial[name];
+    auto& ys = parallel[name];
+    REQUIRE_EQUAL(xs.size(), ys.size());
+    for (size_t i = 0; i < xs.size(); ++i)
+      CHECK_EQUAL(xs[i], ys[i]);
+  }
+  CHECK_EQUAL(parallel["bro::conn"].size(), bro_conn_log.size());
+  CHECK_EQUAL(parallel["bro::dns"].size(), bro_dns_log.size());
+}
+
+TEST(bro reader pattern column) {
+  auto log = "#separator \\x09\n"
+             "#set_separator\t,\n"
+             "#empty_field\t(empty)\n"
+             "#unset_field\t-\n"
+             "#path\tre\n"
+             "#open\t2018-01-01-00-00-00\n"
+             "#fields\tts\tre\n"
+             "#types\ttime\tpattern\n"
+             "1258531221.486539\t^ab*c$\n"s;
+  format::bro::reader reader{std::make_unique<std::istringstream>(log)};
+  std::vector<table_slice_ptr> slices;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    slices.emplace_back(std::move(x));
+  };
+  auto [err, produced] = reader.read_slices(10, 8, f);
+  CHECK(err == ec::end_of_input);
+  CHECK_EQUAL(produced, 1u);
+  REQUIRE_EQUAL(slices.size(), 1u);
+  // The first column is the automagically added timestamp.
+  CHECK_EQUAL(materialize(slices[0]->at(0, 2)), data{pattern{"^ab*c$"}});
+}
+
 FIXTURE_SCOPE_END()
@@ -0,0 +1,131 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#define SUITE format
+#include "vast/test/test.hpp"
+
+#include "vast/format/json.hpp"
+
+#include <sstream>
+
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/event.hpp"
+#include "vast/schema.hpp"
+#include "vast/table_slice.hpp"
+
+using namespace vast;
+using namespace std::string_literals;
+
+namespace {
+
+auto input = R"__({"ts": 1258594163.5, "id": {"orig_h": "10.0.0.1", "orig_p": 80}, "proto": "tcp", "n": 42, "tags": ["a", "b"], "other": {"x": [1, {"y": "}"}]}}
+{"id.orig_h": "::1", "proto": "esc\"aped \u00e9", "n": "not a number"}
+this is no JSON
+
+{"n": 7}
+)__"s;
+
+type make_layout() {
+  auto t = type{record_type{
+    {"ts", timestamp_type{}},
+    {"id", record_type{
+      {"orig_h", address_type{}},
+      {"orig_p", port_type{}}
+    }},
+    {"proto", string_type{}},
+    {"n", count_type{}},
+    {"tags", set_type{string_type{}}}
+  }};
+  t.name("test");
+  return t;
+}
+
+format::json::reader make_reader() {
+  format::json::reader reader{std::make_unique<std::istringstream>(input)};
+  schema sch;
+  sch.add(make_layout());
+  reader.schema(std::move(sch));
+  return reader;
+}
+
+} // namespace <anonymous>
+
+TEST(json reader without schema) {
+  format::json::reader reader{std::make_unique<std::istringstream>(input)};
+  auto e = reader.read();
+  REQUIRE(!e);
+  CHECK(e.error() == ec::format_error);
+}
+
+TEST(json reader events) {
+  auto reader = make_reader();
+  REQUIRE(reader.schema());
+  MESSAGE("nested objects map onto nested records");
+  auto e = reader.read();
+  REQUIRE(e);
+  CHECK_EQUAL(e->type().name(), "test");
+  using std::chrono::duration_cast;
+  auto ts = timestamp{duration_cast<timespan>(double_seconds{1258594163.5})};
+  CHECK_EQUAL(e->timestamp(), ts);
+  auto xs = caf::get_if<vector>(&e->data());
+  REQUIRE(xs);
+  REQUIRE_EQUAL(xs->size(), 5u);
+  CHECK_EQUAL(xs->at(0), data{ts});
+  CHECK_EQUAL(xs->at(1), data(vector{*to<address>("10.0.0.1"),
+                                     port{80, port::unknown}}));
+  CHECK_EQUAL(xs->at(2), data{"tcp"});
+  CHECK_EQUAL(xs->at(3), data{count{42}});
+  CHECK_EQUAL(xs->at(4), data(set{"a", "b"}));
+  MESSAGE("dotted keys, escapes, and mismatching values");
+  e = reader.read();
+  REQUIRE(e);
+  xs = caf::get_if<vector>(&e->data());
+  REQUIRE(xs);
+  CHECK_EQUAL(xs->at(0), data{});
+  CHECK_EQUAL(xs->at(1), data(vector{*to<address>("::1"), data{}}));
+  CHECK_EQUAL(xs->at(2), data{"esc\"aped \xc3\xa9"});
+  CHECK_EQUAL(xs->at(3), data{});
+  MESSAGE("invalid lines are parse errors");
+  e = reader.read();
+  REQUIRE(!e);
+  CHECK(e.error() == ec::parse_error);
+  e = reader.read();
+  REQUIRE(e);
+  xs = caf::get_if<vector>(&e->data());
+  REQUIRE(xs);
+  CHECK_EQUAL(xs->at(3), data{count{7}});
+  e = reader.read();
+  REQUIRE(!e);
+  CHECK(e.error() == ec::end_of_input);
+}
+
+TEST(json reader slices) {
+  auto reader = make_reader();
+  REQUIRE(reader.schema());
+  std::vector<table_slice_ptr> slices;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    slices.emplace_back(std::move(x));
+  };
+  auto [err, produced] = reader.read_slices(100, 2, f);
+  CHECK(err == ec::end_of_input);
+  CHECK_EQUAL(produced, 3u);
+  REQUIRE_EQUAL(slices.size(), 2u);
+  CHECK_EQUAL(slices[0]->rows(), 2u);
+  CHECK_EQUAL(slices[1]->rows(), 1u);
+  MESSAGE("the first column holds the event timestamp");
+  CHECK_EQUAL(slices[0]->columns(), 7u);
+  CHECK_EQUAL(slices[0]->at(0, 2), make_view(*to<address>("10.0.0.1")));
+  CHECK_EQUAL(slices[1]->at(0, 5), make_view(count{7}));
+}
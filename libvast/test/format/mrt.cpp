@@ -1,4 +1,12 @@
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+
 #include "vast/filesystem.hpp"
+#include "vast/subset.hpp"
+#include "vast/table_slice.hpp"
 
 #include "vast/detail/make_io_stream.hpp"
 
@@ -12,6 +20,37 @@
 
 using namespace vast;
 
+namespace {
+
+// Appends a BGP4MP_STATE_CHANGE record between IPv4 peers to `buf`.
+void add_state_change(std::string& buf, uint32_t ts, uint16_t peer_as,
+                      uint16_t old_state, uint16_t new_state) {
+  auto put16 = [&](uint16_t x) {
+    buf.push_back(static_cast<char>(x >> 8));
+    buf.push_back(static_cast<char>(x & 0xff));
+  };
+  auto put32 = [&](uint32_t x) {
+    put16(static_cast<uint16_t>(x >> 16));
+    put16(static_cast<uint16_t>(x & 0xffff));
+  };
+  // Common Header
+  put32(ts);
+  put16(format::mrt::BGP4MP);
+  put16(format::mrt::bgp4mp::STATE_CHANGE);
+  put32(20);
+  // Message
+  put16(peer_as);
+  put16(64512);
+  put16(0);
+  put16(1);
+  put32(0x0a000001);
+  put32(0x0a000002);
+  put16(old_state);
+  put16(new_state);
+}
+
+} // namespace <anonymous>
+
 TEST_DISABLED(MRT) {
   auto in = detail::make_input_stream(mrt::updates20150505, false);
   format::mrt::reader reader{std::move(*in)};
@@ -69,3 +108,93 @@ TEST_DISABLED(MRT) {
   CHECK_EQUAL(as_path->at(2), count{47541});
   CHECK_EQUAL(as_path->at(3), count{28709});
 }
+
+TEST(MRT reader slices) {
+  std::string buf;
+  for (uint16_t i = 0; i < 1000; ++i)
+    add_state_change(buf, 1430784000 + i, i, i % 6, (i + 1) % 6);
+  for (size_t threads : {1u, 4u}) {
+    MESSAGE("parse records on " << threads << " threads");
+    auto in = std::make_unique<std::istringstream>(buf);
+    format::mrt::reader reader{std::move(in), threads};
+    std::vector<table_slice_ptr> slices;
+    format::reader::consumer f = [&](table_slice_ptr x) {
+      slices.emplace_back(std::move(x));
+    };
+    size_t produced = 0;
+    caf::error err;
+    while (!err) {
+      auto [e, n] = reader.read_slices(300, 100, f);
+      err = std::move(e);
+      produced += n;
+    }
+    CHECK(err == ec::end_of_input);
+    CHECK_EQUAL(produced, 1000u);
+    REQUIRE_EQUAL(slices.size(), 10u);
+    MESSAGE("the slices arrive in input order");
+    std::vector<value> xs;
+    for (auto& slice : slices) {
+      CHECK_EQUAL(slice->layout().name(), "mrt::bgp4mp::state_change");
+      CHECK_EQUAL(slice->rows(), 100u);
+      auto ys = subset(*slice, 0, table_slice::npos, 1);
+      std::move(ys.begin(), ys.end(), std::back_inserter(xs));
+    }
+    REQUIRE_EQUAL(xs.size(), 1000u);
+    for (size_t i = 0; i < xs.size(); ++i) {
+      auto record = caf::get_if<vector>(&xs[i].data());
+      REQUIRE(record);
+      CHECK_EQUAL(record->at(1), count{i});
+      CHECK_EQUAL(record->at(2), count{i % 6});
+    }
+  }
+  MESSAGE("a truncated record ends the input with an error");
+  buf.resize(buf.size() - 5);
+  auto in = std::make_unique<std::istringstream>(buf);
+  format::mrt::reader reader{std::move(in)};
+  format::reader::consumer f = [](table_slice_ptr) {};
+  auto [err, produced] = reader.read_slices(2000, 100, f);
+  CHECK(err == ec::format_error);
+  CHECK_EQUAL(produced, 999u);
+}
+
+TEST(MRT reader slices with uneven splits) {
+  std::string buf;
+  auto num_records = size_t{1001};
+  for (uint16_t i = 0; i < num_records; ++i)
+    add_state_change(buf, 1430784000 + i, i, i % 6, (i + 1) % 6);
+  for (size_t threads : {3u, 4u}) {
+    MESSAGE("parse " << num_records << " records on " << threads
+            << " threads");
+    auto in = std::make_unique<std::istringstream>(buf);
+    format::mrt::reader reader{std::move(in), threads};
+    std::vector<table_slice_ptr> slices;
+    format::reader::consumer f = [&](table_slice_ptr x) {
+      slices.emplace_back(std::move(x));
+    };
+    size_t produced = 0;
+    caf::error err;
+    while (!err) {
+      auto [e, n] = reader.read_slices(250, 64, f);
+      err = std::move(e);
+      produced += n;
+    }
+    CHECK(err == ec::end_of_input);
+    CHECK_EQUAL(produced, num_records);
+    REQUIRE_EQUAL(slices.size(), 16u);
+    MESSAGE("each slice covers the next contiguous range of records");
+    size_t rows = 0;
+    for (auto& slice : slices) {
+      auto expected_rows = std::min(size_t{64}, num_records - rows);
+      CHECK_EQUAL(slice->rows(), expected_rows);
+      auto xs = subset(*slice, 0, table_slice::npos, 1);
+      REQUIRE_EQUAL(xs.size(), slice->rows());
+      for (size_t i = 0; i < xs.size(); ++i) {
+        auto record = caf::get_if<vector>(&xs[i].data());
+        REQUIRE(record);
+        CHECK_EQUAL(record->at(1), count{rows + i});
+      }
+      rows += slice->rows();
+    }
+    CHECK_EQUAL(rows, num_records);
+  }
+}
@@ -13,6 +13,8 @@
 
 #include "vast/error.hpp"
 #include "vast/event.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
 
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
@@ -81,3 +83,21 @@ TEST(PCAP read/write 2) {
     if (!writer.write(e))
       FAIL("failed to write event");
 }
+
+TEST(PCAP read slices) {
+  format::pcap::reader reader{traces::nmap_vsn, uint64_t(-1), 5};
+  std::vector<table_slice_ptr> slices;
+  format::reader::consumer f = [&](table_slice_ptr x) {
+    slices.emplace_back(std::move(x));
+  };
+  auto [err, produced] = reader.read_slices(100, 16, f);
+  CHECK(err == ec::end_of_input);
+  CHECK_EQUAL(produced, 44u);
+  REQUIRE_EQUAL(slices.size(), 3u);
+  CHECK_EQUAL(slices[0]->rows(), 16u);
+  CHECK_EQUAL(slices[1]->rows(), 16u);
+  CHECK_EQUAL(slices[2]->rows(), 12u);
+  MESSAGE("columns hold timestamp, connection, and payload");
+  CHECK_EQUAL(slices[2]->columns(), 6u);
+  CHECK_EQUAL(slices[2]->at(11, 1), make_view(*to<address>("192.168.1.1")));
+}
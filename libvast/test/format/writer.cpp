@@ -12,19 +12,31 @@
  ******************************************************************************/
 
 #include "vast/detail/string.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/ids.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/to_events.hpp"
 
 #include "vast/format/ascii.hpp"
+#include "vast/format/bro.hpp"
 #include "vast/format/csv.hpp"
 #include "vast/format/json.hpp"
 
 #define SUITE format
 #include "vast/test/test.hpp"
 #include "vast/test/fixtures/events.hpp"
+#include "vast/test/fixtures/filesystem.hpp"
 
 using namespace vast;
 using namespace std::string_literals;
 
-FIXTURE_SCOPE(ascii_tests, fixtures::events)
+namespace {
+
+struct fixture : fixtures::events, fixtures::filesystem {};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(ascii_tests, fixture)
 
 namespace {
 
@@ -54,6 +66,79 @@ std::vector<std::string> generate(const std::vector<event>& xs) {
   return lines;
 }
 
+// Selects every third event of `slices`.
+ids every_third(const std::vector<table_slice_ptr>& slices) {
+  ids selection;
+  for (auto& slice : slices) {
+    selection.append_bits(false, slice->offset() - selection.size());
+    for (size_t i = 0; i < slice->rows(); ++i)
+      selection.append_bit(i % 3 == 0);
+  }
+  return selection;
+}
+
+// Writes every third event of `slices`, either in batches or per event.
+template <class Writer>
+void write_every_third(Writer& writer,
+                       const std::vector<table_slice_ptr>& slices, bool batch) {
+  auto selection = every_third(slices);
+  for (auto& slice : slices) {
+    if (batch) {
+      if (!writer.write(*slice, selection))
+        FAIL("failed to write table slice");
+    } else {
+      for (auto& e : to_events(*slice, selection))
+        if (!writer.write(e))
+          FAIL("failed to write event");
+    }
+  }
+  writer.flush();
+}
+
+// Renders every third event of `slices`, either in batches or per event.
+template <class Writer>
+std::string render(const std::vector<table_slice_ptr>& slices, bool batch) {
+  std::string str;
+  auto sb = new caf::containerbuf<std::string>{str};
+  auto out = std::make_unique<std::ostream>(sb);
+  Writer writer{std::move(out)};
+  write_every_third(writer, slices, batch);
+  REQUIRE(!str.empty());
+  return str;
+}
+
+// Renders every third event of `slices` into a Bro log in `dir`, either in
+// batches or per event. Omits the #open header line, which carries the
+// current time.
+std::string render_bro(const std::vector<table_slice_ptr>& slices, bool batch,
+                       const path& dir) {
+  {
+    format::bro::writer writer{dir};
+    write_every_third(writer, slices, batch);
+  }
+  auto filename = dir / (slices.front()->layout().name() + ".log");
+  auto contents = unbox(load_contents(filename));
+  std::string result;
+  for (auto& line : detail::split(contents, "\n"))
+    if (line.substr(0, 5) != "#open") {
+      result += line;
+      result += '\n';
+    }
+  REQUIRE(!result.empty());
+  return result;
+}
+
+template <class Writer>
+void check_batches(const std::vector<table_slice_ptr>& slices) {
+  CHECK_EQUAL(render<Writer>(slices, true), render<Writer>(slices, false));
+}
+
+void check_bro_batches(const std::vector<table_slice_ptr>& slices,
+                       const path& dir) {
+  CHECK_EQUAL(render_bro(slices, true, dir / "batch"),
+              render_bro(slices, false, dir / "event"));
+}
+
 } // namespace <anonymous>
 
 TEST(Bro writer) {
@@ -78,4 +163,19 @@ TEST(JSON writer) {
   CHECK_EQUAL(lines.front(), first_json_bgpdump_txt_line);
 }
 
+TEST(table slice batches) {
+  MESSAGE("ASCII");
+  check_batches<format::ascii::writer>(bro_conn_log_slices);
+  check_batches<format::ascii::writer>(bgpdump_txt_slices);
+  MESSAGE("CSV");
+  check_batches<format::csv::writer>(bro_conn_log_slices);
+  check_batches<format::csv::writer>(bgpdump_txt_slices);
+  MESSAGE("JSON");
+  check_batches<format::json::writer>(bro_conn_log_slices);
+  check_batches<format::json::writer>(bgpdump_txt_slices);
+  MESSAGE("Bro");
+  check_bro_batches(bro_conn_log_slices, directory / "conn");
+  check_bro_batches(bgpdump_txt_slices, directory / "bgpdump");
+}
+
 FIXTURE_SCOPE_END()
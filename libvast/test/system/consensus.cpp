@@ -11,6 +11,9 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <fstream>
+#include <map>
+
 #include <caf/all.hpp>
 
 #include "vast/system/atoms.hpp"
@@ -29,6 +32,70 @@ using namespace vast::system;
 
 FIXTURE_SCOPE(leader_tests, fixtures::actor_system)
 
+namespace {
+
+std::vector<raft::log_entry> make_entries(raft::index_type first, size_t n,
+                                          raft::term_type term = 1) {
+  std::vector<raft::log_entry> xs(n);
+  for (size_t i = 0; i < n; ++i) {
+    xs[i].term = term;
+    xs[i].index = first + i;
+    xs[i].data.assign(100, static_cast<char>('a' + i));
+  }
+  return xs;
+}
+
+size_t num_segments(const path& dir) {
+  size_t result = 0;
+  for (auto& x : vast::directory{dir / "segments"}) {
+    static_cast<void>(x);
+    ++result;
+  }
+  return result;
+}
+
+} // namespace <anonymous>
+
+TEST(segmented log) {
+  directory /= "log";
+  {
+    // Each segment holds 5 entries.
+    raft::log l{sys, directory, 512};
+    REQUIRE(l.append(make_entries(1, 10)));
+    CHECK_EQUAL(l.last_index(), 10u);
+    REQUIRE(l.persist());
+    CHECK_EQUAL(l.last_persisted_index(), 10u);
+    CHECK_EQUAL(num_segments(directory), 2u);
+    MESSAGE("truncate the back within a segment");
+    CHECK_EQUAL(l.truncate_after(6), 4u);
+    CHECK_EQUAL(l.last_persisted_index(), 6u);
+    REQUIRE(l.append(make_entries(7, 2, 2)));
+    MESSAGE("truncate the front by deleting segments");
+    REQUIRE(l.persist());
+    CHECK_EQUAL(l.truncate_before(7), 6u);
+    CHECK_EQUAL(num_segments(directory), 1u);
+  }
+  MESSAGE("append an incomplete write");
+  {
+    std::ofstream segment{(directory / "segments" / "6").str(),
+                          std::ios::binary | std::ios::app};
+    segment << "garbage";
+  }
+  MESSAGE("reload the log");
+  raft::log l{sys, directory, 512};
+  CHECK_EQUAL(l.first_index(), 7u);
+  CHECK_EQUAL(l.last_index(), 8u);
+  CHECK_EQUAL(l.last_persisted_index(), 8u);
+  for (raft::index_type i = 7; i <= 8; ++i) {
+    CHECK_EQUAL(l.at(i).index, i);
+    CHECK_EQUAL(l.at(i).term, 2u);
+    CHECK_EQUAL(l.at(i).data.size(), 100u);
+  }
+  REQUIRE(l.append(make_entries(9, 1, 2)));
+  REQUIRE(l.persist());
+  CHECK_EQUAL(l.last_index(), 9u);
+}
+
 TEST(single leader) {
   directory /= "server";
   auto server = self->spawn(raft::consensus, directory);
@@ -111,6 +178,53 @@ TEST(basic operations) {
   await(2);
 }
 
+TEST(pipelined replication) {
+  MESSAGE("submitting commands without waiting for responses");
+  auto n = raft::index_type{100};
+  for (raft::index_type i = 0; i < n; ++i)
+    anon_send(server1, replicate_atom::value, make_message(i));
+  MESSAGE("awaiting in-order delivery at all servers");
+  std::map<actor_addr, raft::index_type> last;
+  auto i = raft::index_type{0};
+  self->receive_for(i, 3 * n)(
+    [&](raft::index_type index, const caf::message&) {
+      auto& x = last[actor_cast<actor_addr>(self->current_sender())];
+      CHECK_EQUAL(index, x == 0 ? 2 : x + 1);
+      x = index;
+    },
+    error_handler()
+  );
+  REQUIRE_EQUAL(last.size(), 3u);
+  for (auto& x : last)
+    CHECK_EQUAL(x.second, n + 1);
+}
+
+TEST(follower acks ahead of leader persistence) {
+  MESSAGE("submitting commands in bursts that span heartbeats");
+  // Heartbeats and acknowledgements ship entries that the leader appended
+  // but not yet persisted, so follower acks can outrun the group commit.
+  auto n = raft::index_type{50};
+  for (raft::index_type i = 0; i < n; ++i) {
+    anon_send(server1, replicate_atom::value, make_message(i));
+    if (i % 10 == 9)
+      std::this_thread::sleep_for(raft::heartbeat_period);
+  }
+  MESSAGE("awaiting in-order delivery at all servers");
+  std::map<actor_addr, raft::index_type> last;
+  auto i = raft::index_type{0};
+  self->receive_for(i, 3 * n)(
+    [&](raft::index_type index, const caf::message&) {
+      auto& x = last[actor_cast<actor_addr>(self->current_sender())];
+      CHECK_EQUAL(index, x == 0 ? 2 : x + 1);
+      x = index;
+    },
+    error_handler()
+  );
+  REQUIRE_EQUAL(last.size(), 3u);
+  for (auto& x : last)
+    CHECK_EQUAL(x.second, n + 1);
+}
+
 TEST(manual snapshotting) {
   MESSAGE("replicating commands");
   replicate(server1, make_message("foo"));
@@ -62,6 +62,16 @@ caf::behavior test_sink(test_sink_type* self, caf::actor src) {
   };
 }
 
+caf::io::new_datagram_msg make_datagram(const char* filename) {
+  caf::io::new_datagram_msg msg;
+  msg.handle = caf::io::datagram_handle::from_int(2);
+  using iter = std::istreambuf_iterator<char>;
+  std::ifstream in{filename};
+  REQUIRE(in.good());
+  msg.buf.assign(iter{in}, iter{});
+  return msg;
+}
+
 } // namespace <anonymous>
 
 FIXTURE_SCOPE(source_tests, fixtures::deterministic_actor_system_and_events)
@@ -100,4 +110,68 @@ TEST(bro conn source) {
   run();
 }
 
+TEST(bro conn source with a burst of datagrams) {
+  namespace bf = format::bro;
+  bf::reader reader;
+  auto hdl = caf::io::datagram_handle::from_int(1);
+  auto& mm = sys.middleman();
+  mpx.provide_datagram_servant(8080, hdl);
+  auto src = mm.spawn_broker(datagram_source<bf::reader>, uint16_t{8080},
+                             std::move(reader),
+                             default_table_slice::make_builder, 100u);
+  run();
+  auto snk = self->spawn(test_sink, src);
+  run();
+  MESSAGE("limit the source to buffering two datagrams");
+  auto datagram = make_datagram(bro::small_conn);
+  auto& src_state = deref<datagram_source_actor<bf::reader>>(src).state;
+  src_state.max_buffer_size = 2 * (datagram.buf.size() + 1);
+  MESSAGE("'send' three datagrams before the source gets to run");
+  for (auto i = 0; i < 3; ++i)
+    anon_send(src, datagram);
+  run();
+  MESSAGE("verify that the source parsed two datagrams into one slice");
+  auto& st = deref<test_sink_type>(snk).state;
+  REQUIRE_EQUAL(st.slices.size(), 1u);
+  CHECK_EQUAL(st.slices.front()->rows(), 40u);
+  CHECK_EQUAL(src_state.dropped_datagrams, 1u);
+  anon_send_exit(src, caf::exit_reason::user_shutdown);
+  run();
+}
+
+TEST(bro conn source frees the budget of parsed datagrams) {
+  namespace bf = format::bro;
+  bf::reader reader;
+  auto hdl = caf::io::datagram_handle::from_int(1);
+  auto& mm = sys.middleman();
+  mpx.provide_datagram_servant(8080, hdl);
+  auto src = mm.spawn_broker(datagram_source<bf::reader>, uint16_t{8080},
+                             std::move(reader),
+                             default_table_slice::make_builder, 100u);
+  run();
+  auto snk = self->spawn(test_sink, src);
+  run();
+  MESSAGE("limit the source to buffering two datagrams");
+  auto datagram = make_datagram(bro::small_conn);
+  auto& src_state = deref<datagram_source_actor<bf::reader>>(src).state;
+  src_state.max_buffer_size = 2 * (datagram.buf.size() + 1);
+  MESSAGE("fill the budget with two datagrams and parse them in full");
+  for (auto i = 0; i < 2; ++i)
+    anon_send(src, datagram);
+  run();
+  CHECK(!src_state.parsing);
+  CHECK(src_state.active.empty());
+  MESSAGE("buffer two more datagrams without dropping any");
+  for (auto i = 0; i < 2; ++i)
+    anon_send(src, datagram);
+  run();
+  auto& st = deref<test_sink_type>(snk).state;
+  REQUIRE_EQUAL(st.slices.size(), 2u);
+  CHECK_EQUAL(st.slices.front()->rows(), 40u);
+  CHECK_EQUAL(st.slices.back()->rows(), 40u);
+  CHECK_EQUAL(src_state.dropped_datagrams, 0u);
+  anon_send_exit(src, caf::exit_reason::user_shutdown);
+  run();
+}
+
 FIXTURE_SCOPE_END()
@@ -11,10 +11,17 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <algorithm>
+#include <vector>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
 
+#include "vast/defaults.hpp"
+#include "vast/ids.hpp"
 #include "vast/query_options.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/to_events.hpp"
 
 #include "vast/system/archive.hpp"
 #include "vast/system/exporter.hpp"
@@ -38,6 +45,49 @@ namespace {
 
 using fixture_base = fixtures::deterministic_actor_system_and_events;
 
+// Consumes the result stream of an EXPORTER and relays the events of each
+// slice to `client`.
+behavior relay_sink(event_based_actor* self, actor client) {
+  return {
+    [=](stream<table_slice_ptr> in) {
+      return self->make_sink(
+        in,
+        [](unit_t&) {
+          // nop
+        },
+        [=](unit_t&, const table_slice_ptr& slice) {
+          self->send(client, to_events(*slice));
+        },
+        [](unit_t&, const error&) {
+          // nop
+        }
+      );
+    },
+    [](const uuid&, const system::query_statistics&) {
+      // nop
+    },
+  };
+}
+
+struct mock_index_state {
+  /// The number of partitions in each request for more hits.
+  std::vector<size_t> requests;
+  static inline const char* name = "mock-index";
+};
+
+// Answers a query with 3 partitions, 2 of which it claims to have scheduled,
+// and records all requests for more partitions. The test sends the hits.
+behavior mock_index(stateful_actor<mock_index_state>* self) {
+  return {
+    [=](const expression&) {
+      return make_message(uuid::nil(), size_t{3}, size_t{2});
+    },
+    [=](const uuid&, size_t n) {
+      self->state.requests.push_back(n);
+    },
+  };
+}
+
 struct fixture : fixture_base {
   fixture() {
     expr = unbox(to<expression>("service == \"dns\" "
@@ -45,7 +95,7 @@ struct fixture : fixture_base {
   }
 
   ~fixture() {
-    for (auto& hdl : {index, importer, exporter, consensus})
+    for (auto& hdl : {index, importer, exporter, consensus, sink})
       self->send_exit(hdl, exit_reason::user_shutdown);
     self->send_exit(archive, exit_reason::user_shutdown);
     self->send_exit(meta_store, exit_reason::user_shutdown);
@@ -77,6 +127,7 @@ struct fixture : fixture_base {
 
   void spawn_exporter(query_options opts) {
     exporter = self->spawn(system::exporter, expr, opts);
+    sink = self->spawn(relay_sink, actor_cast<actor>(self));
   }
 
   void importer_setup() {
@@ -100,7 +151,7 @@ struct fixture : fixture_base {
     spawn_exporter(opts);
     send(exporter, archive);
     send(exporter, system::index_atom::value, index);
-    send(exporter, system::sink_atom::value, self);
+    send(exporter, system::sink_atom::value, sink);
     send(exporter, system::run_atom::value);
     send(exporter, system::extract_atom::value);
     run();
@@ -111,6 +162,19 @@ struct fixture : fixture_base {
     self->send(hdl, std::forward<Ts>(xs)...);
   }
 
+  // Runs all actors but `hdl`, which thus never grants stream credit.
+  void run_without(const actor& hdl) {
+    auto ptr = static_cast<resumable*>(&deref(hdl));
+    auto other = [&](resumable* job) { return job != ptr; };
+    for (;;) {
+      auto i = std::find_if(sched.jobs.begin(), sched.jobs.end(), other);
+      if (i == sched.jobs.end())
+        return;
+      std::iter_swap(sched.jobs.begin(), i);
+      sched.run_once();
+    }
+  }
+
   auto fetch_results() {
     std::vector<event> result;
     bool done = false;
@@ -132,6 +196,7 @@ struct fixture : fixture_base {
   system::archive_type archive;
   actor importer;
   actor exporter;
+  actor sink;
   actor consensus;
   system::meta_store_type meta_store;
   expression expr;
@@ -161,6 +226,71 @@ TEST(historical query without importer) {
   CHECK_EQUAL(results.back().id(), 19u);
 }
 
+TEST(historical query with limit) {
+  MESSAGE("spawn index and archive");
+  spawn_index();
+  spawn_archive();
+  run();
+  MESSAGE("ingest conn.log into archive and index");
+  vast::detail::spawn_container_source(sys, bro_conn_log_slices, index,
+                                       archive);
+  run();
+  MESSAGE("spawn exporter for historical query with 3 results");
+  spawn_exporter(historical);
+  send(exporter, archive);
+  send(exporter, system::index_atom::value, index);
+  send(exporter, system::sink_atom::value, sink);
+  send(exporter, system::run_atom::value);
+  send(exporter, system::extract_atom::value, uint64_t{3});
+  run();
+  MESSAGE("fetch results");
+  auto results = fetch_results();
+  REQUIRE_EQUAL(results.size(), 3u);
+  std::sort(results.begin(), results.end());
+  CHECK_EQUAL(results.front().id(), 10u);
+  CHECK_EQUAL(results.front().type().name(), "bro::conn");
+}
+
+TEST(historical query with backpressure) {
+  MESSAGE("ingest conn.log into archive");
+  spawn_archive();
+  run();
+  vast::detail::spawn_container_source(sys, bro_conn_log_slices, archive);
+  run();
+  MESSAGE("spawn exporter with a small buffer and a stalled sink");
+  index = self->spawn(mock_index);
+  auto max_results = defaults::system::max_exporter_results;
+  defaults::system::max_exporter_results = 2;
+  spawn_exporter(historical);
+  defaults::system::max_exporter_results = max_results;
+  send(exporter, archive);
+  send(exporter, system::index_atom::value, index);
+  send(exporter, system::sink_atom::value, sink);
+  send(exporter, system::run_atom::value);
+  send(exporter, system::extract_atom::value);
+  run_without(sink);
+  auto& st = deref<stateful_actor<system::exporter_state>>(exporter).state;
+  auto& requests
+    = deref<stateful_actor<mock_index_state>>(index).state.requests;
+  MESSAGE("the results of the first partition fill the buffer");
+  send(exporter, make_ids({{10, 20}}));
+  run_without(sink);
+  CHECK_EQUAL(st.buffered, 5u);
+  CHECK(st.lookups.empty());
+  MESSAGE("the hits of the second partition wait for buffer space");
+  send(exporter, make_ids({{0, 10}}));
+  run_without(sink);
+  CHECK_EQUAL(st.lookups.size(), 1u);
+  CHECK(requests.empty());
+  MESSAGE("credit from the sink resumes the lookups");
+  run();
+  auto results = fetch_results();
+  CHECK_EQUAL(results.size(), 5u);
+  CHECK(st.lookups.empty());
+  CHECK_EQUAL(st.buffered, 0u);
+  CHECK_EQUAL(requests, std::vector<size_t>{1});
+}
+
 TEST(historical query with importer) {
   MESSAGE("prepare importer");
   importer_setup();
@@ -184,7 +314,7 @@ TEST(historical query with importer) {
 TEST(continuous query with exporter only) {
   MESSAGE("prepare exporter for continuous query");
   spawn_exporter(continuous);
-  send(exporter, system::sink_atom::value, self);
+  send(exporter, system::sink_atom::value, sink);
   send(exporter, system::extract_atom::value);
   run();
   MESSAGE("send conn.log directly to exporter");
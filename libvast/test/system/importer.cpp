@@ -252,6 +252,31 @@ TEST(deterministic importer with one sink and failing bro source) {
   );
 }
 
+TEST(deterministic importer restores unused IDs) {
+  MESSAGE("import events");
+  add_sink();
+  make_source();
+  consume_message();
+  run();
+  verify(fetch_result(), bro_conn_log);
+  MESSAGE("shut down importer cleanly");
+  self->send_exit(importer, exit_reason::user_shutdown);
+  run();
+  MESSAGE("restart importer on the same directory");
+  auto restarted = self->spawn(system::importer, directory, slice_size);
+  self->send(restarted, system::status_atom::value);
+  run();
+  self->receive([&](caf::dictionary<caf::config_value>& xs) {
+    auto available = caf::get_if<int64_t>(&xs["available-ids"]);
+    REQUIRE(available);
+    CHECK_GREATER(*available, 0);
+    CHECK_EQUAL(*available % static_cast<int64_t>(slice_size), 0);
+    CHECK(caf::get_if<int64_t>(&xs["next-id"]));
+  });
+  anon_send_exit(restarted, exit_reason::user_shutdown);
+  run();
+}
+
 FIXTURE_SCOPE_END()
 
 // -- nondeterministic testing -------------------------------------------------
@@ -0,0 +1,98 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE system
+#include "vast/test/test.hpp"
+
+#include "vast/system/partition_scheduler.hpp"
+
+using namespace std::chrono_literals;
+using namespace vast;
+using namespace vast::system;
+
+namespace {
+
+struct fixture {
+  partition_scheduler scheduler;
+  partition_scheduler::clock::time_point t0;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(partition_scheduler_tests, fixture)
+
+TEST(waiting for taste) {
+  scheduler.start(10, 2, t0);
+  CHECK_EQUAL(scheduler.remaining(), 8u);
+  CHECK_EQUAL(scheduler.inflight(), 2u);
+  CHECK_EQUAL(scheduler.next(100), 0u);
+}
+
+TEST(empty taste) {
+  scheduler.start(10, 0, t0);
+  CHECK_EQUAL(scheduler.next(0), 0u);
+  CHECK_EQUAL(scheduler.next(100), 1u);
+}
+
+TEST(slow start) {
+  scheduler.start(10, 2, t0);
+  scheduler.partition_done(10, t0 + 1ms);
+  CHECK_EQUAL(scheduler.hits_per_partition(), 10.0);
+  MESSAGE("pending partition covers the demand");
+  CHECK_EQUAL(scheduler.next(5), 0u);
+  MESSAGE("batch size grows at most twofold");
+  CHECK_EQUAL(scheduler.next(100), 4u);
+  CHECK_EQUAL(scheduler.next(25), 2u);
+  scheduler.schedule(4, t0 + 1ms);
+  CHECK_EQUAL(scheduler.remaining(), 4u);
+  scheduler.partition_done(10, t0 + 2ms);
+  CHECK(scheduler.index_latency() == 2ms);
+  CHECK_EQUAL(scheduler.next(1000), 4u);
+}
+
+TEST(batches in flight) {
+  scheduler.start(100, 1, t0);
+  scheduler.partition_done(1, t0 + 1ms);
+  for (size_t i = 0; i < partition_scheduler::max_batches; ++i) {
+    CHECK_GREATER(scheduler.next(1000), 0u);
+    scheduler.schedule(1, t0 + 1ms);
+  }
+  CHECK_EQUAL(scheduler.next(1000), 0u);
+  scheduler.partition_done(1, t0 + 2ms);
+  CHECK_GREATER(scheduler.next(1000), 0u);
+}
+
+TEST(archive backlog) {
+  scheduler.start(10, 1, t0);
+  scheduler.partition_done(100, t0 + 1ms);
+  scheduler.lookup_sent(100, t0 + 1ms);
+  scheduler.lookup_done(100, 10, t0 + 11ms);
+  CHECK(scheduler.archive_latency() == 10ms);
+  CHECK_EQUAL(scheduler.selectivity(), 0.1);
+  MESSAGE("the index runs ahead of the archive");
+  scheduler.lookup_sent(100, t0 + 11ms);
+  CHECK_EQUAL(scheduler.next(50), 0u);
+  scheduler.lookup_done(100, 10, t0 + 21ms);
+  CHECK_EQUAL(scheduler.next(50), 2u);
+}
+
+TEST(exhausted partitions) {
+  scheduler.start(2, 2, t0);
+  scheduler.partition_done(1, t0 + 1ms);
+  scheduler.partition_done(1, t0 + 1ms);
+  CHECK_EQUAL(scheduler.remaining(), 0u);
+  CHECK_EQUAL(scheduler.inflight(), 0u);
+  CHECK_EQUAL(scheduler.next(100), 0u);
+}
+
+FIXTURE_SCOPE_END()
@@ -97,6 +97,52 @@ TEST(single replicated store) {
   self->wait_for(store);
 }
 
+TEST(chunked snapshot) {
+  auto store = self->spawn(replicated_store<int, std::string>, server1);
+  MESSAGE("filling the store beyond a single snapshot chunk");
+  auto value = std::string(64 << 10, 'x');
+  for (auto i = 0; i < 40; ++i)
+    self->request(store, timeout, put_atom::value, i, value).receive(
+      [](ok_atom) { /* nop */ },
+      error_handler()
+    );
+  MESSAGE("modifying the store while snapshotting");
+  auto snapshot = self->request(store, timeout, snapshot_atom::value);
+  self->request(store, timeout, put_atom::value, 0, std::string{"foo"}).receive(
+    [](ok_atom) { /* nop */ },
+    error_handler()
+  );
+  snapshot.receive(
+    [](ok_atom) { /* nop */ },
+    error_handler()
+  );
+  self->send_exit(store, exit_reason::user_shutdown);
+  self->wait_for(store);
+  MESSAGE("restarting consensus quorum and store");
+  shutdown();
+  launch();
+  store = self->spawn(replicated_store<int, std::string>, server1);
+  MESSAGE("sleeping until state replay finishes");
+  std::this_thread::sleep_for(raft::heartbeat_period * 2);
+  MESSAGE("checking value persistence");
+  self->request(store, timeout, get_atom::value, 0).receive(
+    [&](optional<std::string> x) {
+      REQUIRE(x);
+      CHECK_EQUAL(*x, "foo");
+    },
+    error_handler()
+  );
+  self->request(store, timeout, get_atom::value, 39).receive(
+    [&](optional<std::string> x) {
+      REQUIRE(x);
+      CHECK_EQUAL(*x, value);
+    },
+    error_handler()
+  );
+  self->send_exit(store, exit_reason::user_shutdown);
+  self->wait_for(store);
+}
+
 TEST(multiple replicated stores) {
   auto store1 = self->spawn(replicated_store<int, int>, server1);
   auto store2 = self->spawn(replicated_store<int, int>, server2);
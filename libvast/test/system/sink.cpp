@@ -11,10 +11,14 @@
  * contained in the LICENSE file.                                             *
  ******************************************************************************/
 
+#include <fstream>
+
 #include "vast/error.hpp"
 #include "vast/format/bro.hpp"
 #include "vast/system/sink.hpp"
 
+#include "vast/detail/spawn_container_source.hpp"
+
 #define SUITE system
 #include "vast/test/test.hpp"
 #include "vast/test/data.hpp"
@@ -38,3 +42,28 @@ TEST(Bro sink) {
 }
 
 FIXTURE_SCOPE_END()
+
+FIXTURE_SCOPE(sink_stream_tests,
+              fixtures::deterministic_actor_system_and_events)
+
+TEST(Bro sink with table slice stream) {
+  MESSAGE("constructing a sink");
+  format::bro::writer writer{directory};
+  auto snk = self->spawn(sink<format::bro::writer>, std::move(writer), 0u);
+  run();
+  MESSAGE("streaming table slices");
+  vast::detail::spawn_container_source(sys, bro_conn_log_slices, snk);
+  run();
+  MESSAGE("shutting down");
+  self->send_exit(snk, caf::exit_reason::user_shutdown);
+  run();
+  std::ifstream log{(directory / "bro::conn.log").str()};
+  REQUIRE(log);
+  size_t rows = 0;
+  for (std::string line; std::getline(log, line);)
+    if (!line.empty() && line[0] != '#')
+      ++rows;
+  CHECK_EQUAL(rows, bro_conn_log.size());
+}
+
+FIXTURE_SCOPE_END()
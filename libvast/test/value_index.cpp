@@ -258,6 +258,144 @@ TEST(string) {
   CHECK_EQUAL(to_string(*result), "1001100000");
   result = idx2.lookup(equal, make_data_view("bar"));
   CHECK_EQUAL(to_string(*result), "0100010000");
+  MESSAGE("reject other formats");
+  buf.clear();
+  CHECK_EQUAL(save(sys, buf, string_index::magic, string_index::version + 1),
+              caf::none);
+  string_index idx3{};
+  CHECK(load(sys, buf, idx3) == ec::version_error);
+}
+
+TEST(string with dictionary fallback) {
+  string_index idx{100, false, 3};
+  MESSAGE("append low-cardinality strings");
+  REQUIRE(idx.append(make_data_view("GET")));
+  REQUIRE(idx.append(make_data_view("POST")));
+  REQUIRE(idx.append(make_data_view(caf::none)));
+  REQUIRE(idx.append(make_data_view("GET")));
+  REQUIRE(idx.append(make_data_view("PUT"), 5));
+  CHECK(idx.dictionary_encoded());
+  auto result = idx.lookup(equal, make_data_view("GET"));
+  CHECK_EQUAL(to_string(*result), "100100");
+  result = idx.lookup(not_equal, make_data_view("GET"));
+  CHECK_EQUAL(to_string(*result), "010001");
+  result = idx.lookup(ni, make_data_view("T"));
+  CHECK_EQUAL(to_string(*result), "110101");
+  result = idx.lookup(match, make_data_view(pattern{"P.*"}));
+  CHECK_EQUAL(to_string(*result), "010001");
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  CHECK_EQUAL(save(sys, buf, idx), caf::none);
+  string_index idx2{};
+  CHECK_EQUAL(load(sys, buf, idx2), caf::none);
+  CHECK(idx2.dictionary_encoded());
+  result = idx2.lookup(equal, make_data_view("POST"));
+  CHECK_EQUAL(to_string(*result), "010000");
+  MESSAGE("exceed the maximum cardinality");
+  REQUIRE(idx2.append(make_data_view("HEAD")));
+  CHECK(!idx2.dictionary_encoded());
+  result = idx2.lookup(equal, make_data_view("GET"));
+  CHECK_EQUAL(to_string(*result), "1001000");
+  result = idx2.lookup(equal, make_data_view("HEAD"));
+  CHECK_EQUAL(to_string(*result), "0000001");
+  result = idx2.lookup(ni, make_data_view("T"));
+  CHECK_EQUAL(to_string(*result), "1101010");
+}
+
+TEST(string with ngrams) {
+  string_index idx{100, true, 0};
+  MESSAGE("append");
+  REQUIRE(idx.append(make_data_view("evil.com")));
+  REQUIRE(idx.append(make_data_view("example.org")));
+  REQUIRE(idx.append(make_data_view("www.evil.com")));
+  REQUIRE(idx.append(make_data_view("ev")));
+  REQUIRE(idx.append(make_data_view("lil.co")));
+  REQUIRE(idx.append(make_data_view("foo")));
+  MESSAGE("substring lookup");
+  auto result = idx.lookup(ni, make_data_view("evil.com"));
+  CHECK_EQUAL(to_string(*result), "101000");
+  result = idx.lookup(ni, make_data_view("com"));
+  CHECK_EQUAL(to_string(*result), "101000");
+  result = idx.lookup(ni, make_data_view("ev"));
+  CHECK_EQUAL(to_string(*result), "101100");
+  result = idx.lookup(ni, make_data_view("bar"));
+  CHECK_EQUAL(to_string(*result), "000000");
+  result = idx.lookup(not_ni, make_data_view("evil"));
+  CHECK_EQUAL(to_string(*result), "010111");
+  MESSAGE("pattern lookup");
+  result = idx.lookup(match, make_data_view(pattern{".*evil\\.com"}));
+  CHECK_EQUAL(to_string(*result), "101000");
+  result = idx.lookup(match, make_data_view(pattern{"e[a-z]+\\.(com|org)"}));
+  CHECK_EQUAL(to_string(*result), "111111");
+  result = idx.lookup(match, make_data_view(pattern{"f?oo"}));
+  CHECK_EQUAL(to_string(*result), "111111");
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  CHECK_EQUAL(save(sys, buf, idx), caf::none);
+  string_index idx2{};
+  CHECK_EQUAL(load(sys, buf, idx2), caf::none);
+  result = idx2.lookup(ni, make_data_view("evil.com"));
+  CHECK_EQUAL(to_string(*result), "101000");
+}
+
+TEST(string pattern with classes and multibyte characters) {
+  string_index idx{100, true, 0};
+  MESSAGE("append");
+  REQUIRE(idx.append(make_data_view("axyz")));
+  REQUIRE(idx.append(make_data_view("]xyz")));
+  REQUIRE(idx.append(make_data_view("abc")));
+  REQUIRE(idx.append(make_data_view("a€bcd")));
+  REQUIRE(idx.append(make_data_view("abcd")));
+  MESSAGE("character classes");
+  auto result = idx.lookup(match, make_data_view(pattern{"[\\]]xyz"}));
+  CHECK_EQUAL(to_string(*result), "11000");
+  result = idx.lookup(match, make_data_view(pattern{"[a\\]b]xyz"}));
+  CHECK_EQUAL(to_string(*result), "11000");
+  result = idx.lookup(match, make_data_view(pattern{"[^]]xyz"}));
+  CHECK_EQUAL(to_string(*result), "11111");
+  result = idx.lookup(match, make_data_view(pattern{"[]]xyz"}));
+  CHECK_EQUAL(to_string(*result), "11111");
+  result = idx.lookup(match, make_data_view(pattern{"[[:alpha:]]xyz"}));
+  CHECK_EQUAL(to_string(*result), "11111");
+  MESSAGE("optional multibyte characters");
+  result = idx.lookup(match, make_data_view(pattern{"a€*bcd"}));
+  CHECK_EQUAL(to_string(*result), "00011");
+  result = idx.lookup(match, make_data_view(pattern{"a€?bcd"}));
+  CHECK_EQUAL(to_string(*result), "00011");
+  result = idx.lookup(match, make_data_view(pattern{"a€{0,1}bcd"}));
+  CHECK_EQUAL(to_string(*result), "00011");
+}
+
+TEST(string hash) {
+  auto t = string_type{}.attributes({{"index", "hash"}});
+  auto idx = value_index::make(t);
+  REQUIRE(idx != nullptr);
+  MESSAGE("append");
+  REQUIRE(idx->append(make_data_view("CHhAvVGS1DHFjwGM9")));
+  REQUIRE(idx->append(make_data_view("ClEkJM2Vm5giqnMf4h")));
+  REQUIRE(idx->append(make_data_view(caf::none)));
+  REQUIRE(idx->append(make_data_view("CHhAvVGS1DHFjwGM9")));
+  MESSAGE("lookup");
+  auto result = idx->lookup(equal, make_data_view("CHhAvVGS1DHFjwGM9"));
+  CHECK_EQUAL(to_string(*result), "1001");
+  result = idx->lookup(not_equal, make_data_view("CHhAvVGS1DHFjwGM9"));
+  CHECK_EQUAL(to_string(*result), "1101");
+  result = idx->lookup(equal, make_data_view("foo"));
+  CHECK_EQUAL(to_string(*result), "0000");
+  auto xs = vector{"ClEkJM2Vm5giqnMf4h", "foo"};
+  result = idx->lookup(in, make_data_view(xs));
+  CHECK_EQUAL(to_string(*result), "0100");
+  result = idx->lookup(ni, make_data_view("GM9"));
+  CHECK_EQUAL(to_string(*result), "1101");
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  detail::value_index_inspect_helper writer{t, idx};
+  CHECK_EQUAL(save(sys, buf, writer), caf::none);
+  std::unique_ptr<value_index> idx2;
+  detail::value_index_inspect_helper reader{t, idx2};
+  CHECK_EQUAL(load(sys, buf, reader), caf::none);
+  result = idx2->lookup(equal, make_data_view("CHhAvVGS1DHFjwGM9"));
+  CHECK_EQUAL(to_string(*result), "1001");
 }
 
 TEST(address) {
@@ -334,6 +472,79 @@ TEST(address) {
   CHECK_EQUAL(idx2.lookup(equal, make_data_view(x)), str);
 }
 
+TEST(address with prefix trie) {
+  address_index plain;
+  address_index stride8{8};
+  address_index stride5{5};
+  auto addresses = {"10.0.0.1", "10.1.2.3", "192.168.0.1", "192.168.0.130",
+                    "192.168.17.4", "172.16.3.3", "2001:db8::1",
+                    "2001:db8:ff::42", "fe80::1", "::ffff:10.0.0.7"};
+  MESSAGE("append");
+  for (auto str : addresses) {
+    auto x = unbox(to<address>(str));
+    REQUIRE(plain.append(make_data_view(x)));
+    REQUIRE(stride8.append(make_data_view(x)));
+    REQUIRE(stride5.append(make_data_view(x)));
+  }
+  MESSAGE("compare subnet lookups against byte-wise evaluation");
+  auto subnets = {"10.0.0.0/8", "10.0.0.0/16", "10.1.0.0/15", "192.168.0.0/24",
+                  "192.168.0.128/25", "192.168.16.0/20", "172.16.0.0/12",
+                  "2001:db8::/32", "2001:db8::/48", "fe80::/10", "::/1",
+                  "11.0.0.0/8"};
+  for (auto str : subnets) {
+    auto x = unbox(to<subnet>(str));
+    for (auto op : {in, not_in}) {
+      auto expected = to_string(unbox(plain.lookup(op, make_data_view(x))));
+      CHECK_EQUAL(to_string(unbox(stride8.lookup(op, make_data_view(x)))),
+                  expected);
+      CHECK_EQUAL(to_string(unbox(stride5.lookup(op, make_data_view(x)))),
+                  expected);
+    }
+  }
+  auto x = unbox(to<subnet>("192.168.0.0/16"));
+  CHECK_EQUAL(to_string(unbox(stride8.lookup(in, make_data_view(x)))),
+              "0011100000");
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  CHECK_EQUAL(save(sys, buf, stride5), caf::none);
+  address_index idx2;
+  CHECK_EQUAL(load(sys, buf, idx2), caf::none);
+  CHECK_EQUAL(to_string(unbox(idx2.lookup(in, make_data_view(x)))),
+              "0011100000");
+}
+
+TEST(address without format tag) {
+  address_index idx;
+  auto addresses = {"10.0.0.1", "192.168.0.1", "10.0.0.1", "2001:db8::1"};
+  for (auto str : addresses) {
+    auto x = unbox(to<address>(str));
+    REQUIRE(idx.append(make_data_view(x)));
+  }
+  std::vector<char> buf;
+  REQUIRE_EQUAL(save(sys, buf, idx), caf::none);
+  MESSAGE("strip the format tag and the prefix trie");
+  // The tag consists of an empty sequence (1 byte), the magic constant (8
+  // bytes), and the version (4 bytes). Without trie, the stride (8 bytes) and
+  // the empty vector of prefix levels (1 byte) follow the untagged state.
+  REQUIRE_GREATER(buf.size(), 13u + 9u);
+  std::vector<char> untagged(buf.begin() + 13, buf.end() - 9);
+  address_index idx2{8};
+  REQUIRE_EQUAL(load(sys, untagged, idx2), caf::none);
+  auto x = unbox(to<address>("10.0.0.1"));
+  CHECK_EQUAL(to_string(unbox(idx2.lookup(equal, make_data_view(x)))),
+              "1010");
+  auto y = unbox(to<subnet>("192.168.0.0/16"));
+  CHECK_EQUAL(to_string(unbox(idx2.lookup(in, make_data_view(y)))), "0100");
+  MESSAGE("load an empty index in the untagged format");
+  address_index empty;
+  buf.clear();
+  REQUIRE_EQUAL(save(sys, buf, empty), caf::none);
+  untagged.assign(buf.begin() + 13, buf.end() - 9);
+  address_index idx3;
+  REQUIRE_EQUAL(load(sys, untagged, idx3), caf::none);
+  CHECK_EQUAL(idx3.offset(), 0u);
+}
+
 TEST(subnet) {
   subnet_index idx;
   auto s0 = *to<subnet>("192.168.0.0/24");
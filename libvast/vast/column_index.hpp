@@ -14,6 +14,8 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <caf/expected.hpp>
 #include <caf/fwd.hpp>
@@ -22,6 +24,7 @@
 #include "vast/event.hpp"
 #include "vast/expression.hpp"
 #include "vast/filesystem.hpp"
+#include "vast/table_slice.hpp"
 #include "vast/type.hpp"
 #include "vast/value_index.hpp"
 
@@ -53,9 +56,15 @@ public:
   /// @returns An error if I/O operations fail.
   caf::error init();
 
-  /// Persists the index to disk.
+  /// Persists all values added since the last flush by appending them to the
+  /// delta log at `journal_filename()`. Unlike `seal`, this operation never
+  /// rewrites the bitmaps that are already on disk.
   caf::error flush_to_disk();
 
+  /// Writes the complete index to `filename()` and discards the delta log.
+  /// Called once the owning partition becomes immutable.
+  caf::error seal();
+
   // -- properties -------------------------------------------------------------
 
   /// Adds an event to the index.
@@ -71,11 +80,15 @@ public:
     return filename_;
   }
 
+  /// @returns the file name of the delta log that receives incremental
+  ///          flushes until the index gets sealed.
+  path journal_filename() const;
+
   /// Serializes or deserializes a column index.
   template <class Inspector>
   friend typename Inspector::result_type inspect(Inspector& f, column_index& x) {
     detail::value_index_inspect_helper tmp{x.index_type_, x.idx_};
-    return f(x.index_type_, x.filename_, tmp, f.last_flush_);
+    return f(x.index_type_, x.filename_, tmp, x.last_flush_);
   }
 
   /// @returns the type of this column.
@@ -97,7 +110,18 @@ public:
 protected:
   // -- constructors, destructors, and assignment operators --------------------
 
-  column_index(caf::actor_system& sys, type index_type, path filename);
+  column_index(caf::actor_system& sys, type index_type, path filename,
+               size_t column);
+
+  // -- delta log --------------------------------------------------------------
+
+  /// Queues a slice for the delta log. Flushes the queue once it holds
+  /// `defaults::system::max_pending_column_values` rows.
+  /// @param x The slice that contains the values of this column.
+  void journal(const table_slice_ptr& x);
+
+  /// Appends the values of this column in `x` to the value index.
+  void append(const table_slice& x);
 
   // -- member variables -------------------------------------------------------
 
@@ -106,6 +130,16 @@ protected:
   path filename_;
   std::unique_ptr<value_index> idx_;
   value_index::size_type last_flush_ = 0;
+
+  /// The column of this index in the slices.
+  size_t col_;
+
+  /// Slices added since the last flush, i.e., the content of the next deltas.
+  std::vector<table_slice_ptr> pending_;
+
+  /// The number of rows in `pending_`.
+  size_t pending_values_ = 0;
+
   caf::actor_system& sys_;
 };
 
@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "vast/aliases.hpp"
@@ -22,6 +24,31 @@
 
 namespace vast {
 
+/// Keeps the rows of destroyed slices around, so that a builder can fill them
+/// again. Refilling a recycled row reuses the memory of the row itself and the
+/// capacity of its strings. Slices may die on any thread, which is why the
+/// pool synchronizes access.
+class default_table_slice_pool {
+public:
+  /// Constructs an empty pool.
+  /// @param capacity The maximum number of row sets to keep.
+  explicit default_table_slice_pool(size_t capacity);
+
+  /// Takes the rows of a destroyed slice out of the pool.
+  /// @returns The recycled rows or an empty vector if the pool is empty.
+  vector acquire();
+
+  /// Hands the rows of a destroyed slice to the pool, which drops them when
+  /// it is full.
+  /// @param rows The rows to recycle.
+  void release(vector&& rows);
+
+private:
+  std::mutex mtx_;
+  std::vector<vector> rows_;
+  size_t capacity_;
+};
+
 /// The default implementation of `table_slice`.
 class default_table_slice : public table_slice {
 public:
@@ -35,6 +62,8 @@ public:
 
   explicit default_table_slice(record_type layout);
 
+  ~default_table_slice() override;
+
   // -- factory functions ------------------------------------------------------
 
   default_table_slice* copy() const final;
@@ -70,6 +99,9 @@ private:
   // -- member variables -------------------------------------------------------
 
   vector xs_;
+
+  /// Receives `xs_` on destruction, if set.
+  std::shared_ptr<default_table_slice_pool> pool_;
 };
 
 /// @relates default_table_slice
@@ -30,12 +30,19 @@ public:
 
   default_table_slice_builder(record_type layout);
 
+  // -- constants --------------------------------------------------------------
+
+  /// The maximum number of destroyed slices to keep for refilling.
+  static constexpr size_t recycled_slices = 4;
+
   // -- properties -------------------------------------------------------------
 
   bool append(data x);
 
   bool add(data_view x) final;
 
+  bool add_unchecked(data_view x) final;
+
   table_slice_ptr finish() final;
 
   size_t rows() const noexcept final;
@@ -48,11 +55,29 @@ private:
   /// Allocates `slice_` and resets related state if necessary.
   void lazy_init();
 
+  /// @returns The cell at the current position, which may hold a stale value
+  ///          from a recycled slice.
+  data& cell();
+
+  /// Advances to the next cell.
+  void next_cell();
+
+  /// Writes `x` into the current cell and advances to the next one.
+  void put(data_view x);
+
   // -- member variables -------------------------------------------------------
 
-  vector row_;
+  /// Points to the row under construction.
+  vector* row_;
+
+  /// The number of complete rows.
+  size_t rows_;
+
   size_t col_;
   std::unique_ptr<default_table_slice> slice_;
+
+  /// Recycles the rows of our slices after their destruction.
+  std::shared_ptr<default_table_slice_pool> pool_;
 };
 
 } // namespace vast
@@ -64,6 +64,9 @@ extern size_t max_flows;
 /// Number of events generated by the test source.
 extern size_t generated_events;
 
+/// Number of threads parsing input in the Bro and MRT readers.
+extern size_t parser_threads;
+
 /// The unique ID of this node.
 extern const char* node_id;
 
@@ -77,6 +80,18 @@ extern size_t table_slice_size;
 /// Maximum number of events per index partition.
 extern size_t max_partition_size;
 
+/// Maximum number of bytes a datagram source buffers while its stream has no
+/// capacity. The source drops datagrams beyond this limit.
+extern size_t max_datagram_buffer_size;
+
+/// Maximum number of results an exporter buffers while its sinks have no
+/// credit. Beyond this limit, the exporter stops pulling hits.
+extern size_t max_exporter_results;
+
+/// Maximum number of values a column index holds in memory before appending
+/// them to its delta log.
+extern size_t max_pending_column_values;
+
 } // namespace system
 
 } // namespace vast::defaults
@@ -0,0 +1,49 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+
+#pragma once
+
+#include <streambuf>
+#include <string_view>
+
+#include "vast/chunk.hpp"
+
+namespace vast::detail {
+
+/// A read-only stream buffer whose get area spans a chunk, e.g., a
+/// memory-mapped file.
+class chunkbuf : public std::streambuf {
+public:
+  /// Constructs a stream buffer from a chunk.
+  /// @param chk The chunk to read from.
+  /// @pre `chk != nullptr`
+  explicit chunkbuf(chunk_ptr chk);
+
+  /// Consumes the unread part of the chunk without copying it.
+  /// @returns The unread bytes, which remain valid for the lifetime of the
+  ///          stream buffer.
+  std::string_view take();
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which = std::ios_base::in) override;
+
+  pos_type seekpos(pos_type pos,
+                   std::ios_base::openmode which = std::ios_base::in) override;
+
+private:
+  chunk_ptr chunk_;
+};
+
+} // namespace vast::detail
@@ -15,32 +15,46 @@
 
 #include <cstdint>
 #include <istream>
-#include <string>
+#include <string_view>
+#include <vector>
 
 #include "vast/detail/range.hpp"
 
 namespace vast::detail {
 
-// A range of non-empty lines, extracted via `std::getline`.
+// A range of non-empty lines. If the stream buffer of the input is a
+// `chunkbuf`, e.g., for a memory-mapped file, the lines point directly into
+// the chunk. Otherwise, the range reads the input in blocks and hands out
+// lines from its block buffer. Either way, extracting a line neither copies
+// nor allocates.
 class line_range : range_facade<line_range> {
 public:
+  /// The maximum number of bytes to read from the input at once.
+  static constexpr size_t block_size = 1 << 20;
+
   line_range(std::istream& input);
 
-  const std::string& get() const;
+  /// @returns The current line, valid until the next call to `next`.
+  std::string_view get() const;
 
   void next();
 
   bool done() const;
 
-  std::string& line();
-
   size_t line_number() const;
 
 private:
+  // Moves unconsumed bytes to the front of the buffer and appends the next
+  // block of input.
+  void refill();
+
   std::istream& input_;
-  std::string line_;
+  std::vector<char> buffer_;
+  const char* first_ = nullptr;
+  const char* last_ = nullptr;
+  bool eof_ = false;
+  std::string_view line_;
   size_t line_number_ = 0;
 };
 
 } // namespace vast::detail
-
@@ -0,0 +1,251 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "vast/detail/assert.hpp"
+
+namespace vast::detail {
+
+/// A hash map with a fixed capacity that evicts the least recently used entry
+/// when inserting into a full map. The map stores its entries in a flat array
+/// and indexes them with an open-addressing table, which uses linear probing
+/// with backward-shift deletion. Hence, the map never rehashes and never
+/// leaves tombstones behind. An intrusive list over the entries keeps them in
+/// order of last access, so that evicting stale entries only touches the
+/// entries that actually go away.
+template <class Key, class T, class Hash = std::hash<Key>,
+          class KeyEqual = std::equal_to<Key>>
+class lru_hash_map {
+public:
+  // -- member types -----------------------------------------------------------
+
+  using key_type = Key;
+
+  using mapped_type = T;
+
+  // -- constructors, destructors, and assignment operators -------------------
+
+  /// Constructs an empty map.
+  /// @param capacity The maximum number of entries.
+  /// @pre `capacity > 0`
+  explicit lru_hash_map(size_t capacity, Hash hash = Hash{},
+                        KeyEqual equal = KeyEqual{})
+    : capacity_{capacity},
+      hash_{std::move(hash)},
+      equal_{std::move(equal)} {
+    VAST_ASSERT(capacity > 0);
+    // Keeping the load factor at or below 0.5 bounds the probe sequences.
+    size_t buckets = 1;
+    while (buckets < 2 * capacity)
+      buckets <<= 1;
+    buckets_.resize(buckets, npos);
+    mask_ = buckets_.size() - 1;
+    slots_.reserve(capacity);
+  }
+
+  // -- properties -------------------------------------------------------------
+
+  /// @returns The number of entries.
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// @returns `true` if the map has no entries.
+  bool empty() const noexcept {
+    return size_ == 0;
+  }
+
+  /// @returns The maximum number of entries.
+  size_t capacity() const noexcept {
+    return capacity_;
+  }
+
+  // -- lookup and modification ------------------------------------------------
+
+  /// Looks up an entry without changing its position in the access order.
+  /// @param key The key to look for.
+  /// @returns A pointer to the value of *key* or `nullptr`.
+  T* find(const Key& key) {
+    auto [bucket, found] = probe(key, hash_(key));
+    return found ? &slots_[buckets_[bucket]].value : nullptr;
+  }
+
+  /// Retrieves the entry for *key* and marks it as most recently used. If no
+  /// such entry exists, adds one, evicting the least recently used entry
+  /// when the map is full.
+  /// @param key The key to look for.
+  /// @param init The value of the new entry if *key* does not exist.
+  /// @returns A pointer to the value of *key* and whether the map added it.
+  std::pair<T*, bool> get_or_add(const Key& key, T init) {
+    auto h = hash_(key);
+    auto [bucket, found] = probe(key, h);
+    if (found) {
+      auto i = buckets_[bucket];
+      if (i != head_) {
+        unlink(i);
+        link_front(i);
+      }
+      return {&slots_[i].value, false};
+    }
+    if (size_ == capacity_) {
+      evict(tail_);
+      // Eviction may have shifted entries into our probe sequence.
+      bucket = probe(key, h).first;
+    }
+    uint32_t i;
+    if (!free_.empty()) {
+      i = free_.back();
+      free_.pop_back();
+      slots_[i].key = key;
+      slots_[i].value = std::move(init);
+    } else {
+      i = static_cast<uint32_t>(slots_.size());
+      slots_.push_back(slot{key, std::move(init), 0, npos, npos});
+    }
+    slots_[i].hash = h;
+    buckets_[bucket] = i;
+    link_front(i);
+    ++size_;
+    return {&slots_[i].value, true};
+  }
+
+  /// Removes the entry for *key*.
+  /// @param key The key of the entry to remove.
+  /// @returns `true` if the map contained *key*.
+  bool erase(const Key& key) {
+    auto [bucket, found] = probe(key, hash_(key));
+    if (!found)
+      return false;
+    evict(buckets_[bucket]);
+    return true;
+  }
+
+  /// Evicts entries in order of least recent use until *pred* returns
+  /// `false` or the map becomes empty.
+  /// @param pred A predicate taking the key and value of an entry.
+  /// @returns The number of evicted entries.
+  template <class Predicate>
+  size_t evict_while(Predicate pred) {
+    size_t result = 0;
+    while (tail_ != npos && pred(slots_[tail_].key, slots_[tail_].value)) {
+      evict(tail_);
+      ++result;
+    }
+    return result;
+  }
+
+private:
+  static constexpr uint32_t npos = static_cast<uint32_t>(-1);
+
+  struct slot {
+    Key key;
+    T value;
+    size_t hash;
+    uint32_t prev; // towards the most recently used entry
+    uint32_t next; // towards the least recently used entry
+  };
+
+  // Returns the bucket that holds *key* or the empty bucket where it belongs.
+  std::pair<size_t, bool> probe(const Key& key, size_t h) const {
+    for (auto bucket = h & mask_;; bucket = (bucket + 1) & mask_) {
+      auto i = buckets_[bucket];
+      if (i == npos)
+        return {bucket, false};
+      if (slots_[i].hash == h && equal_(slots_[i].key, key))
+        return {bucket, true};
+    }
+  }
+
+  void evict(uint32_t i) {
+    VAST_ASSERT(i != npos);
+    auto bucket = probe(slots_[i].key, slots_[i].hash);
+    VAST_ASSERT(bucket.second);
+    remove(bucket.first);
+    unlink(i);
+    free_.push_back(i);
+    --size_;
+  }
+
+  // Empties a bucket and shifts subsequent entries of the same cluster back
+  // so that every entry stays reachable from its home bucket.
+  void remove(size_t hole) {
+    for (auto bucket = (hole + 1) & mask_;; bucket = (bucket + 1) & mask_) {
+      auto i = buckets_[bucket];
+      if (i == npos)
+        break;
+      auto home = slots_[i].hash & mask_;
+      // The entry stays if its home lies cyclically in (hole, bucket].
+      auto stays = hole <= bucket ? hole < home && home <= bucket
+                                  : hole < home || home <= bucket;
+      if (!stays) {
+        buckets_[hole] = i;
+        hole = bucket;
+      }
+    }
+    buckets_[hole] = npos;
+  }
+
+  void link_front(uint32_t i) {
+    slots_[i].prev = npos;
+    slots_[i].next = head_;
+    if (head_ != npos)
+      slots_[head_].prev = i;
+    head_ = i;
+    if (tail_ == npos)
+      tail_ = i;
+  }
+
+  void unlink(uint32_t i) {
+    auto& x = slots_[i];
+    if (x.prev != npos)
+      slots_[x.prev].next = x.next;
+    else
+      head_ = x.next;
+    if (x.next != npos)
+      slots_[x.next].prev = x.prev;
+    else
+      tail_ = x.prev;
+  }
+
+  // -- member variables -------------------------------------------------------
+
+  /// The entries, which never reallocate after reaching the capacity.
+  std::vector<slot> slots_;
+
+  /// Maps hashes to slot indexes.
+  std::vector<uint32_t> buckets_;
+
+  /// Indexes of evicted slots for reuse.
+  std::vector<uint32_t> free_;
+
+  /// The most recently used entry.
+  uint32_t head_ = npos;
+
+  /// The least recently used entry.
+  uint32_t tail_ = npos;
+
+  size_t size_ = 0;
+  size_t capacity_;
+  size_t mask_;
+  Hash hash_;
+  KeyEqual equal_;
+};
+
+} // namespace vast::detail
@@ -134,5 +134,17 @@ bool write(int fd, const void* buffer, size_t bytes, size_t* put = nullptr);
 /// @returns `true` on successful seek.
 bool seek(int fd, size_t bytes);
 
+/// Flushes the data of a file to the storage device, via `fdatasync(2)` where
+/// available and `fsync(2)` otherwise.
+/// @param fd The file descriptor to synchronize.
+/// @returns `true` on success.
+bool sync(int fd);
+
+/// Wraps `ftruncate(2)`.
+/// @param fd A file descriptor open for writing.
+/// @param size The new size of the file in bytes.
+/// @returns `true` on success.
+bool truncate(int fd, size_t size);
+
 } // namespace vast::detail
 
@@ -40,14 +40,14 @@ public:
   /// Pushes a new element to the end of the queue.
   /// @param x The value to push in the queue.
   /// @note The notification occurs *after* the mutex is unlocked, thus the
-  /// waiting thread will be able to acquire the mutex without blocking.
+  /// waiting thread will be able to acquire the mutex without blocking. Every
+  /// push wakes up a waiting thread, so that multiple consumers share a burst
+  /// of elements.
   void push(value_type x) {
     std::unique_lock<std::mutex> lock(mutex_);
-    const bool empty = super::empty();
     super::push(std::move(x));
     lock.unlock();
-    if (empty)
-      cond_.notify_one();
+    cond_.notify_one();
   }
 
   /// Pushes a new element to the end of the queue. The element is
@@ -57,11 +57,9 @@ public:
   template <class... Args>
   void emplace(Args&&... args) {
     std::unique_lock<std::mutex> lock(mutex_);
-    bool const empty = super::empty();
     super::emplace(std::forward<Args>(args)...);
     lock.unlock();
-    if (empty)
-      cond_.notify_one();
+    cond_.notify_one();
   }
 
   /// Gets the top-most element or wait until an element is added. To avoid
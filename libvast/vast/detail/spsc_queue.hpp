@@ -0,0 +1,95 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "vast/detail/assert.hpp"
+
+namespace vast::detail {
+
+/// A bounded lock-free queue for exactly one producer and one consumer
+/// thread. The producer only writes the tail index and the consumer only the
+/// head index, so that both sides synchronize through acquire/release
+/// semantics without any lock.
+template <class T>
+class spsc_queue {
+  spsc_queue(spsc_queue&) = delete;
+  spsc_queue& operator=(spsc_queue&) = delete;
+
+public:
+  using value_type = T;
+
+  /// Constructs an empty queue.
+  /// @param capacity The maximum number of elements in the queue.
+  /// @pre `capacity > 0`
+  explicit spsc_queue(size_t capacity) : buffer_(capacity + 1) {
+    VAST_ASSERT(capacity > 0);
+  }
+
+  /// Appends an element to the queue. Must only be called by the producer.
+  /// @param x The element to append, which stays untouched on failure.
+  /// @returns `false` if the queue is full.
+  template <class U>
+  bool try_push(U&& x) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto next = increment(tail);
+    if (next == head_.load(std::memory_order_acquire))
+      return false;
+    buffer_[tail] = std::forward<U>(x);
+    tail_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  /// Removes the first element from the queue. Must only be called by the
+  /// consumer.
+  /// @param x The reference parameter receiving the element.
+  /// @returns `false` if the queue is empty.
+  bool try_pop(value_type& x) {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+    x = std::move(buffer_[head]);
+    head_.store(increment(head), std::memory_order_release);
+    return true;
+  }
+
+  /// @returns `true` if the queue has no elements at the time of the call.
+  bool empty() const {
+    return head_.load(std::memory_order_acquire)
+           == tail_.load(std::memory_order_acquire);
+  }
+
+  /// @returns The maximum number of elements in the queue.
+  size_t capacity() const {
+    return buffer_.size() - 1;
+  }
+
+private:
+  size_t increment(size_t i) const {
+    return i + 1 == buffer_.size() ? 0 : i + 1;
+  }
+
+  std::vector<value_type> buffer_;
+
+  // Producer and consumer indexes live on separate cache lines to avoid false
+  // sharing between the two threads.
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace vast::detail
@@ -234,6 +234,15 @@ public:
   /// @returns `true` on success.
   bool seek(size_t bytes);
 
+  /// Flushes written data to the storage device.
+  /// @returns `true` on success.
+  bool sync();
+
+  /// Truncates or extends the file to a given size.
+  /// @param size The new size of the file in bytes.
+  /// @returns `true` on success.
+  bool truncate(size_t size);
+
   /// Retrieves the ::path for this file.
   /// @returns The ::path for this file.
   const vast::path& path() const;
@@ -323,6 +332,15 @@ expected<void> mkdir(const path& p);
 // @returns The contents of the file *p*.
 expected<std::string> load_contents(const path& p);
 
+/// Expands a path pattern into the regular files it refers to. A directory
+/// expands to the regular files it contains, and a pattern with the
+/// wildcards `*`, `?`, or `[...]` in its last component expands to the
+/// matching regular files in the parent directory. Any other pattern expands
+/// to itself, regardless of whether it exists.
+/// @param pattern The path pattern to expand.
+/// @returns The sorted list of paths matching *pattern*.
+std::vector<path> glob(const path& pattern);
+
 } // namespace vast
 
 namespace std {
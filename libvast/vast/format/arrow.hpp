@@ -0,0 +1,150 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+
+#include "vast/format/reader.hpp"
+#include "vast/format/writer.hpp"
+#include "vast/schema.hpp"
+#include "vast/table_slice_builder.hpp"
+#include "vast/type.hpp"
+
+namespace arrow {
+
+class RecordBatch;
+class RecordBatchReader;
+class Schema;
+
+namespace io {
+
+class InputStream;
+class OutputStream;
+
+} // namespace io
+
+namespace ipc {
+
+class RecordBatchWriter;
+
+} // namespace ipc
+
+} // namespace arrow
+
+namespace vast::format::arrow {
+
+/// An Arrow writer. The writer turns each batch of events into an Arrow
+/// record batch and emits it in the Arrow IPC stream format. Since an IPC
+/// stream has a single schema, the writer begins a new stream whenever the
+/// layout changes, i.e., the output is a sequence of concatenated streams.
+///
+/// VAST types without a native Arrow equivalent carry their VAST type in the
+/// field metadata under the `ARROW:extension:name` key, e.g., an address
+/// becomes a 16-byte fixed-size binary with extension name `vast.address`.
+class writer : public format::writer {
+public:
+  writer() = default;
+
+  /// Constructs an Arrow writer.
+  /// @param out The stream where to write to.
+  explicit writer(std::unique_ptr<std::ostream> out);
+
+  writer(writer&&);
+
+  writer& operator=(writer&&);
+
+  ~writer();
+
+  caf::expected<void> write(const event& e) override;
+
+  caf::expected<void> write(const table_slice& slice,
+                            const ids& selection) override;
+
+  caf::expected<void> flush() override;
+
+  void cleanup() override;
+
+  const char* name() const override;
+
+private:
+  /// Writes the given rows of a slice as one record batch.
+  caf::expected<void>
+  write_rows(const table_slice& slice,
+             const std::vector<table_slice::size_type>& rows);
+
+  /// Writes the events accumulated by `write(const event&)`.
+  caf::expected<void> write_events();
+
+  /// Terminates the current IPC stream.
+  caf::expected<void> close_stream();
+
+  std::unique_ptr<std::ostream> out_; // must outlive sink_
+  std::shared_ptr<::arrow::io::OutputStream> sink_;
+  std::shared_ptr<::arrow::ipc::RecordBatchWriter> stream_;
+  std::shared_ptr<::arrow::Schema> schema_;
+  record_type layout_;
+  type event_type_;
+  table_slice_builder_ptr builder_;
+};
+
+/// An Arrow reader for sequences of IPC streams, as produced by the Arrow
+/// writer. The reader maps each stream schema back onto a VAST layout, using
+/// the extension metadata to restore VAST types.
+class reader : public format::reader {
+public:
+  reader() = default;
+
+  /// Constructs an Arrow reader.
+  /// @param in The stream of Arrow IPC data.
+  explicit reader(std::unique_ptr<std::istream> in);
+
+  reader(reader&&);
+
+  reader& operator=(reader&&);
+
+  ~reader();
+
+  caf::expected<event> read() override;
+
+  std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size,
+              consumer& f) override;
+
+  caf::expected<void> schema(vast::schema sch) override;
+
+  caf::expected<vast::schema> schema() const override;
+
+  const char* name() const override;
+
+private:
+  /// Makes the next record batch with at least one row available.
+  caf::error next_batch();
+
+  /// Converts a row of the current record batch.
+  /// @returns The timestamp and the values of the row.
+  std::pair<timestamp, vector> convert_row();
+
+  std::unique_ptr<std::istream> in_; // must outlive source_
+  std::shared_ptr<::arrow::io::InputStream> source_;
+  std::shared_ptr<::arrow::RecordBatchReader> stream_;
+  std::shared_ptr<::arrow::RecordBatch> batch_;
+  int64_t row_ = 0;
+  bool has_timestamp_ = false;
+  type layout_;
+  vast::schema schema_;
+};
+
+} // namespace vast::format::arrow
@@ -13,9 +13,14 @@
 
 #pragma once
 
+#include <vector>
+
 #include "vast/concept/printable/core.hpp"
+#include "vast/concept/printable/vast/data.hpp"
 #include "vast/concept/printable/vast/event.hpp"
 #include "vast/format/printer_writer.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
 
 namespace vast::format::ascii {
 
@@ -26,6 +31,33 @@ struct ascii_printer : printer<ascii_printer> {
   bool print(Iterator&& out, const event& e) const {
     return event_printer{}.print(out, e);
   }
+
+  /// Prints rows of a table slice in the same way as the corresponding events.
+  template <class Iterator>
+  bool print(Iterator& out, const table_slice& slice,
+             const std::vector<table_slice::size_type>& rows) const {
+    using namespace printers;
+    auto& name = slice.layout().name();
+    auto header = str << str << make_printer<timestamp>{} << str;
+    auto cell = data_printer{};
+    for (auto row : rows) {
+      if (name.empty() && !str(out, "<anonymous>"))
+        return false;
+      auto ts = caf::get<timestamp>(slice.at(row, 0));
+      if (!header(out, name, " [", ts, "] ") || !chr<'['>(out))
+        return false;
+      // The first column holds the timestamp.
+      for (size_t col = 1; col < slice.columns(); ++col) {
+        if (col > 1 && !str(out, ", "))
+          return false;
+        if (!cell(out, materialize(slice.at(row, col))))
+          return false;
+      }
+      if (!str(out, "]\n"))
+        return false;
+    }
+    return true;
+  }
 };
 
 class writer : public printer_writer<ascii_printer>{
@@ -14,8 +14,11 @@
 #pragma once
 
 #include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +28,7 @@
 #include "vast/concept/parseable/vast/address.hpp"
 #include "vast/concept/parseable/vast/subnet.hpp"
 #include "vast/data.hpp"
+#include "vast/detail/queue.hpp"
 #include "vast/expected.hpp"
 #include "vast/filesystem.hpp"
 #include "vast/format/reader.hpp"
@@ -93,7 +97,7 @@ struct bro_parser {
 
   bool operator()(const pattern_type&) const {
     static auto p = +parsers::any
-      ->* [](std::string x) { return detail::byte_unescape(x); };
+      ->* [](std::string x) { return pattern{detail::byte_unescape(x)}; };
     return parse(p);
   }
 
@@ -169,10 +173,10 @@ struct bro_parser_factory {
   result_type operator()(const pattern_type&) const {
     if (set_separator_.empty())
       return +parsers::any
-        ->* [](std::string x) { return detail::byte_unescape(x); };
+        ->* [](std::string x) { return pattern{detail::byte_unescape(x)}; };
     else
       return +(parsers::any - set_separator_)
-        ->* [](std::string x) { return detail::byte_unescape(x); };
+        ->* [](std::string x) { return pattern{detail::byte_unescape(x)}; };
   }
 
   result_type operator()(const address_type&) const {
@@ -221,19 +225,77 @@ bool bro_basic_parse(const type& t, Iterator& f, const Iterator& l,
   return caf::visit(bro_parser<Iterator, Attribute>{f, l, attr}, t);
 }
 
+/// Decodes Bro fields of a fixed type. Unlike the rules from
+/// `make_bro_parser`, the decoder dispatches on the field type with a switch
+/// and calls the concrete parsers directly, i.e., it avoids type-erased rule
+/// invocations and semantic actions for all types that Bro logs.
+class field_decoder {
+public:
+  field_decoder() = default;
+
+  /// Constructs a decoder for fields of a given type.
+  /// @param t The field type.
+  /// @param set_separator The separator for container elements.
+  field_decoder(const type& t, std::string set_separator);
+
+  /// Decodes a field.
+  /// @param str The field content.
+  /// @param x The result, which retains its allocations when holding a string
+  ///          already.
+  /// @returns `true` on success.
+  bool operator()(std::string_view str, data& x) const;
+
+  enum class kind : uint8_t {
+    boolean,
+    integer,
+    count,
+    real,
+    timestamp,
+    timespan,
+    string,
+    pattern,
+    address,
+    subnet,
+    port,
+    set,
+    vector,
+    other,
+  };
+
+private:
+  kind kind_ = kind::other;
+  kind element_kind_ = kind::other;
+  std::string set_separator_;
+  rule<std::string_view::const_iterator, data> fallback_;
+};
+
 /// A Bro reader.
-class reader : format::reader {
+class reader : public format::reader {
 public:
   reader() = default;
 
   /// Constructs a Bro reader.
   /// @param input The stream of logs to read.
-  explicit reader(std::unique_ptr<std::istream> in);
+  /// @param threads The number of threads that parse log lines in
+  ///                `read_slices`. With more than one thread, the reader
+  ///                collects chunks of lines and hands one slice per task to
+  ///                a fixed set of worker threads, capped at the hardware
+  ///                concurrency.
+  explicit reader(std::unique_ptr<std::istream> in, size_t threads = 1);
+
+  reader(reader&&) = default;
+
+  reader& operator=(reader&&) = default;
+
+  ~reader() override;
 
   void reset(std::unique_ptr<std::istream> in);
 
   caf::expected<event> read() override;
 
+  std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size, consumer& f) override;
+
   caf::expected<void> schema(vast::schema sch) override;
 
   caf::expected<vast::schema> schema() const override;
@@ -241,10 +303,30 @@ public:
   const char* name() const override;
 
 private:
-  using iterator_type = std::string_view::const_iterator;
-
   expected<void> parse_header();
 
+  /// Parses the next line into `values_`, processing headers and comments
+  /// along the way.
+  /// @returns `true` if `values_` holds a new record, `false` if the line
+  ///          contained no record, or an error.
+  expected<bool> parse_line();
+
+  /// Parses the fields of a single log line. Safe to call concurrently.
+  /// @param line The log line.
+  /// @param line_number The line number for diagnostics.
+  /// @param xs The buffer for the parsed fields.
+  /// @returns `true` if `xs` holds a new record, `false` if the line had the
+  ///          wrong number of fields, or a parse error.
+  expected<bool> parse_record(std::string_view line, size_t line_number,
+                              std::vector<data>& xs) const;
+
+  /// @returns The timestamp of the parsed record `xs`.
+  timestamp record_timestamp(const std::vector<data>& xs) const;
+
+  /// Implements `read_slices` on multiple threads.
+  std::pair<caf::error, size_t>
+  read_slices_parallel(size_t max_events, size_t max_slice_size, consumer& f);
+
   std::unique_ptr<std::istream> input_;
   std::unique_ptr<detail::line_range> lines_;
   std::string separator_ = " ";
@@ -255,7 +337,17 @@ private:
   vast::schema schema_;
   type type_;
   record_type record_;
-  std::vector<rule<iterator_type, data>> parsers_;
+  std::vector<field_decoder> parsers_;
+  std::vector<data> values_;
+  size_t threads_ = 1;
+  std::vector<std::string> chunk_;
+  std::vector<size_t> chunk_line_numbers_;
+
+  /// The tasks of `workers_`. An empty task stops a worker.
+  std::unique_ptr<detail::queue<std::function<void()>>> tasks_;
+
+  /// The threads of `read_slices_parallel`, started on first use.
+  std::vector<std::thread> workers_;
 };
 
 /// A Bro writer.
@@ -271,6 +363,9 @@ public:
 
   expected<void> write(const event& e) override;
 
+  expected<void> write(const table_slice& slice,
+                       const ids& selection) override;
+
   expected<void> flush() override;
 
   void cleanup() override;
@@ -278,8 +373,13 @@ public:
   const char* name() const override;
 
 private:
+  /// Retrieves the stream for events of type `t`, which gets created on first
+  /// access.
+  expected<std::ostream*> stream(const type& t);
+
   path dir_;
   std::unordered_map<std::string, std::unique_ptr<std::ostream>> streams_;
+  std::string buffer_;
 };
 
 } // namespace vast::format::bro
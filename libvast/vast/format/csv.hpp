@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <caf/none.hpp>
 
 #include "vast/config.hpp"
@@ -22,6 +24,8 @@
 #include "vast/concept/printable/string.hpp"
 #include "vast/concept/printable/vast/data.hpp"
 #include "vast/detail/string.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/view.hpp"
 
 #include "vast/format/printer_writer.hpp"
 
@@ -139,6 +143,44 @@ struct value_printer : printer<value_printer> {
     return p(out, e.type().name(), e.id(), e.timestamp());
   }
 
+  /// Prints rows of a table slice in the same way as the corresponding events.
+  template <class Iterator>
+  bool print(Iterator& out, const table_slice& slice,
+             const std::vector<table_slice::size_type>& rows) const {
+    using namespace printers;
+    auto layout = slice.layout(1).name(slice.layout().name());
+    auto& r = caf::get<record_type>(layout);
+    if (layout != event_type) {
+      event_type = layout;
+      auto hdr = "type,id,timestamp"s;
+      for (auto& i : record_type::each{r})
+        hdr += ',' + i.key();
+      if (!(str << chr<'\n'>)(out, hdr))
+        return false;
+    }
+    auto name = str.with([](const std::string& x) { return !x.empty(); });
+    auto comma = chr<','>;
+    auto meta = name << comma << u64 << comma << u64 << comma;
+    renderer<Iterator> render{out};
+    for (auto row : rows) {
+      auto ts = caf::get<timestamp>(slice.at(row, 0));
+      auto ns = static_cast<uint64_t>(ts.time_since_epoch().count());
+      if (!meta(out, layout.name(), slice.offset() + row, ns))
+        return false;
+      // The first column holds the timestamp.
+      for (size_t i = 0; i < r.fields.size(); ++i) {
+        if (i > 0 && !str(out, separator))
+          return false;
+        auto x = materialize(slice.at(row, i + 1));
+        if (!caf::visit(render, r.fields[i].type, x))
+          return false;
+      }
+      if (!chr<'\n'>(out))
+        return false;
+    }
+    return true;
+  }
+
   // FIXME: relax print() constness constraint?!
   mutable type event_type;
 };
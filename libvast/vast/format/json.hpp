@@ -13,10 +13,24 @@
 
 #pragma once
 
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "vast/json.hpp"
 #include "vast/concept/printable/vast/json.hpp"
 
+#include "vast/data.hpp"
+#include "vast/detail/line_range.hpp"
 #include "vast/format/printer_writer.hpp"
+#include "vast/format/reader.hpp"
+#include "vast/schema.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/type.hpp"
+#include "vast/view.hpp"
 
 namespace vast::format::json {
 
@@ -28,6 +42,45 @@ struct event_printer : printer<event_printer> {
     vast::json j;
     return convert(e, j) && printers::json<policy::oneline>.print(out, j);
   }
+
+  /// Prints rows of a table slice in the same way as the corresponding events.
+  template <class Iterator>
+  bool print(Iterator& out, const table_slice& slice,
+             const std::vector<table_slice::size_type>& rows) const {
+    using printers::str;
+    auto p = printers::json<policy::oneline>;
+    auto layout = slice.layout(1).name(slice.layout().name());
+    auto& r = caf::get<record_type>(layout);
+    // All rows share the same type, so we render it only once.
+    vast::json type_json;
+    if (!convert(layout, type_json))
+      return false;
+    std::string type_str;
+    auto i = std::back_inserter(type_str);
+    if (!p.print(i, type_json))
+      return false;
+    for (auto row : rows) {
+      vast::json::object xs;
+      // The first column holds the timestamp.
+      for (size_t col = 0; col < r.fields.size(); ++col) {
+        auto& field = r.fields[col];
+        auto x = materialize(slice.at(row, col + 1));
+        if (!convert(x, xs[field.name], field.type))
+          return false;
+      }
+      auto id = static_cast<vast::json::number>(slice.offset() + row);
+      auto ts = caf::get<timestamp>(slice.at(row, 0));
+      auto ns = static_cast<vast::json::number>(ts.time_since_epoch().count());
+      auto ok = str(out, "{\"id\": ") && p.print(out, id)
+                && str(out, ", \"timestamp\": ") && p.print(out, ns)
+                && str(out, ", \"value\": {\"type\": ") && str(out, type_str)
+                && str(out, ", \"data\": ") && p.print(out, xs)
+                && str(out, "}}\n");
+      if (!ok)
+        return false;
+    }
+    return true;
+  }
 };
 
 class writer : public printer_writer<event_printer>{
@@ -39,6 +92,62 @@ public:
   }
 };
 
+/// A reader for newline-delimited JSON. The reader maps the fields of each
+/// object onto the first record type of its schema. Nested objects map onto
+/// nested records, and keys may also name nested fields directly in dot
+/// notation, e.g., `"id.orig_h"`. The reader skips unknown fields without
+/// looking at their contents, and turns values that don't fit the field type
+/// into nil. It scans the input directly instead of going through `vast::json`
+/// values.
+class reader : public format::reader {
+public:
+  reader() = default;
+
+  /// Constructs a JSON reader.
+  /// @param in The stream of JSON objects, one per line.
+  explicit reader(std::unique_ptr<std::istream> in);
+
+  void reset(std::unique_ptr<std::istream> in);
+
+  caf::expected<event> read() override;
+
+  std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size, consumer& f) override;
+
+  caf::expected<void> schema(vast::schema sch) override;
+
+  caf::expected<vast::schema> schema() const override;
+
+  const char* name() const override;
+
+private:
+  /// Parses the next line into `values_`.
+  /// @returns `true` if `values_` holds a new record, `false` for lines
+  ///          without an object, or an error.
+  expected<bool> parse_line();
+
+  /// Parses an object whose keys get prefixed with `path_`.
+  bool parse_object(const char*& f, const char* l);
+
+  /// Parses a value for the column at index `i`.
+  bool parse_value(const char*& f, const char* l, size_t i);
+
+  /// @returns The timestamp of the record in `values_`.
+  timestamp record_timestamp() const;
+
+  std::unique_ptr<std::istream> input_;
+  std::unique_ptr<detail::line_range> lines_;
+  vast::schema schema_;
+  type type_;
+  record_type flat_;
+  std::unordered_map<std::string, size_t> fields_;
+  std::unordered_set<std::string> prefixes_;
+  std::vector<data> values_;
+  std::string path_;
+  std::string buffer_;
+  int timestamp_field_ = -1;
+};
+
 } // namespace vast::format::json
 
 
@@ -2,6 +2,9 @@
 
 #include <iostream>
 #include <queue>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <caf/none.hpp>
 #include <caf/variant.hpp>
@@ -10,6 +13,7 @@
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/expected.hpp"
+#include "vast/format/reader.hpp"
 #include "vast/logger.hpp"
 #include "vast/schema.hpp"
 #include "vast/subnet.hpp"
@@ -1155,8 +1159,9 @@ struct record_parser : parser<record_parser> {
   }
 };
 
-/// An MRT reader.
-class reader {
+/// An MRT reader. The reader pulls its input in large blocks and parses the
+/// records in place, without copying them out of the block.
+class reader : public format::reader {
 public:
   struct types {
     type table_dump_v2_peer_entry_type;
@@ -1172,22 +1177,56 @@ public:
   reader() = default;
 
   /// Constructs a MRT reader.
-  explicit reader(std::unique_ptr<std::istream> input);
+  /// @param input The stream of MRT records.
+  /// @param threads The number of threads that parse records in
+  ///                `read_slices`. With more than one thread, the reader
+  ///                splits each block of input among the threads.
+  explicit reader(std::unique_ptr<std::istream> input, size_t threads = 1);
 
-  expected<event> read();
+  expected<event> read() override;
 
-  expected<void> schema(vast::schema const& sch);
+  /// Reads up to `max_events` events. Since a single MRT record can contain
+  /// many events, e.g., a RIB entry per peer, the reader may exceed
+  /// `max_events` by the events of the last record.
+  std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size, consumer& f) override;
 
-  expected<vast::schema> schema() const;
+  expected<void> schema(vast::schema sch) override;
 
-  const char* name() const;
+  expected<vast::schema> schema() const override;
+
+  const char* name() const override;
 
 private:
+  /// Locates the next complete record in the buffer.
+  /// @returns A view on the record, an empty view if the buffer contains no
+  ///          complete record, or an error if the record exceeds the maximum
+  ///          length.
+  expected<std::string_view> buffered_record();
+
+  /// Locates the next record, reading input as needed.
+  /// @returns A view on the record that remains valid until the next call
+  ///          to `fill`, or an error.
+  expected<std::string_view> next_record();
+
+  /// Moves the remaining bytes of the buffer to its front and reads the next
+  /// block of input.
+  /// @returns `ec::end_of_input` if the input is exhausted.
+  caf::error fill();
+
+  /// Implements `read_slices` on multiple threads.
+  std::pair<caf::error, size_t>
+  read_slices_parallel(size_t max_events, size_t max_slice_size, consumer& f);
+
   std::unique_ptr<std::istream> input_;
   std::vector<char> buffer_;
+  size_t buffer_begin_ = 0;
+  size_t buffer_end_ = 0;
   std::queue<event> events_;
   record_parser parser_;
   types types_;
+  size_t threads_ = 1;
+  std::vector<std::string_view> chunk_;
 };
 
 } // namespace mrt
@@ -47,7 +47,9 @@ public:
     if (lines_->done())
       return make_error(ec::end_of_input, "input exhausted");
     event e;
-    if (!parser_(lines_->get(), e))
+    // The line points into the input buffer and stays valid until next().
+    auto line = lines_->get();
+    if (!parser_(line, e))
       return make_error(ec::parse_error, "line", lines_->line_number());
     lines_->next();
     return e;
@@ -16,12 +16,13 @@
 #include <pcap.h>
 
 #include <chrono>
-#include <unordered_map>
-#include <random>
+#include <memory>
+#include <string_view>
 
 #include "vast/address.hpp"
 #include "vast/concept/hashable/hash_append.hpp"
 #include "vast/concept/hashable/xxhash.hpp"
+#include "vast/detail/lru_hash_map.hpp"
 #include "vast/detail/operators.hpp"
 #include "vast/expected.hpp"
 #include "vast/format/reader.hpp"
@@ -75,7 +76,10 @@ namespace vast {
 namespace format {
 namespace pcap {
 
-/// A PCAP reader.
+/// A PCAP reader. When listening on an interface, a dedicated capture thread
+/// drains the kernel ring in batches via `pcap_dispatch` and hands them to the
+/// reader through a lock-free queue, which then decodes each batch directly
+/// into table slices.
 class reader : public format::reader {
 public:
   reader() = default;
@@ -96,10 +100,18 @@ public:
                   size_t max_flows = 100000, size_t max_age = 60,
                   size_t expire_interval = 10, int64_t pseudo_realtime = 0);
 
+  reader(reader&&);
+
+  reader& operator=(reader&&);
+
   ~reader();
 
   caf::expected<event> read() override;
 
+  std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size,
+              consumer& f) override;
+
   caf::expected<void> schema(vast::schema sch) override;
 
   caf::expected<vast::schema> schema() const override;
@@ -112,12 +124,37 @@ private:
     uint64_t last;
   };
 
-  pcap_t* pcap_ = nullptr;
+  /// The decoded parts of a packet.
+  struct packet {
+    connection conn;
+    timestamp ts;
+    std::string_view payload;
+  };
+
+  /// Batches of packets from the capture thread.
+  struct capture;
+
+  struct pcap_deleter {
+    void operator()(pcap_t* x) const;
+  };
+
+  /// Opens the interface or trace file on first use.
+  caf::error open();
+
+  /// Fetches the next raw packet.
+  /// @returns `false` if no packet is available at the moment.
+  caf::expected<bool> next(const pcap_pkthdr*& header, const uint8_t*& data);
+
+  /// Decodes a raw packet and updates the flow table.
+  /// @returns `false` if the packet should be skipped.
+  caf::expected<bool> decode(const pcap_pkthdr& header, const uint8_t* data,
+                             packet& result);
+
+  std::unique_ptr<capture> capture_; // must go away before pcap_
+  std::unique_ptr<pcap_t, pcap_deleter> pcap_;
   type packet_type_;
-  std::unordered_map<connection, connection_state> flows_;
+  detail::lru_hash_map<connection, connection_state> flows_{1};
   uint64_t cutoff_;
-  size_t max_flows_;
-  std::mt19937 generator_;
   uint64_t max_age_;
   uint64_t expire_interval_;
   uint64_t last_expire_ = 0;
@@ -138,6 +175,8 @@ public:
 
   ~writer();
 
+  using format::writer::write;
+
   caf::expected<void> write(const event& e) override;
 
   caf::expected<void> flush() override;
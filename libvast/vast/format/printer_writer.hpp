@@ -16,16 +16,21 @@
 #include <iterator>
 #include <memory>
 #include <ostream>
+#include <string>
 
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/expected.hpp"
+#include "vast/table_slice.hpp"
 
 #include "vast/format/writer.hpp"
 
 namespace vast::format {
 
-/// A writer that operates with a given printer.
+/// A writer that operates with a given printer. The writer renders into a
+/// buffer and hands the buffer to the stream in one piece. For table slices,
+/// the printer must provide a `print(out, slice, rows)` member function that
+/// renders the given rows of a slice, each followed by a newline.
 template <class Printer>
 class printer_writer : public writer {
 public:
@@ -37,12 +42,27 @@ public:
     : out_{std::move(out)} {
   }
 
+  using writer::write;
+
   expected<void> write(const event& e) override {
-    auto i = std::ostreambuf_iterator<char>(*out_);
+    buffer_.clear();
+    auto i = std::back_inserter(buffer_);
     if (!printer_.print(i, e))
       return make_error(ec::print_error, "failed to print event:", e);
-    *out_ << '\n';
-    return {};
+    buffer_.push_back('\n');
+    return put();
+  }
+
+  expected<void> write(const table_slice& slice,
+                       const ids& selection) override {
+    auto rows = selected_rows(slice, selection);
+    if (rows.empty())
+      return {};
+    buffer_.clear();
+    auto i = std::back_inserter(buffer_);
+    if (!printer_.print(i, slice, rows))
+      return make_error(ec::print_error, "failed to print table slice");
+    return put();
   }
 
   expected<void> flush() override {
@@ -53,7 +73,14 @@ public:
   }
 
 private:
+  expected<void> put() {
+    if (!out_->write(buffer_.data(), buffer_.size()))
+      return make_error(ec::format_error, "failed to write");
+    return {};
+  }
+
   std::unique_ptr<std::ostream> out_;
+  std::string buffer_;
   Printer printer_;
 };
 
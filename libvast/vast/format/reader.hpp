@@ -13,15 +13,28 @@
 
 #pragma once
 
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <caf/error.hpp>
 #include <caf/expected.hpp>
 
 #include "vast/fwd.hpp"
+#include "vast/table_slice_builder.hpp"
 
 namespace vast::format {
 
 /// The base class for readers.
 class reader {
 public:
+  /// Receives table slices produced by `read_slices`.
+  using consumer = std::function<void(table_slice_ptr)>;
+
+  /// Generates layout-specific table slice builders.
+  using factory_type = table_slice_builder_ptr (*)(record_type);
+
   virtual ~reader();
 
   /// Reads the next event.
@@ -30,6 +43,27 @@ public:
   ///          otherwise.
   virtual caf::expected<event> read() = 0;
 
+  /// Reads up to `max_events` events and writes them directly into table
+  /// slices, one builder per layout. The first column of each slice holds the
+  /// event timestamp. Hands a slice to `f` as soon as it reaches
+  /// `max_slice_size` rows, and all partial slices when stopping on an error.
+  /// The default implementation goes through `read()`; readers override it to
+  /// skip the intermediate `event`.
+  /// @param max_events The maximum number of events to read.
+  /// @param max_slice_size The maximum number of rows per slice.
+  /// @param f The consumer for finished slices.
+  /// @returns An error if reading stopped early (`ec::end_of_input` when
+  ///          exhausting the input) and the number of produced events.
+  virtual std::pair<caf::error, size_t>
+  read_slices(size_t max_events, size_t max_slice_size, consumer& f);
+
+  /// Sets the factory for table slice builders in `read_slices`.
+  /// @param f The new factory.
+  void factory(factory_type f);
+
+  /// Hands all partial slices from `read_slices` to `f`.
+  void finish(consumer& f);
+
   /// Sets the schema for events to read.
   /// @param x The new schema.
   /// @returns `caf::none` on success.
@@ -41,6 +75,25 @@ public:
 
   /// @returns The name of the reader type.
   virtual const char* name() const = 0;
+
+protected:
+  /// Creates a new builder for `layout`.
+  /// @param layout The layout of the events, without the timestamp column.
+  /// @returns The builder or `nullptr` if `layout` is not a record type.
+  table_slice_builder_ptr make_builder(const type& layout) const;
+
+  /// Retrieves the builder for `layout`, which gets created on first access.
+  /// @param layout The layout of the events, without the timestamp column.
+  /// @param max_slice_size The number of rows to reserve in a new builder.
+  /// @returns The builder or `nullptr` if `layout` is not a record type.
+  table_slice_builder* builder(const type& layout, size_t max_slice_size);
+
+  /// Hands the slice under construction in `x` to `f`.
+  void finish(consumer& f, table_slice_builder& x);
+
+private:
+  factory_type factory_ = nullptr;
+  std::map<std::string, table_slice_builder_ptr> builders_;
 };
 
 } // namespace vast::format
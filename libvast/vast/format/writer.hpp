@@ -13,9 +13,12 @@
 
 #pragma once
 
+#include <vector>
+
 #include <caf/expected.hpp>
 
 #include "vast/fwd.hpp"
+#include "vast/table_slice.hpp"
 
 namespace vast::format {
 
@@ -29,6 +32,17 @@ public:
   /// @returns `caf::none` on success.
   virtual caf::expected<void> write(const event& x)  = 0;
 
+  /// Processes a batch of events in a table slice. Writers that override this
+  /// function render the selected rows directly from the columns of the
+  /// slice and write the result in one piece.
+  /// The default implementation converts the rows to events and calls
+  /// `write` for each event.
+  /// @param slice The table slice with the events.
+  /// @param selection The IDs of the events to write.
+  /// @returns `caf::none` on success.
+  virtual caf::expected<void> write(const table_slice& slice,
+                                    const ids& selection);
+
   /// Called periodically to flush state.
   /// @returns `caf::none` on success.
   /// The default implementation does nothing.
@@ -43,6 +57,11 @@ public:
 
   /// @returns The name of the writer type.
   virtual const char* name() const = 0;
+
+protected:
+  /// @returns The rows of `slice` whose IDs are in `selection`.
+  static std::vector<table_slice::size_type>
+  selected_rows(const table_slice& slice, const ids& selection);
 };
 
 } // namespace vast::format
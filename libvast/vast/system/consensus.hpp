@@ -50,6 +50,9 @@ constexpr auto request_timeout = election_timeout * 4;
 /// The heartbeat period.
 constexpr auto heartbeat_period = election_timeout / 2;
 
+/// The maximum number of AppendEntries requests in flight per peer.
+constexpr size_t max_inflight_append_entries = 8;
+
 /// A type to uniquely represent a server in the system. An ID of 0 is invalid.
 using server_id = uint64_t;
 
@@ -74,14 +77,30 @@ auto inspect(Inspector& f, log_entry& e) {
 }
 
 /// A sequence of log entries accessed through monotonically increasing
-/// indexes. The first entry has index 1. Index 0 is invalid. Mutable
-/// operations do not return before they have been made persistent.
+/// indexes. The first entry has index 1. Index 0 is invalid.
+///
+/// The log stores its entries in a sequence of append-only segment files,
+/// each named after the index of its first entry. Appends accumulate in
+/// memory until the next call to `persist`, which writes all of them at once
+/// and syncs the segment to disk. Truncating the front of the log deletes
+/// entire segments and truncating the back cuts the affected segment at the
+/// offset of the first removed entry, so neither operation rewrites the log.
 class log {
 public:
+  /// The default size of a segment file in bytes, after which the log starts
+  /// a new segment.
+  static constexpr size_t default_segment_size = 8 << 20;
+
   /// Constructs a log and attempts to read persistent state from the
   /// filesystem.
   /// @param dir The directory where the log stores persistent state.
-  log(caf::actor_system& sys, path dir);
+  /// @param segment_size The size in bytes after which to start a new
+  ///                     segment.
+  log(caf::actor_system& sys, path dir,
+      size_t segment_size = default_segment_size);
+
+  /// Persists pending entries and closes the current segment.
+  ~log();
 
   /// Retrieves the first log entry.
   /// @pre `!empty()`
@@ -97,6 +116,9 @@ public:
   /// Retrieves the last index in the log.
   index_type last_index() const;
 
+  /// Retrieves the last index that has been made persistent.
+  index_type last_persisted_index() const;
+
   /// Truncates all entries *before* a given index.
   index_type truncate_before(index_type index);
 
@@ -106,9 +128,14 @@ public:
   /// Accesses a log entry at a given index.
   log_entry& at(index_type i);
 
-  /// Appends entries to the log.
+  /// Appends entries to the log. The entries become persistent with the next
+  /// call to `persist`.
   expected<void> append(std::vector<log_entry> xs);
 
+  /// Writes all pending entries to the current segment in a single write and
+  /// syncs it to disk.
+  expected<void> persist();
+
   /// Checks whether the log is empty.
   bool empty() const;
 
@@ -116,22 +143,44 @@ public:
   friend uint64_t bytes(log& l);
 
 private:
-  expected<void> persist_meta_data();
+  /// A file that holds a contiguous range of log entries.
+  struct segment {
+    /// The index of the first entry in this segment.
+    index_type first;
+
+    /// The byte offsets of the entries in the segment file.
+    std::vector<uint64_t> offsets;
+
+    /// The size of the segment file.
+    uint64_t size = 0;
+  };
 
-  expected<void> persist_entries();
+  path segment_filename(index_type first) const;
+
+  expected<void> load_segment(segment& seg, bool last);
+
+  expected<void> open_last_segment();
+
+  expected<void> persist_meta_data();
 
   std::deque<log_entry> entries_;
   index_type start_ = 1;
-  std::ofstream meta_file_;
-  std::ofstream entries_file_;
+  index_type persisted_ = 0;
+  std::deque<segment> segments_;
+  file segment_file_;
+  std::vector<char> pending_;
+  size_t segment_size_;
   path dir_;
   caf::actor_system& sys_;
 };
 
 /// A snapshot covering log entries indices in *[1, L]* where *L* is the last
-/// included index.
+/// included index. In version 1, the serialized state machine snapshot follows
+/// the header as a byte vector. In version 2, the raw bytes of the state
+/// machine snapshot follow the header until the end of the file, which allows
+/// for writing a snapshot in chunks.
 struct snapshot_header {
-  uint32_t version = 1;
+  uint32_t version = 2;
   index_type last_included_index;
   term_type last_included_term;
 };
@@ -206,7 +255,7 @@ auto inspect(Inspector& f, append_entries::request& r) {
 
 template <class Inspector>
 auto inspect(Inspector& f, append_entries::response& r) {
-  return f(r.term, r.success);
+  return f(r.term, r.last_log_index, r.success);
 }
 
 /// The **InstallSnapshot** RPC.
@@ -253,6 +302,13 @@ struct peer_state {
   /// Indicates whether we have a vote from this peer.
   bool have_vote = false;
 
+  /// Number of AppendEntries requests awaiting a response.
+  size_t inflight = 0;
+
+  /// Indicates whether we search for the last matching index of this peer,
+  /// in which case we send only one AppendEntries request at a time.
+  bool probing = true;
+
   /// The index of the last log entry in the last snapshot.
   index_type last_snapshot_index = 0;
 
@@ -293,6 +349,12 @@ struct server_state {
   /// The snapshot file when writing the snapshot to disk.
   std::ofstream snapshot;
 
+  /// The snapshot file while the state machine supplies a snapshot in chunks.
+  std::ofstream pending_snapshot;
+
+  /// The header of the snapshot in `pending_snapshot`.
+  snapshot_header pending_snapshot_header;
+
   // -- volatile implementation details ---------------------------------------
 
   // The different states of a server.
@@ -313,6 +375,10 @@ struct server_state {
   // Flag that indicates whether we've kicked of the heartbeat loop.
   bool heartbeat_inflight = false;
 
+  // Flag that indicates whether we've scheduled persisting the log, which
+  // lets the leader persist all commands in its mailbox at once.
+  bool persist_inflight = false;
+
   // The point in time when a follower should hold an election.
   clock::time_point election_time = clock::time_point::max();
 
@@ -13,7 +13,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "vast/logger.hpp"
 
@@ -62,6 +65,31 @@ struct datagram_source_state : source_state<Reader, caf::io::broker> {
 
   /// Shuts down the stream manager when `true`.
   bool done = false;
+
+  /// The datagrams the reader currently parses, separated by newlines. Empty
+  /// once the reader has reached their end.
+  std::vector<char> active;
+
+  /// The datagrams that arrived while the reader parses `active`.
+  std::vector<char> pending;
+
+  /// Number of datagrams in `pending`.
+  size_t pending_datagrams = 0;
+
+  /// The stream buffer for the reader input over `active`.
+  std::unique_ptr<caf::arraybuf<>> streambuf;
+
+  /// Stores whether the reader has input left in `active`.
+  bool parsing = false;
+
+  /// Stores whether we have asked ourselves to parse the pending datagrams.
+  bool flush_scheduled = false;
+
+  /// The maximum number of bytes in `active` and `pending`.
+  size_t max_buffer_size = defaults::system::max_datagram_buffer_size;
+
+  /// Number of datagrams dropped because the buffers were full.
+  uint64_t dropped_datagrams = 0;
 };
 
 template <class Reader>
@@ -90,6 +118,42 @@ datagram_source(datagram_source_actor<Reader>* self,
   VAST_DEBUG(self, "starts listening at port", udp_res->second);
   // Initialize state.
   self->state.init(self, std::move(reader), std::move(factory));
+  // Parses buffered datagrams until exhausting either the buffers or the
+  // capacity of the stream. Instead of a stream per datagram, the reader gets
+  // one stream per batch of datagrams.
+  auto parse = [=](size_t capacity, auto& push_slice) {
+    auto& st = self->state;
+    size_t produced = 0;
+    while (capacity > 0) {
+      if (!st.parsing) {
+        if (st.pending.empty())
+          break;
+        VAST_DEBUG(self, "parses a batch of", st.pending_datagrams,
+                   "datagrams");
+        st.active.clear();
+        std::swap(st.active, st.pending);
+        st.pending_datagrams = 0;
+        st.streambuf = std::make_unique<caf::arraybuf<>>(st.active.data(),
+                                                         st.active.size());
+        st.reader.reset(std::make_unique<std::istream>(st.streambuf.get()));
+        st.parsing = true;
+      }
+      auto [n, eof] = st.extract_events(capacity * table_slice_size,
+                                        table_slice_size, push_slice);
+      produced += n;
+      capacity -= std::min(capacity, (n + table_slice_size - 1)
+                                     / table_slice_size);
+      if (eof) {
+        // Fully parsed datagrams no longer count against the buffer budget.
+        // Clearing keeps the storage, so the stream buffer remains valid.
+        st.parsing = false;
+        st.active.clear();
+      } else if (n == 0) {
+        break;
+      }
+    }
+    return produced;
+  };
   // Spin up the stream manager for the source.
   self->state.mgr = self->make_continuous_source(
     // init
@@ -98,8 +162,14 @@ datagram_source(datagram_source_actor<Reader>* self,
       self->send(self->state.accountant, "source.start", now);
     },
     // get next element
-    [](caf::unit_t&, downstream<table_slice_ptr>&, size_t) {
-      // nop, new slices are generated in the new_datagram_msg handler
+    [=](caf::unit_t&, downstream<table_slice_ptr>& out, size_t num) {
+      // Catch up on datagrams we buffered while the stream had no capacity.
+      auto start = steady_clock::now();
+      auto push_slice = [&](table_slice_ptr slice) {
+        out.push(std::move(slice));
+      };
+      auto produced = parse(num, push_slice);
+      self->state.report_stats(produced, start, steady_clock::now());
     },
     // done?
     [=](const caf::unit_t&) {
@@ -108,30 +178,46 @@ datagram_source(datagram_source_actor<Reader>* self,
   );
   return {
     [=](caf::io::new_datagram_msg& msg) {
-      // Check whether we can buffer more slices in the stream.
       VAST_DEBUG(self, "got a new datagram of size", msg.buf.size());
       auto& st = self->state;
+      // Buffer the datagram unless we exceed our memory budget.
+      auto size = msg.buf.size() + 1;
+      if (st.active.size() + st.pending.size() + size > st.max_buffer_size) {
+        if (st.dropped_datagrams++ % 1000 == 0) {
+          VAST_WARNING(self, "has no buffer space left and dropped",
+                       st.dropped_datagrams, "datagrams so far");
+          self->send(st.accountant, "source.dropped.datagrams",
+                     st.dropped_datagrams);
+        }
+        return;
+      }
+      st.pending.insert(st.pending.end(), msg.buf.begin(), msg.buf.end());
+      if (msg.buf.empty() || msg.buf.back() != '\n')
+        st.pending.push_back('\n');
+      ++st.pending_datagrams;
+      // Parse after all datagrams that are already in our mailbox, such that
+      // a burst ends up in as few slices as possible.
+      if (!st.flush_scheduled) {
+        st.flush_scheduled = true;
+        self->send(self, flush_atom::value);
+      }
+    },
+    [=](flush_atom) {
+      auto& st = self->state;
+      st.flush_scheduled = false;
       auto capacity = st.mgr->out().capacity();
       if (capacity == 0) {
-        VAST_WARNING(self, "has no capacity left in stream, dropping input!");
+        VAST_DEBUG(self, "buffers", st.pending_datagrams,
+                   "datagrams until the stream has capacity");
         return;
       }
-      // Extract events until the source has exhausted its input or until
-      // we have completed a batch.
       auto start = steady_clock::now();
-      caf::arraybuf<> buf{msg.buf.data(), msg.buf.size()};
-      st.reader.reset(std::make_unique<std::istream>(&buf));
       auto push_slice = [&](table_slice_ptr slice) {
         VAST_DEBUG(self, "produced a slice with", slice->rows(), "rows");
         st.mgr->out().push(std::move(slice));
       };
-      auto [produced, eof] = st.extract_events(capacity, table_slice_size,
-                                               push_slice);
-      auto stop = steady_clock::now();
-      if (!eof)
-        VAST_WARNING(self,
-                     "has not enough capacity left in stream, dropping input!");
-      st.report_stats(produced, start, stop);
+      auto produced = parse(capacity, push_slice);
+      st.report_stats(produced, start, steady_clock::now());
       if (produced > 0)
         st.mgr->push();
     },
@@ -18,20 +18,29 @@
 #include <memory>
 #include <unordered_map>
 
+#include <caf/broadcast_downstream_manager.hpp>
+#include <caf/stream_source.hpp>
+
 #include "vast/aliases.hpp"
+#include "vast/defaults.hpp"
 #include "vast/event.hpp"
 #include "vast/expression.hpp"
 #include "vast/ids.hpp"
 #include "vast/query_options.hpp"
+#include "vast/table_slice.hpp"
+#include "vast/table_slice_builder.hpp"
 #include "vast/uuid.hpp"
 
 #include "vast/system/accountant.hpp"
 #include "vast/system/archive.hpp"
+#include "vast/system/partition_scheduler.hpp"
 #include "vast/system/query_statistics.hpp"
 
 namespace vast::system {
 
 struct exporter_state {
+  using downstream_manager
+    = caf::broadcast_downstream_manager<table_slice_ptr>;
   archive_type archive;
   caf::actor index;
   caf::actor sink;
@@ -40,7 +49,25 @@ struct exporter_state {
   ids unprocessed;
   std::unordered_map<type, expression> checkers;
   std::deque<event> candidates;
-  std::vector<event> results;
+  /// Builds result slices from matching events with consecutive IDs.
+  table_slice_builder_ptr builder;
+  /// The type of the events in `builder`.
+  type builder_type;
+  /// The ID of the first event in `builder`.
+  id builder_offset = 0;
+  /// Result slices that wait for credit from the sinks.
+  std::deque<table_slice_ptr> results;
+  /// The number of events in `results`.
+  size_t buffered = 0;
+  /// The number of buffered results after which the exporter stops pulling
+  /// hits from the index and events from the archive.
+  size_t max_buffered = defaults::system::max_exporter_results;
+  /// Index hits that wait for buffer space before going to the archive.
+  std::deque<ids> lookups;
+  /// Sizes the batches of partitions that the exporter asks the index for.
+  partition_scheduler scheduler;
+  /// Streams result slices to the sinks.
+  caf::stream_source_ptr<downstream_manager> mgr;
   std::chrono::steady_clock::time_point start;
   query_statistics stats;
   query_options options;
@@ -50,7 +77,11 @@ struct exporter_state {
 
 /// The EXPORTER receives index hits, looks up the corresponding events in the
 /// archive, and performs a candidate check to select the resulting stream of
-/// matching events.
+/// matching events. The results flow to the sinks as a stream of table
+/// slices, such that slow sinks throttle the exporter instead of letting its
+/// buffers grow. For historical queries, the exporter keeps several batches
+/// of partitions in flight and sizes them according to the observed hit
+/// rates, the ARCHIVE latency, and the demand of the sinks.
 /// @param self The actor handle.
 /// @param ast The AST of query.
 /// @param qos The query options.
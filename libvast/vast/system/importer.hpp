@@ -14,6 +14,7 @@
 #pragma once
 
 #include <chrono>
+#include <fstream>
 #include <vector>
 
 #include <caf/event_based_actor.hpp>
@@ -80,10 +81,17 @@ struct importer_state {
 
   ~importer_state();
 
+  /// Restores the ID ranges from the journal that the last clean shutdown
+  /// left behind and starts a new journal.
   caf::error read_state();
 
+  /// Appends the currently available ID ranges to the journal, followed by a
+  /// marker that completes the checkpoint.
   caf::error write_state();
 
+  /// Appends a new lease to the journal.
+  caf::error record_lease(id first, id last);
+
   /// Handle to the meta store for obtaining more IDs.
   meta_store_type meta_store;
 
@@ -93,6 +101,9 @@ struct importer_state {
   /// @returns the number of currently available IDs.
   int32_t available_ids() const noexcept;
 
+  /// @returns the number of available IDs that no in-flight slice claims.
+  int32_t unclaimed_ids() const noexcept;
+
   /// @returns the first ID for an ID block of size `max_table_slice_size`.
   /// @pre `available_ids() >= max_table_slice_size`
   id next_id_block();
@@ -108,18 +119,28 @@ struct importer_state {
   int32_t max_table_slice_size;
 
   /// Number of ID blocks we acquire per replenish, e.g., setting this to 10
-  /// will acquire `max_table_slize * 10` IDs per replenish.
+  /// will acquire `max_table_slize * 10` IDs per replenish. Adapts to the
+  /// ingest rate.
   size_t blocks_per_replenish = 100;
 
-  /// Stores when we received new IDs for the last time.
+  /// Stores when we asked for new IDs for the last time.
   std::chrono::steady_clock::time_point last_replenish;
 
+  /// Number of IDs handed out since startup.
+  size_t consumed_ids = 0;
+
+  /// Value of `consumed_ids` at the last replenish.
+  size_t consumed_ids_at_replenish = 0;
+
   /// State directory.
   path dir;
 
   /// Stores whether we've contacted the meta store to obtain more IDs.
   bool awaiting_ids = false;
 
+  /// Receives leases and checkpoints of available IDs.
+  std::ofstream journal;
+
   /// The continous stage that moves data from all sources to all subscribers.
   caf::stream_stage_ptr<input_type, downstream_manager> stg;
 
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+#include "vast/time.hpp"
+
+namespace vast::system {
+
+/// Decides how many partitions an EXPORTER asks the INDEX for. The scheduler
+/// learns the hits per partition, the fraction of candidates that turn into
+/// results, and the latencies of INDEX and ARCHIVE. From these, it sizes each
+/// batch to cover the demand of the sinks, and it schedules the next batch
+/// while the ARCHIVE still works on the previous ones so that INDEX and
+/// ARCHIVE run concurrently.
+class partition_scheduler {
+public:
+  using clock = std::chrono::steady_clock;
+
+  /// The maximum number of batches in flight at the INDEX.
+  static constexpr size_t max_batches = 4;
+
+  /// Starts a query.
+  /// @param partitions The number of partitions that qualify for the query.
+  /// @param scheduled The number of partitions the INDEX scheduled up front.
+  /// @param now The current time.
+  void start(size_t partitions, size_t scheduled, clock::time_point now);
+
+  /// Records a request for *n* more partitions.
+  void schedule(size_t n, clock::time_point now);
+
+  /// Records the ID set of one partition.
+  /// @param hits The number of hits in the partition.
+  void partition_done(uint64_t hits, clock::time_point now);
+
+  /// Records a lookup of *candidates* IDs at the ARCHIVE.
+  void lookup_sent(uint64_t candidates, clock::time_point now);
+
+  /// Records the reply to the oldest pending lookup at the ARCHIVE.
+  /// @param candidates The number of events in the reply.
+  /// @param results The number of events that passed the candidate check.
+  void lookup_done(uint64_t candidates, uint64_t results,
+                   clock::time_point now);
+
+  /// Computes the size of the next batch.
+  /// @param demand The number of results the sinks can take beyond the ones
+  ///               the exporter has already buffered.
+  /// @returns The number of partitions to schedule, or 0 if the exporter
+  ///          should wait.
+  size_t next(uint64_t demand) const;
+
+  /// @returns the number of partitions that are not yet scheduled.
+  size_t remaining() const {
+    return partitions_ - scheduled_;
+  }
+
+  /// @returns the number of scheduled partitions without an ID set yet.
+  size_t inflight() const {
+    return scheduled_ - received_;
+  }
+
+  /// @returns the average number of hits per partition.
+  double hits_per_partition() const {
+    return hits_per_partition_;
+  }
+
+  /// @returns the average fraction of candidates that become results.
+  double selectivity() const {
+    return selectivity_;
+  }
+
+  /// @returns the average time the INDEX takes for a batch.
+  timespan index_latency() const {
+    return index_latency_;
+  }
+
+  /// @returns the average time the ARCHIVE takes for a lookup.
+  timespan archive_latency() const {
+    return archive_latency_;
+  }
+
+private:
+  size_t partitions_ = 0;
+  size_t scheduled_ = 0;
+  size_t received_ = 0;
+  size_t last_batch_ = 0;
+  size_t completed_lookups_ = 0;
+  uint64_t pending_candidates_ = 0;
+  double hits_per_partition_ = 0;
+  double selectivity_ = 1;
+  timespan index_latency_ = timespan::zero();
+  timespan archive_latency_ = timespan::zero();
+  /// The request time and the number of outstanding partitions per batch.
+  std::deque<std::pair<clock::time_point, size_t>> batches_;
+  /// The send time and the number of candidates per lookup.
+  std::deque<std::pair<clock::time_point, uint64_t>> lookups_;
+};
+
+} // namespace vast::system
@@ -15,7 +15,9 @@
 
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <caf/config_value.hpp>
 #include <caf/scoped_actor.hpp>
@@ -30,7 +32,8 @@
 namespace vast::system {
 
 /// Default implementation for import sub-commands. Compatible with Bro and MRT
-/// formats.
+/// formats. Spawns one source per input. Readers that parse on multiple
+/// threads receive the value of the `threads` option.
 /// @relates application
 template <class Reader>
 caf::message reader_command(const command& cmd, caf::actor_system& sys,
@@ -38,14 +41,29 @@ caf::message reader_command(const command& cmd, caf::actor_system& sys,
                             command::argument_iterator first,
                             command::argument_iterator last) {
   VAST_TRACE(VAST_ARG(options), VAST_ARG("args", first, last));
-  auto input = get_or(options, "read", defaults::command::read_path);
+  auto inputs = source_inputs(options);
+  if (!inputs)
+    return caf::make_message(std::move(inputs.error()));
   auto uds = get_or(options, "uds", false);
-  auto in = detail::make_input_stream(input, uds);
-  if (!in)
-    return caf::make_message(std::move(in.error()));
-  Reader reader{std::move(*in)};
-  auto src = sys.spawn(default_source<Reader>, std::move(reader));
-  return source_command(cmd, sys, std::move(src), options, first, last);
+  // Open all inputs before spawning the first source to fail early.
+  std::vector<Reader> readers;
+  for (auto& input : *inputs) {
+    auto in = detail::make_input_stream(input, uds);
+    if (!in)
+      return caf::make_message(std::move(in.error()));
+    if constexpr (std::is_constructible_v<Reader, decltype(std::move(*in)),
+                                          size_t>) {
+      auto threads = get_or(options, "threads",
+                            defaults::command::parser_threads);
+      readers.emplace_back(std::move(*in), threads);
+    } else {
+      readers.emplace_back(std::move(*in));
+    }
+  }
+  std::vector<caf::actor> srcs;
+  for (auto& reader : readers)
+    srcs.push_back(sys.spawn(default_source<Reader>, std::move(reader)));
+  return source_command(cmd, sys, std::move(srcs), options, first, last);
 }
 
 } // namespace vast::system
@@ -19,9 +19,11 @@
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
 #include <caf/none.hpp>
+#include <caf/typed_response_promise.hpp>
 
 #include "vast/error.hpp"
 #include "vast/logger.hpp"
+#include "vast/optional.hpp"
 #include "vast/si_literals.hpp"
 
 #include "vast/system/consensus.hpp"
@@ -43,9 +45,26 @@ struct replicated_store_state {
   uint64_t request_id = 0;
   std::unordered_map<uint64_t, caf::response_promise> requests;
   std::chrono::steady_clock::time_point last_stats_update;
+  // -- snapshotting --------------------------
+  /// The index of the snapshot in progress, or 0 if there is none.
+  raft::index_type snapshot_index = 0;
+  /// The keys in the store when the snapshot in progress began.
+  std::vector<Key> snapshot_keys;
+  /// The position of the next key to serialize.
+  size_t snapshot_position = 0;
+  /// The number of bytes of the snapshot in progress so far.
+  uint64_t snapshot_size = 0;
+  /// The values that keys had when the snapshot in progress began, for all
+  /// keys that changed since.
+  std::unordered_map<Key, optional<Value>> snapshot_shadow;
+  /// The clients awaiting completion of the snapshot in progress.
+  std::vector<caf::typed_response_promise<ok_atom>> snapshot_promises;
   static inline const char* name = "replicated-store";
 };
 
+/// The approximate size of a snapshot chunk in bytes.
+constexpr size_t replicated_store_snapshot_chunk_size = 1 << 20;
+
 template <class Inspector, class Key, class Value>
 auto inspect(Inspector& f, replicated_store_state<Key, Value>& state) {
   return f(state.store, state.last_applied, state.last_snapshot_size);
@@ -101,6 +120,20 @@ private:
 
 namespace vast::detail {
 
+// Remembers the value of a key before its first modification during a
+// snapshot, such that the snapshot reflects the state when it began.
+template <class Actor, class Key>
+void preserve(Actor* self, const Key& key) {
+  auto& st = self->state;
+  if (st.snapshot_index == 0 || st.snapshot_shadow.count(key) > 0)
+    return;
+  auto i = st.store.find(key);
+  if (i == st.store.end())
+    st.snapshot_shadow.emplace(key, caf::none);
+  else
+    st.snapshot_shadow.emplace(key, i->second);
+}
+
 template <class Actor>
 auto apply(Actor* self, caf::message& operation) {
   using namespace vast::system;
@@ -109,23 +142,102 @@ auto apply(Actor* self, caf::message& operation) {
   return *operation.apply({
     [=](put_atom, const key_type& key, value_type& value) {
       VAST_DEBUG(self, "applies PUT");
+      preserve(self, key);
       self->state.store[key] = std::move(value);
       return ok_atom::value;
     },
     [=](add_atom, const key_type& key, const value_type& value) {
       VAST_DEBUG(self, "applies ADD");
+      preserve(self, key);
       auto old = self->state.store[key];
       self->state.store[key] += value;
       return old;
     },
     [=](delete_atom, const key_type& key) {
       VAST_DEBUG(self, "applies DELETE");
+      preserve(self, key);
       self->state.store.erase(key);
       return ok_atom::value;
     },
   });
 }
 
+// Aborts the snapshot in progress.
+template <class Actor>
+void abort_snapshot(Actor* self, const caf::error& reason) {
+  auto& st = self->state;
+  for (auto& rp : st.snapshot_promises)
+    rp.deliver(reason);
+  st.snapshot_promises.clear();
+  st.snapshot_index = 0;
+  st.snapshot_keys.clear();
+  st.snapshot_position = 0;
+  st.snapshot_size = 0;
+  st.snapshot_shadow.clear();
+}
+
+// Serializes the next chunk of the snapshot in progress and hands it to the
+// consensus module. The chunks concatenate to the serialized state as of the
+// beginning of the snapshot. Between chunks, the store keeps serving requests.
+template <class Actor>
+void send_snapshot_chunk(Actor* self, const caf::actor& consensus) {
+  using namespace vast::system;
+  auto& st = self->state;
+  VAST_ASSERT(st.snapshot_index > 0);
+  std::vector<char> chunk;
+  caf::binary_serializer bs{self->system(), chunk};
+  auto first = st.snapshot_position == 0;
+  if (first) {
+    auto n = st.snapshot_keys.size();
+    bs.begin_sequence(n);
+  }
+  while (st.snapshot_position < st.snapshot_keys.size()
+         && chunk.size() < replicated_store_snapshot_chunk_size) {
+    auto& key = st.snapshot_keys[st.snapshot_position++];
+    auto i = st.snapshot_shadow.find(key);
+    if (i != st.snapshot_shadow.end()) {
+      VAST_ASSERT(i->second);
+      bs(key, *i->second);
+    } else {
+      auto j = st.store.find(key);
+      VAST_ASSERT(j != st.store.end());
+      bs(key, j->second);
+    }
+  }
+  auto last = st.snapshot_position == st.snapshot_keys.size();
+  if (last) {
+    bs.end_sequence();
+    bs(st.snapshot_index, st.last_snapshot_size);
+  }
+  auto index = st.snapshot_index;
+  st.snapshot_size += chunk.size();
+  VAST_DEBUG(self, "sends snapshot chunk with", chunk.size(), "bytes");
+  self->request(consensus, consensus_timeout, snapshot_atom::value, index,
+                std::move(chunk), first, last).then(
+    [=](raft::index_type) {
+      auto& st = self->state;
+      // A snapshot from the leader may have aborted ours.
+      if (st.snapshot_index != index)
+        return;
+      if (!last) {
+        send_snapshot_chunk(self, consensus);
+        return;
+      }
+      VAST_DEBUG(self, "successfully snapshotted state");
+      st.last_snapshot_size = st.snapshot_size;
+      for (auto& rp : st.snapshot_promises)
+        rp.deliver(ok_atom::value);
+      st.snapshot_promises.clear();
+      abort_snapshot(self, caf::none);
+    },
+    [=](caf::error& e) {
+      VAST_ERROR(self, "failed to snapshot:", self->system().render(e));
+      if (self->state.snapshot_index == index)
+        abort_snapshot(self, e);
+    }
+  );
+}
+
 // Applies a mutable operation coming from the consensus module.
 template <class Actor>
 void update(Actor* self, caf::message& command) {
@@ -148,6 +260,9 @@ void update(Actor* self, caf::message& command) {
     },
     [=](snapshot_atom, raft::index_type, const std::vector<char>& data) {
       VAST_DEBUG(self, "applies snapshot");
+      if (self->state.snapshot_index > 0)
+        abort_snapshot(self, make_error(ec::unspecified,
+                                        "superseded by remote snapshot"));
       caf::binary_deserializer bd{self->system(), data};
       bd >> self->state;
       self->state.last_snapshot_size = data.size();
@@ -201,15 +316,6 @@ replicated_store(
   using namespace caf;
   self->monitor(consensus);
   self->anon_send(consensus, subscribe_atom::value, actor_cast<actor>(self));
-  // Takes a snapshot at the currently applied index.
-  auto make_snapshot = [=] {
-    VAST_ASSERT(self->state.last_applied > 0);
-    std::vector<char> state;
-    binary_serializer bs{self->system(), state};
-    bs << self->state;
-    VAST_DEBUG(self, "serialized", state.size(), "bytes");
-    return state;
-  };
   self->set_down_handler(
     [=](const down_msg& msg) {
       VAST_ASSERT(msg.source == consensus);
@@ -278,22 +384,19 @@ replicated_store(
       );
     },
     [=](snapshot_atom) {
-      VAST_DEBUG(self, "takes snapshot at index", self->state.last_applied);
+      auto& st = self->state;
       auto rp = self->template make_response_promise<ok_atom>();
-      auto snapshot = make_snapshot();
-      auto snapshot_size = snapshot.size();
-      self->request(consensus, consensus_timeout, snapshot_atom::value,
-                    self->state.last_applied, std::move(snapshot)).then(
-        [=](raft::index_type) mutable {
-          VAST_DEBUG(self, "successfully snapshotted state");
-          self->state.last_snapshot_size = snapshot_size;
-          rp.deliver(ok_atom::value);
-        },
-        [=](error& e) mutable {
-          VAST_ERROR(self, "failed to snapshot:", self->system().render(e));
-          rp.deliver(std::move(e));
-        }
-      );
+      st.snapshot_promises.push_back(rp);
+      // Join the snapshot in progress, if any.
+      if (st.snapshot_index > 0)
+        return rp;
+      VAST_DEBUG(self, "takes snapshot at index", st.last_applied);
+      VAST_ASSERT(st.last_applied > 0);
+      st.snapshot_index = st.last_applied;
+      st.snapshot_keys.reserve(st.store.size());
+      for (auto& x : st.store)
+        st.snapshot_keys.push_back(x.first);
+      detail::send_snapshot_chunk(self, consensus);
       return rp;
     }
   };
@@ -21,13 +21,18 @@
 
 #include <caf/behavior.hpp>
 #include <caf/stateful_actor.hpp>
+#include <caf/stream.hpp>
+#include <caf/unit.hpp>
 
+#include "vast/bitmap_algorithms.hpp"
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/vast/uuid.hpp"
 #include "vast/event.hpp"
 #include "vast/format/writer.hpp"
+#include "vast/ids.hpp"
 #include "vast/system/atoms.hpp"
 #include "vast/system/query_statistics.hpp"
+#include "vast/table_slice.hpp"
 
 namespace vast::system {
 
@@ -38,6 +43,7 @@ struct sink_state {
   std::chrono::steady_clock::time_point last_flush;
   uint64_t processed = 0;
   uint64_t limit = 0;
+  bool done = false;
   Writer writer;
   const char* name = "writer";
 };
@@ -60,6 +66,51 @@ caf::behavior sink(caf::stateful_actor<sink_state<Writer>>* self,
       self->quit(msg.reason);
     }
   );
+  // Writes the selected rows of a slice and stops at the limit.
+  auto write_slice = [=](const table_slice_ptr& slice, const ids& xs) {
+    auto& st = self->state;
+    if (st.done)
+      return;
+    // The selection may span more IDs than the slice covers.
+    ids range;
+    range.append_bits(false, slice->offset());
+    range.append_bits(true, slice->rows());
+    auto selection = xs & range;
+    auto n = rank(selection);
+    if (n == 0)
+      return;
+    auto write = [&](const ids& xs) {
+      auto r = st.writer.write(*slice, xs);
+      if (!r) {
+        VAST_ERROR(self, self->system().render(r.error()));
+        st.writer.cleanup();
+        st.done = true;
+        self->quit(r.error());
+      }
+      return static_cast<bool>(r);
+    };
+    if (st.limit > 0 && st.processed + n >= st.limit) {
+      // Cut the selection after the last event we may write.
+      ids mask;
+      mask.append_bits(true, select(selection, st.limit - st.processed) + 1);
+      if (!write(selection & mask))
+        return;
+      st.processed = st.limit;
+      VAST_INFO(self, "reached limit:", st.limit, "events");
+      st.writer.cleanup();
+      st.done = true;
+      self->quit();
+      return;
+    }
+    if (!write(selection))
+      return;
+    st.processed += n;
+    auto now = steady_clock::now();
+    if (now - st.last_flush > st.flush_interval) {
+      st.writer.flush();
+      st.last_flush = now;
+    }
+  };
   return {
     [=](const std::vector<event>& xs) {
       for (auto& x : xs) {
@@ -83,6 +134,30 @@ caf::behavior sink(caf::stateful_actor<sink_state<Writer>>* self,
         }
       }
     },
+    [=](const table_slice_ptr& slice, const ids& selection) {
+      write_slice(slice, selection);
+    },
+    [=](caf::stream<table_slice_ptr> in) {
+      // The sink grants credit to the exporter as it writes, i.e., a slow
+      // sink throttles the exporter.
+      return self->make_sink(
+        in,
+        [](caf::unit_t&) {
+          // nop
+        },
+        [=](caf::unit_t&, const table_slice_ptr& slice) {
+          ids selection;
+          selection.append_bits(false, slice->offset());
+          selection.append_bits(true, slice->rows());
+          write_slice(slice, selection);
+        },
+        [=](caf::unit_t&, const caf::error& err) {
+          if (err)
+            VAST_ERROR(self, "got a stream error:",
+                       self->system().render(err));
+        }
+      );
+    },
     [=](const uuid& id, const query_statistics&) {
       VAST_IGNORE_UNUSED(id);
       VAST_DEBUG(self, "got query statistics from", id);
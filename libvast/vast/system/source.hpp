@@ -40,6 +40,7 @@
 #include "vast/expected.hpp"
 #include "vast/expression.hpp"
 #include "vast/expression_visitors.hpp"
+#include "vast/format/reader.hpp"
 #include "vast/schema.hpp"
 #include "vast/system/accountant.hpp"
 #include "vast/system/atoms.hpp"
@@ -55,6 +56,14 @@ struct Reader {
 
   expected<result> read();
 
+  std::pair<caf::error, size_t> read_slices(size_t max_events,
+                                            size_t max_slice_size,
+                                            format::reader::consumer& f);
+
+  void factory(format::reader::factory_type f);
+
+  void finish(format::reader::consumer& f);
+
   expected<void> schema(vast::schema&);
 
   expected<vast::schema> schema() const;
@@ -122,6 +131,7 @@ struct source_state {
     reader = std::move(rd);
     name = reader.name();
     factory = std::move(f);
+    reader.factory(factory);
     // Fetch accountant from the registry.
     if (auto acc = self->system().registry().get(accountant_atom::value)) {
       VAST_DEBUG(self, "uses registry accountant:", accountant);
@@ -170,6 +180,34 @@ struct source_state {
       else
         push_slice(std::move(slice));
     };
+    format::reader::consumer consumer = [&](table_slice_ptr slice) {
+      push_slice(std::move(slice));
+    };
+    auto stop = [&](const caf::error& err) {
+      // Log unexpected errors and when reaching the end of input.
+      if (err == ec::end_of_input) {
+        VAST_DEBUG(self, self->system().render(err));
+      } else {
+        VAST_ERROR(self, self->system().render(err));
+      }
+      /// Produce one final slices if possible.
+      for (auto& kvp : builders) {
+        auto bptr = kvp.second.get();
+        if (kvp.second != nullptr && bptr->rows() > 0)
+          finish_slice(bptr);
+      }
+      reader.finish(consumer);
+    };
+    // Without a filter, the reader writes directly into table slices and we
+    // can skip the detour through events.
+    if (caf::holds_alternative<caf::none_t>(filter)) {
+      auto [err, produced] = reader.read_slices(max_events, table_slice_size,
+                                                consumer);
+      if (!err)
+        return {produced, false};
+      stop(err);
+      return {produced, true};
+    }
     size_t produced = 0;
     // The streaming operates on slices, while the reader operates on events.
     // Hence, we can produce up to num * table_slice_size events per run.
@@ -185,18 +223,7 @@ struct source_state {
           VAST_WARNING(self, self->system().render(err));
           continue;
         }
-        // Log unexpected errors and when reaching the end of input.
-        if (err == ec::end_of_input) {
-          VAST_DEBUG(self, self->system().render(err));
-        } else {
-          VAST_ERROR(self, self->system().render(err));
-        }
-        /// Produce one final slices if possible.
-        for (auto& kvp : builders) {
-          auto bptr = kvp.second.get();
-          if (kvp.second != nullptr && bptr->rows() > 0)
-            finish_slice(bptr);
-        }
+        stop(err);
         return {produced, true};
       }
       auto& e = *maybe_e;
@@ -13,10 +13,32 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
+#include <caf/expected.hpp>
+
 #include "vast/command.hpp"
 
 namespace vast::system {
 
+/// Resolves the `read` option of an import command into the inputs for its
+/// sources. The option holds a comma-separated list of files, directories,
+/// and glob patterns, each of which expands according to ::glob.
+/// @param options The options of the import command.
+/// @returns The list of inputs or an error if a pattern matches nothing.
+caf::expected<std::vector<std::string>>
+source_inputs(const caf::config_value_map& options);
+
+/// Format-independent implementation for import sub-commands. All sources
+/// stream into the same IMPORTER, and the command returns after the last
+/// source terminated.
+caf::message source_command(const command& cmd, caf::actor_system& sys,
+                            std::vector<caf::actor> srcs,
+                            caf::config_value_map& options,
+                            command::argument_iterator first,
+                            command::argument_iterator last);
+
 /// Format-independent implementation for import sub-commands.
 caf::message source_command(const command& cmd, caf::actor_system& sys,
                             caf::actor src, caf::config_value_map& options,
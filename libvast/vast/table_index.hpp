@@ -68,9 +68,12 @@ public:
   /// Load state from disk.
   caf::error init();
 
-  /// Persists all indexes to disk.
+  /// Persists all indexes to disk incrementally.
   caf::error flush_to_disk();
 
+  /// Persists all indexes to disk in their final form.
+  caf::error seal();
+
   /// -- properties ------------------------------------------------------------
 
   /// @returns the number of columns.
@@ -13,8 +13,12 @@
 
 #pragma once
 
+#include <string_view>
+#include <type_traits>
+
 #include <caf/ref_counted.hpp>
 
+#include "vast/detail/assert.hpp"
 #include "vast/fwd.hpp"
 #include "vast/view.hpp"
 
@@ -41,6 +45,25 @@ public:
   /// @returns `true` on success.
   virtual bool add(data_view x) = 0;
 
+  /// Adds data to the builder without checking it against the type of the
+  /// current column. Readers that derive their values from the layout itself
+  /// skip the per-cell type check this way, whereas untrusted input must go
+  /// through `add`. The default implementation calls `add`.
+  /// @param x The data to add.
+  /// @returns `true` on success.
+  /// @pre *x* is nil or matches the type of the current column.
+  virtual bool add_unchecked(data_view x);
+
+  /// Adds a complete row without per-cell type checks.
+  /// @param xs The values of the row, one per column.
+  /// @returns `true` on success.
+  /// @pre Each value in *xs* is nil or matches the type of its column.
+  template <class... Ts>
+  bool add_row(const Ts&... xs) {
+    VAST_ASSERT(sizeof...(Ts) == layout_.fields.size());
+    return (add_unchecked(to_data_view(xs)) && ...);
+  }
+
   /// Constructs a table_slice from the currently accumulated state. After
   /// calling this function, implementations must reset their internal state
   /// such that subsequent calls to add will restart with a new table_slice.
@@ -61,6 +84,14 @@ public:
   }
 
 private:
+  template <class T>
+  static data_view to_data_view(const T& x) {
+    if constexpr (std::is_same_v<T, std::string_view>)
+      return x;
+    else
+      return make_data_view(x);
+  }
+
   record_type layout_;
 };
 
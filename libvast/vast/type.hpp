@@ -804,6 +804,16 @@ inline bool has_skip_attribute(const type& t) {
   return std::any_of(attrs.begin(), attrs.end(), pred);
 }
 
+/// Tests whether a type has an "index" attribute with a given value.
+/// @relates type
+inline bool has_index_attribute(const type& t, const std::string& kind) {
+  auto& attrs = t.attributes();
+  auto pred = [&](auto& x) {
+    return x.key == "index" && x.value && *x.value == kind;
+  };
+  return std::any_of(attrs.begin(), attrs.end(), pred);
+}
+
 /// @relates type
 bool convert(const type& t, json& j);
 
@@ -14,17 +14,30 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
 
+#include <caf/binary_deserializer.hpp>
+#include <caf/binary_serializer.hpp>
+#include <caf/meta/load_callback.hpp>
+
+#include "vast/address.hpp"
 #include "vast/ewah_bitmap.hpp"
 #include "vast/ids.hpp"
 #include "vast/bitmap_index.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
 #include "vast/concept/printable/vast/data.hpp"
 #include "vast/concept/printable/vast/operator.hpp"
 #include "vast/die.hpp"
 #include "vast/error.hpp"
 #include "vast/expected.hpp"
+#include "vast/optional.hpp"
+#include "vast/subnet.hpp"
 #include "vast/type.hpp"
 #include "vast/view.hpp"
 
@@ -243,17 +256,67 @@ private:
   bitmap_index_type bmi_;
 };
 
-/// An index for strings.
+/// An index for strings. As long as a column holds only a few distinct
+/// strings, the index assigns each string a code from a dictionary and stores
+/// the codes in an equality-coded bitmap index. Once the number of distinct
+/// strings exceeds a threshold, the index falls back to a bitsliced
+/// representation of every character position.
 class string_index : public value_index {
 public:
+  /// The number of characters per n-gram.
+  static constexpr size_t ngram_size = 3;
+
   /// Constructs a string index.
   /// @param max_length The maximum string length to support. Longer strings
   ///                   will be chopped to this size.
-  explicit string_index(size_t max_length = 1024);
+  /// @param ngrams If `true`, the index also maintains one posting bitmap per
+  ///               n-gram to answer substring and pattern queries. These
+  ///               lookups then yield candidates that may include false
+  ///               positives.
+  /// @param max_cardinality The maximum number of distinct strings to
+  ///                        dictionary-encode. A value of 0 disables
+  ///                        dictionary encoding.
+  explicit string_index(size_t max_length = 1024, bool ngrams = false,
+                        size_t max_cardinality = 256);
+
+  /// A magic constant that precedes the serialized state, since the initial
+  /// string index format had no version.
+  static constexpr uint32_t magic = 0x56535849;
+
+  /// The current version of the serialized state. Version 2 added the n-gram
+  /// postings and the dictionary.
+  static constexpr uint32_t version = 2;
+
+  /// @returns `true` if the index currently uses dictionary encoding.
+  bool dictionary_encoded() const {
+    return dictionary_encoded_;
+  }
 
   template <class Inspector>
   friend auto inspect(Inspector& f, string_index& idx) {
-    return f(static_cast<value_index&>(idx), idx.length_, idx.chars_);
+    auto x = magic;
+    auto v = version;
+    // Rejects other formats before reading any further.
+    auto check = [&]() -> caf::error {
+      if (x != magic)
+        return make_error(ec::version_error,
+                          "string index without format tag, rebuild required");
+      if (v != version)
+        return make_error(ec::version_error, "unsupported string index version",
+                          v);
+      return caf::none;
+    };
+    auto load = [&]() -> caf::error {
+      idx.codes_.clear();
+      for (auto i = 0u; i < idx.dictionary_.size(); ++i)
+        idx.codes_.emplace(hash_code(idx.dictionary_[i]), i);
+      return caf::none;
+    };
+    return f(x, v, caf::meta::load_callback(check),
+             static_cast<value_index&>(idx), idx.max_length_, idx.length_,
+             idx.chars_, idx.ngrams_enabled_, idx.ngrams_,
+             idx.max_cardinality_, idx.dictionary_encoded_, idx.dictionary_,
+             idx.code_, caf::meta::load_callback(load));
   }
 
 private:
@@ -264,32 +327,181 @@ private:
   using length_bitmap_index =
     bitmap_index<uint32_t, multi_level_coder<range_coder<ids>>>;
 
+  /// The index which holds the dictionary code of each string.
+  using code_bitmap_index =
+    bitmap_index<uint32_t, equality_coder<ewah_bitmap>>;
+
+  /// Maps an n-gram to the IDs of all strings containing it.
+  using ngram_map = std::unordered_map<uint32_t, ewah_bitmap>;
+
   void init();
 
   bool append_impl(data_view x, id pos) override;
 
+  /// @returns the key of *str* in `codes_`.
+  static size_t hash_code(std::string_view str) {
+    return std::hash<std::string_view>{}(str);
+  }
+
+  /// @returns the dictionary code of *str* if the dictionary contains it.
+  optional<uint32_t> find_code(std::string_view str) const;
+
+  /// Appends a string to the dictionary-encoded representation.
+  /// @returns `false` if *str* would exceed the maximum cardinality.
+  bool dictionary_append(std::string_view str, id pos);
+
+  /// Appends a string to the character-wise representation.
+  void chars_append(std::string_view str, id pos);
+
+  /// Converts the dictionary-encoded representation into the character-wise
+  /// representation.
+  void spill();
+
   expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  expected<ids>
+  dictionary_lookup(relational_operator op, data_view x) const;
+
+  /// @returns a superset of all IDs whose string contains *str*.
+  /// @pre `ngrams_enabled_ && str.size() >= ngram_size`
+  ids ngram_lookup(std::string_view str) const;
+
   size_t max_length_;
   length_bitmap_index length_;
   std::vector<char_bitmap_index> chars_;
+  bool ngrams_enabled_;
+  ngram_map ngrams_;
+  size_t max_cardinality_;
+  bool dictionary_encoded_;
+  std::vector<std::string> dictionary_;
+  /// Maps the hash of each dictionary entry to its code. Keying by hash lets
+  /// us look up string views without materializing a string.
+  std::unordered_multimap<size_t, uint32_t> codes_;
+  code_bitmap_index code_;
+};
+
+/// An index for strings that only stores a 64-bit hash digest of each string.
+/// In exchange for a fixed number of bitmaps, equality lookups yield
+/// candidates that may include hash collisions. All other operators consider
+/// every string a candidate, leaving exact evaluation to the caller.
+class string_hash_index : public value_index {
+public:
+  using digest_type = xxhash64::result_type;
+
+  using digest_bitmap_index =
+    bitmap_index<digest_type, bitslice_coder<ewah_bitmap>>;
+
+  string_hash_index() = default;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, string_hash_index& idx) {
+    return f(static_cast<value_index&>(idx), idx.digests_);
+  }
+
+private:
+  void init();
+
+  bool append_impl(data_view x, id pos) override;
+
+  expected<ids>
+  lookup_impl(relational_operator op, data_view x) const override;
+
+  digest_bitmap_index digests_;
 };
 
-/// An index for IP addresses.
+/// An index for IP addresses. Optionally, the index maintains a binned trie
+/// of prefix bitmaps: for every prefix length that is a multiple of a given
+/// stride, it stores one bitmap per distinct network prefix. Subnet
+/// membership queries then fetch a single prefix bitmap and refine the
+/// remaining bits with fewer than *stride* bit slices.
 class address_index : public value_index {
 public:
   using byte_index = bitmap_index<uint8_t, bitslice_coder<ewah_bitmap>>;
   using type_index = bitmap_index<bool, singleton_coder<ewah_bitmap>>;
 
-  address_index() = default;
+  /// Maps a network prefix to the IDs of all addresses within it.
+  using prefix_map = std::map<address, ewah_bitmap>;
+
+  /// Constructs an address index.
+  /// @param stride The distance between two prefix lengths in the trie of
+  ///               prefix bitmaps. A value of 0 disables the trie.
+  explicit address_index(size_t stride = 0);
+
+  /// A magic constant that tags the serialized state, since the initial
+  /// address index format had no version.
+  static constexpr uint64_t magic = 0x56414958;
+
+  /// The current version of the serialized state. Version 2 added the prefix
+  /// trie.
+  static constexpr uint32_t version = 2;
 
   template <class Inspector>
   friend auto inspect(Inspector& f, address_index& idx) {
-    return f(static_cast<value_index&>(idx), idx.bytes_, idx.v4_);
+    if constexpr (Inspector::writes_state) {
+      return idx.load(f);
+    } else {
+      // The untagged format begins with the blocks of the value index mask,
+      // and an empty block sequence always precedes a zero marker. Hence an
+      // empty sequence followed by the magic constant cannot be mistaken for
+      // it.
+      size_t n = 0;
+      auto x = magic;
+      auto v = version;
+      if (auto err = f.begin_sequence(n))
+        return err;
+      if (auto err = f.end_sequence())
+        return err;
+      return f(x, v, static_cast<value_index&>(idx), idx.bytes_, idx.v4_,
+               idx.stride_, idx.prefixes_);
+    }
   }
 
 private:
+  /// Loads the tagged format or, in its absence, the untagged format without
+  /// prefix trie.
+  template <class Deserializer>
+  caf::error load(Deserializer& source) {
+    size_t n = 0;
+    if (auto err = source.begin_sequence(n))
+      return err;
+    ewah_bitmap::block_vector blocks(n);
+    for (auto& block : blocks)
+      if (auto err = source(block))
+        return err;
+    if (auto err = source.end_sequence())
+      return err;
+    ewah_bitmap::block_type x;
+    if (auto err = source(x))
+      return err;
+    if (n == 0 && x == magic) {
+      uint32_t v;
+      if (auto err = source(v))
+        return err;
+      if (v != version)
+        return make_error(ec::version_error,
+                          "unsupported address index version", v);
+      return source(static_cast<value_index&>(*this), bytes_, v4_, stride_,
+                    prefixes_);
+    }
+    // We already consumed the beginning of the mask, so we reassemble the
+    // value index from its parts.
+    ewah_bitmap::size_type num_bits;
+    ewah_bitmap none;
+    if (auto err = source(num_bits, none))
+      return err;
+    std::vector<char> buf;
+    caf::binary_serializer sink{source.context(), buf};
+    if (auto err = sink(blocks, x, num_bits, none))
+      return err;
+    caf::binary_deserializer base{source.context(), buf};
+    if (auto err = base(static_cast<value_index&>(*this)))
+      return err;
+    stride_ = 0;
+    prefixes_.clear();
+    return source(bytes_, v4_);
+  }
+
   void init();
 
   bool append_impl(data_view x, id pos) override;
@@ -297,8 +509,14 @@ private:
   expected<ids>
   lookup_impl(relational_operator op, data_view x) const override;
 
+  /// Looks up subnet membership with the help of the prefix trie.
+  /// @returns nothing if the trie cannot answer the query.
+  optional<ids> prefix_lookup(const subnet& x) const;
+
   std::array<byte_index, 16> bytes_;
   type_index v4_;
+  size_t stride_;
+  std::vector<prefix_map> prefixes_;
 };
 
 /// An index for subnets.
@@ -454,7 +672,9 @@ struct value_index_inspect_helper {
       return f_(static_cast<arithmetic_index<timestamp>&>(idx_));
     }
 
-    result_type operator()(const string_type&) const {
+    result_type operator()(const string_type& t) const {
+      if (has_index_attribute(t, "hash"))
+        return f_(static_cast<string_hash_index&>(idx_));
       return f_(static_cast<string_index&>(idx_));
     }
 
@@ -518,7 +738,9 @@ struct value_index_inspect_helper {
       return std::make_unique<arithmetic_index<timestamp>>();
     }
 
-    result_type operator()(const string_type&) const {
+    result_type operator()(const string_type& t) const {
+      if (has_index_attribute(t, "hash"))
+        return std::make_unique<string_hash_index>();
       return std::make_unique<string_index>();
     }
 